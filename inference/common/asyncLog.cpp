@@ -0,0 +1,301 @@
+#include "asyncLog.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace inference
+{
+namespace asyncLog
+{
+
+std::atomic<int> gReportableSeverity{static_cast<int>(Severity::kINFO)};
+
+namespace
+{
+
+constexpr size_t kRecordTextSize = 224;
+constexpr size_t kRingCapacity = 4096;
+constexpr std::chrono::milliseconds kWritePeriod{10};
+
+//!
+//! \brief Fixed size message chunk, longer messages take several consecutive records
+//!
+struct Record
+{
+    int64_t mTimestampUs;
+    Severity mSeverity;
+    bool mContinued; //!< Continues the text of the previous record
+    uint16_t mLength;
+    char mText[kRecordTextSize];
+};
+
+//!
+//! \brief Single producer single consumer ring of one thread's messages
+//!
+struct ThreadRing
+{
+    explicit ThreadRing(uint32_t index)
+        : mIndex(index)
+    {
+    }
+
+    std::array<Record, kRingCapacity> mRecords;
+    std::atomic<uint64_t> mHead{0};
+    std::atomic<uint64_t> mTail{0};
+    std::atomic<uint64_t> mDropped{0};
+    std::atomic<bool> mReleased{false}; //!< Its thread ended, the ring goes to a new thread once drained
+    uint32_t mIndex;
+};
+
+struct Line
+{
+    int64_t mTimestampUs;
+    bool mError;
+    std::string mText;
+};
+
+const char* severityPrefix(Severity severity)
+{
+    switch (severity)
+    {
+    case Severity::kINTERNAL_ERROR: return "[F] ";
+    case Severity::kERROR: return "[E] ";
+    case Severity::kWARNING: return "[W] ";
+    case Severity::kINFO: return "[I] ";
+    case Severity::kVERBOSE: return "[V] ";
+    default: return "";
+    }
+}
+
+std::string formatHeader(int64_t timestampUs, Severity severity, uint32_t thread)
+{
+    std::time_t seconds = timestampUs / 1000000;
+    tm local;
+    localtime_r(&seconds, &local);
+    char header[64];
+    snprintf(header, sizeof(header), "[%02d/%02d/%04d-%02d:%02d:%02d.%03d] [t%u] %s", 1 + local.tm_mon,
+        local.tm_mday, 1900 + local.tm_year, local.tm_hour, local.tm_min, local.tm_sec,
+        static_cast<int>(timestampUs / 1000 % 1000), thread, severityPrefix(severity));
+    return header;
+}
+
+class Backend
+{
+public:
+    static Backend& instance()
+    {
+        static Backend backend;
+        return backend;
+    }
+
+    ThreadRing& threadRing()
+    {
+        thread_local RingOwner owner(registerThread());
+        return *owner.mRing;
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto requested = ++mFlushRequested;
+        mWake.notify_one();
+        mFlushed.wait(lock, [this, requested] { return mFlushDone >= requested || mStop; });
+    }
+
+    ~Backend()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_one();
+        mWriter.join();
+    }
+
+private:
+    //!
+    //! \brief Releases the ring of a thread when the thread ends, so short-lived threads do not add up
+    //!
+    struct RingOwner
+    {
+        explicit RingOwner(ThreadRing* ring)
+            : mRing(ring)
+        {
+        }
+
+        ~RingOwner()
+        {
+            mRing->mReleased.store(true, std::memory_order_release);
+        }
+
+        ThreadRing* mRing;
+    };
+
+    Backend()
+        : mWriter(&Backend::run, this)
+    {
+    }
+
+    //!
+    //! \brief Gives a ring released and drained, or a new one, to the calling thread
+    //!
+    ThreadRing* registerThread()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& ring : mRings)
+        {
+            // The writer drains with the mutex held, so an empty ring stays empty
+            if (ring->mReleased.load(std::memory_order_acquire)
+                && ring->mTail.load(std::memory_order_relaxed) == ring->mHead.load(std::memory_order_relaxed)
+                && ring->mDropped.load(std::memory_order_relaxed) == 0)
+            {
+                ring->mReleased.store(false, std::memory_order_relaxed);
+                return ring.get();
+            }
+        }
+
+        mRings.emplace_back(new ThreadRing(mRings.size()));
+        return mRings.back().get();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStop)
+        {
+            auto flushRequested = mFlushRequested;
+            drain();
+            mFlushDone = flushRequested;
+            mFlushed.notify_all();
+            mWake.wait_for(lock, kWritePeriod);
+        }
+
+        drain();
+        mFlushDone = mFlushRequested;
+        mFlushed.notify_all();
+    }
+
+    //!
+    //! \brief Writes out the messages of all the threads, called with the mutex held.
+    //!        Producers only take the mutex once, to register, so they are not held up.
+    //!
+    void drain()
+    {
+        mLines.clear();
+        for (auto& ring : mRings)
+        {
+            auto dropped = ring->mDropped.exchange(0, std::memory_order_relaxed);
+            if (dropped)
+            {
+                auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                mLines.push_back(Line{now, true,
+                    formatHeader(now, Severity::kWARNING, ring->mIndex) + std::to_string(dropped)
+                        + " log messages dropped\n"});
+            }
+
+            auto tail = ring->mTail.load(std::memory_order_relaxed);
+            auto head = ring->mHead.load(std::memory_order_acquire);
+            for (; tail != head; ++tail)
+            {
+                const auto& record = ring->mRecords[tail % kRingCapacity];
+                if (!record.mContinued || mLines.empty())
+                {
+                    mLines.push_back(Line{record.mTimestampUs, record.mSeverity < Severity::kINFO,
+                        formatHeader(record.mTimestampUs, record.mSeverity, ring->mIndex)});
+                }
+                mLines.back().mText.append(record.mText, record.mLength);
+            }
+            ring->mTail.store(tail, std::memory_order_release);
+        }
+
+        if (mLines.empty())
+        {
+            return;
+        }
+
+        // Lines of different threads come in per thread order
+        std::stable_sort(mLines.begin(), mLines.end(),
+            [](const Line& left, const Line& right) { return left.mTimestampUs < right.mTimestampUs; });
+
+        mOutput.clear();
+        mErrors.clear();
+        for (auto& line : mLines)
+        {
+            auto& output = line.mError ? mErrors : mOutput;
+            auto end = line.mText.find_last_not_of('\n');
+            output.append(line.mText, 0, end == std::string::npos ? 0 : end + 1);
+            output.push_back('\n');
+        }
+
+        fwrite(mOutput.data(), 1, mOutput.size(), stdout);
+        fflush(stdout);
+        fwrite(mErrors.data(), 1, mErrors.size(), stderr);
+        fflush(stderr);
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mFlushed;
+    uint64_t mFlushRequested{0};
+    uint64_t mFlushDone{0};
+    bool mStop{false};
+    std::vector<std::unique_ptr<ThreadRing>> mRings;
+    std::vector<Line> mLines;
+    std::string mOutput;
+    std::string mErrors;
+    std::thread mWriter;
+};
+
+} // anonymous namespace
+
+void setReportableSeverity(Severity severity)
+{
+    gReportableSeverity.store(static_cast<int>(severity), std::memory_order_relaxed);
+}
+
+void write(Severity severity, const char* message, size_t length)
+{
+    auto& ring = Backend::instance().threadRing();
+    auto timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto recordCount = std::max<size_t>(1, (length + kRecordTextSize - 1) / kRecordTextSize);
+
+    auto head = ring.mHead.load(std::memory_order_relaxed);
+    if (head + recordCount - ring.mTail.load(std::memory_order_acquire) > kRingCapacity)
+    {
+        ring.mDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    for (size_t i = 0; i < recordCount; ++i)
+    {
+        auto& record = ring.mRecords[(head + i) % kRingCapacity];
+        auto offset = i * kRecordTextSize;
+        record.mTimestampUs = timestampUs;
+        record.mSeverity = severity;
+        record.mContinued = i > 0;
+        record.mLength = std::min(kRecordTextSize, length - offset);
+        std::memcpy(record.mText, message + offset, record.mLength);
+    }
+
+    ring.mHead.store(head + recordCount, std::memory_order_release);
+}
+
+void flush()
+{
+    Backend::instance().flush();
+}
+
+} // namespace asyncLog
+} // namespace inference
@@ -0,0 +1,71 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include "NvInferRuntimeCommon.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+//!
+//! \brief Most verbose severity compiled in, as an nvinfer1::ILogger::Severity value.
+//!        Messages that are more verbose are eliminated at compile time.
+//!
+#ifndef INFERENCE_LOG_MAX_SEVERITY
+#define INFERENCE_LOG_MAX_SEVERITY 4 // kVERBOSE
+#endif
+
+namespace inference
+{
+namespace asyncLog
+{
+
+using Severity = nvinfer1::ILogger::Severity;
+
+//!
+//! \brief Whether messages of the severity are compiled in
+//!
+constexpr bool isCompiledIn(Severity severity)
+{
+    return static_cast<int>(severity) <= INFERENCE_LOG_MAX_SEVERITY;
+}
+
+//!
+//! \brief Runtime severity filter, kINFO by default
+//!
+extern std::atomic<int> gReportableSeverity;
+
+//!
+//! \brief Whether messages of the severity are compiled in and currently reported
+//!
+inline bool isEnabled(Severity severity)
+{
+    return isCompiledIn(severity)
+        && static_cast<int>(severity) <= gReportableSeverity.load(std::memory_order_relaxed);
+}
+
+void setReportableSeverity(Severity severity);
+
+//!
+//! \brief Queues the message into the calling thread's ring buffer.
+//!
+//! \details Never blocks and takes no lock after the first message of a thread.
+//!          A background thread orders the messages by time, formats them and writes them
+//!          in batches. Messages are dropped (and counted) when the ring is full.
+//!
+void write(Severity severity, const char* message, size_t length);
+
+inline void write(Severity severity, const std::string& message)
+{
+    write(severity, message.data(), message.size());
+}
+
+//!
+//! \brief Writes out everything queued so far and waits for it
+//!
+void flush();
+
+} // namespace asyncLog
+} // namespace inference
+
+#endif // ASYNC_LOG_H
@@ -20,19 +20,17 @@
 namespace inference
 {
 Logger gLogger{Logger::Severity::kINFO};
-LogStreamConsumer gLogVerbose{LOG_VERBOSE(gLogger)};
-LogStreamConsumer gLogInfo{LOG_INFO(gLogger)};
-LogStreamConsumer gLogWarning{LOG_WARN(gLogger)};
-LogStreamConsumer gLogError{LOG_ERROR(gLogger)};
-LogStreamConsumer gLogFatal{LOG_FATAL(gLogger)};
+// Created on the first use in a thread, so the filtering is left to asyncLog
+// to follow the reportable severity set later from another thread
+thread_local LogStreamConsumer gLogVerbose{Logger::Severity::kVERBOSE, Logger::Severity::kVERBOSE};
+thread_local LogStreamConsumer gLogInfo{Logger::Severity::kVERBOSE, Logger::Severity::kINFO};
+thread_local LogStreamConsumer gLogWarning{Logger::Severity::kVERBOSE, Logger::Severity::kWARNING};
+thread_local LogStreamConsumer gLogError{Logger::Severity::kVERBOSE, Logger::Severity::kERROR};
+thread_local LogStreamConsumer gLogFatal{Logger::Severity::kVERBOSE, Logger::Severity::kINTERNAL_ERROR};
 
 void setReportableSeverity(Logger::Severity severity)
 {
+    // Applies to the consumers of all the threads through asyncLog
     gLogger.setReportableSeverity(severity);
-    gLogVerbose.setReportableSeverity(severity);
-    gLogInfo.setReportableSeverity(severity);
-    gLogWarning.setReportableSeverity(severity);
-    gLogError.setReportableSeverity(severity);
-    gLogFatal.setReportableSeverity(severity);
 }
 } // namespace sample
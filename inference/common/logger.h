@@ -22,11 +22,13 @@
 namespace inference
 {
 extern Logger gLogger;
-extern LogStreamConsumer gLogVerbose;
-extern LogStreamConsumer gLogInfo;
-extern LogStreamConsumer gLogWarning;
-extern LogStreamConsumer gLogError;
-extern LogStreamConsumer gLogFatal;
+// Every thread streams into its own consumers,
+// which hand complete messages to the asyncLog writer thread
+extern thread_local LogStreamConsumer gLogVerbose;
+extern thread_local LogStreamConsumer gLogInfo;
+extern thread_local LogStreamConsumer gLogWarning;
+extern thread_local LogStreamConsumer gLogError;
+extern thread_local LogStreamConsumer gLogFatal;
 
 void setReportableSeverity(Logger::Severity severity);
 } // namespace sample
@@ -18,6 +18,7 @@
 #define TENSORRT_LOGGING_H
 
 #include "NvInferRuntimeCommon.h"
+#include "asyncLog.h"
 #include <cassert>
 #include <ctime>
 #include <iomanip>
@@ -34,15 +35,15 @@ using Severity = nvinfer1::ILogger::Severity;
 class LogStreamConsumerBuffer : public std::stringbuf
 {
 public:
-    LogStreamConsumerBuffer(std::ostream& stream, const std::string& prefix, bool shouldLog)
-        : mOutput(stream)
+    LogStreamConsumerBuffer(Severity severity, const std::string& prefix, bool shouldLog)
+        : mSeverity(severity)
         , mPrefix(prefix)
         , mShouldLog(shouldLog)
     {
     }
 
     LogStreamConsumerBuffer(LogStreamConsumerBuffer&& other)
-        : mOutput(other.mOutput)
+        : mSeverity(other.mSeverity)
         , mPrefix(other.mPrefix)
         , mShouldLog(other.mShouldLog)
     {
@@ -61,8 +62,8 @@ public:
     }
 
     // synchronizes the stream buffer and returns 0 on success
-    // synchronizing the stream buffer consists of inserting the buffer contents into the stream,
-    // resetting the buffer and flushing the stream
+    // synchronizing the stream buffer consists of handing the buffer contents to the log writer
+    // and resetting the buffer
     virtual int sync()
     {
         putOutput();
@@ -71,26 +72,14 @@ public:
 
     void putOutput()
     {
-        if (mShouldLog)
+        if (mShouldLog && asyncLog::isEnabled(mSeverity))
         {
-            // prepend timestamp
-            std::time_t timestamp = std::time(nullptr);
-            tm* tm_local = std::localtime(&timestamp);
-            std::cout << "[";
-            std::cout << std::setw(2) << std::setfill('0') << 1 + tm_local->tm_mon << "/";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_mday << "/";
-            std::cout << std::setw(4) << std::setfill('0') << 1900 + tm_local->tm_year << "-";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_hour << ":";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_min << ":";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_sec << "] ";
+            // the log writer thread prepends the timestamp and the severity
             // std::stringbuf::str() gets the string contents of the buffer
-            // insert the buffer contents pre-appended by the appropriate prefix into the stream
-            mOutput << mPrefix << str();
-            // set the buffer to empty
-            str("");
-            // flush the stream
-            mOutput.flush();
+            asyncLog::write(mSeverity, mPrefix.empty() ? str() : mPrefix + str());
         }
+        // set the buffer to empty
+        str("");
     }
 
     void setShouldLog(bool shouldLog)
@@ -99,7 +88,7 @@ public:
     }
 
 private:
-    std::ostream& mOutput;
+    Severity mSeverity;
     std::string mPrefix;
     bool mShouldLog;
 };
@@ -111,8 +100,8 @@ private:
 class LogStreamConsumerBase
 {
 public:
-    LogStreamConsumerBase(std::ostream& stream, const std::string& prefix, bool shouldLog)
-        : mBuffer(stream, prefix, shouldLog)
+    LogStreamConsumerBase(Severity severity, const std::string& prefix, bool shouldLog)
+        : mBuffer(severity, prefix, shouldLog)
     {
     }
 
@@ -134,8 +123,9 @@ class LogStreamConsumer : protected LogStreamConsumerBase, public std::ostream
 public:
     //! \brief Creates a LogStreamConsumer which logs messages with level severity.
     //!  Reportable severity determines if the messages are severe enough to be logged.
+    //!  The messages are written by the asyncLog writer thread.
     LogStreamConsumer(Severity reportableSeverity, Severity severity)
-        : LogStreamConsumerBase(severityOstream(severity), severityPrefix(severity), severity <= reportableSeverity)
+        : LogStreamConsumerBase(severity, "", severity <= reportableSeverity)
         , std::ostream(&mBuffer) // links the stream buffer with the stream
         , mShouldLog(severity <= reportableSeverity)
         , mSeverity(severity)
@@ -143,7 +133,7 @@ public:
     }
 
     LogStreamConsumer(LogStreamConsumer&& other)
-        : LogStreamConsumerBase(severityOstream(other.mSeverity), severityPrefix(other.mSeverity), other.mShouldLog)
+        : LogStreamConsumerBase(other.mSeverity, "", other.mShouldLog)
         , std::ostream(&mBuffer) // links the stream buffer with the stream
         , mShouldLog(other.mShouldLog)
         , mSeverity(other.mSeverity)
@@ -157,24 +147,6 @@ public:
     }
 
 private:
-    static std::ostream& severityOstream(Severity severity)
-    {
-        return severity >= Severity::kINFO ? std::cout : std::cerr;
-    }
-
-    static std::string severityPrefix(Severity severity)
-    {
-        switch (severity)
-        {
-        case Severity::kINTERNAL_ERROR: return "[F] ";
-        case Severity::kERROR: return "[E] ";
-        case Severity::kWARNING: return "[W] ";
-        case Severity::kINFO: return "[I] ";
-        case Severity::kVERBOSE: return "[V] ";
-        default: assert(0); return "";
-        }
-    }
-
     bool mShouldLog;
     Severity mSeverity;
 };
@@ -209,6 +181,7 @@ public:
     Logger(Severity severity = Severity::kWARNING)
         : mReportableSeverity(severity)
     {
+        asyncLog::setReportableSeverity(severity);
     }
 
     //!
@@ -254,6 +227,7 @@ public:
     void setReportableSeverity(Severity severity)
     {
         mReportableSeverity = severity;
+        asyncLog::setReportableSeverity(severity);
     }
 
     //!
@@ -0,0 +1,442 @@
+#include "micro_benchmark.h"
+
+#include "half.h"
+#include "frames/change_detector.h"
+#include "frames/files_iterator.h"
+#include "frames/jpeg_encoder.h"
+#include "frames/jpeg_overlay.h"
+#include "http/query.h"
+#include "http/routing.h"
+#include "inference/hostProcessing.h"
+#include "inference/tiling.h"
+
+#include <boost/filesystem.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmarks of the per-frame hot path on synthetic fixtures,
+// no GPU, engine or model file is needed.
+
+namespace
+{
+
+const int kDetectionsCount = 4420; // anchors of the 320x240 UltraFace model
+
+UltraFaceInferenceParams make_params(int width, int height, int batch_size)
+{
+    UltraFaceInferenceParams params;
+    params.inputTensorNames.push_back("input");
+    params.mInputDims = nvinfer1::Dims4(batch_size, 3, height, width);
+    params.mPreprocessingMeans = {127.0f, 127.0f, 127.0f};
+    params.mPreprocessingNorm = 128.0f;
+    params.mDetectionsCount = kDetectionsCount;
+    params.mNumClasses = 2;
+    params.mDetectionClassIndex = 1;
+    params.mDetectionThreshold = 0.9f;
+    return params;
+}
+
+cv::Mat make_frame(int width, int height)
+{
+    cv::Mat frame(height, width, CV_8UC3);
+    cv::theRNG().state = 42;
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+    return frame;
+}
+
+// Scores and boxes as the model outputs them, density_permille of the anchors score above the threshold
+struct model_output
+{
+    model_output(int density_permille)
+        :m_scores(kDetectionsCount * 2),
+        m_boxes(kDetectionsCount * Detection::mNumCorners)
+    {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (int i = 0; i < kDetectionsCount; ++i)
+        {
+            bool face = static_cast<int>(random() % 1000) < density_permille;
+            m_scores[i * 2 + 1] = face ? 0.9f + 0.1f * unit(random) : 0.5f * unit(random);
+            m_scores[i * 2] = 1.0f - m_scores[i * 2 + 1];
+
+            auto size = 0.05f + 0.1f * unit(random);
+            auto left = (1.0f - size) * unit(random);
+            auto top = (1.0f - size) * unit(random);
+            float* box = &m_boxes[i * Detection::mNumCorners];
+            box[0] = left;
+            box[1] = top;
+            box[2] = left + size;
+            box[3] = top + size;
+        }
+    }
+
+    std::vector<float> m_scores;
+    std::vector<float> m_boxes;
+};
+
+// Directory of empty frame files, removed with the fixture
+class frames_directory
+{
+public:
+    explicit frames_directory(long files_count)
+        :m_path(boost::filesystem::temp_directory_path()
+            / boost::filesystem::unique_path("ultraface-bench-%%%%-%%%%"))
+    {
+        boost::filesystem::create_directories(m_path / "images");
+        for (long i = 0; i < files_count; ++i)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%06ld.jpg", i);
+            std::ofstream((m_path / "images" / name).string());
+        }
+    }
+
+    ~frames_directory()
+    {
+        boost::system::error_code ignored;
+        boost::filesystem::remove_all(m_path, ignored);
+    }
+
+    std::string get_base_dir() const
+    {
+        return m_path.string();
+    }
+
+    std::string get_images_dir() const
+    {
+        return (m_path / "images").string();
+    }
+
+private:
+    boost::filesystem::path m_path;
+};
+
+// Directories are created once per size, the harness calls a benchmark several times
+const frames_directory& get_frames_directory(long files_count)
+{
+    static std::map<long, std::unique_ptr<frames_directory>> directories;
+    auto& directory = directories[files_count];
+    if (!directory)
+    {
+        directory.reset(new frames_directory(files_count));
+    }
+    return *directory;
+}
+
+} // anonymous namespace
+
+void BM_preprocess_batch(benchmark_state& state)
+{
+    auto width = state.range(0);
+    auto height = state.range(1);
+    auto batch_size = state.range(2);
+    auto params = make_params(width, height, batch_size);
+    std::vector<cv::Mat> batch(batch_size, make_frame(width, height));
+    std::vector<float> input(batch_size * 3 * width * height);
+
+    while (state.keep_running())
+    {
+        preprocessBatch(batch, params, input.data());
+        do_not_optimize(input.data());
+    }
+
+    state.set_items_processed(state.iterations() * batch_size);
+    state.set_bytes_processed(state.iterations() * batch_size * width * height * 3);
+}
+MICRO_BENCHMARK(BM_preprocess_batch)
+    ->args({320, 240, 1})
+    ->args({320, 240, 4})
+    ->args({640, 480, 1})
+    ->args({640, 480, 4})
+    ->args({1280, 960, 1});
+
+void BM_parse_detections(benchmark_state& state)
+{
+    auto params = make_params(320, 240, 1);
+    model_output output(state.range(0));
+    std::vector<Detection> detections;
+
+    while (state.keep_running())
+    {
+        detections.clear();
+        parseDetections(output.m_scores.data(), output.m_boxes.data(), params, detections);
+        do_not_optimize(detections.data());
+    }
+
+    state.set_items_processed(state.iterations() * kDetectionsCount);
+    state.set_label(std::to_string(detections.size()) + " detections");
+}
+// Faces per thousand anchors
+MICRO_BENCHMARK(BM_parse_detections)
+    ->args({0})
+    ->args({1})
+    ->args({10})
+    ->args({100});
+
+void BM_query_parse(benchmark_state& state)
+{
+    const std::string query_string = "/filesystem/images/session_01?ext=jpg&publish=faces";
+
+    while (state.keep_running())
+    {
+        query q(query_string);
+        do_not_optimize(q.m_parameters.data());
+    }
+}
+MICRO_BENCHMARK(BM_query_parse);
+
+void BM_routing_create_reader(benchmark_state& state)
+{
+    const auto& directory = get_frames_directory(state.range(0));
+    routing routes({{"base_dir", directory.get_base_dir()}});
+    query q("/filesystem/images?ext=jpg");
+
+    while (state.keep_running())
+    {
+        auto reader = routes.create_reader(q.m_path[0], q);
+        do_not_optimize(reader.get());
+    }
+}
+MICRO_BENCHMARK(BM_routing_create_reader)
+    ->args({100});
+
+void BM_imencode(benchmark_state& state)
+{
+    auto frame = make_frame(640, 480);
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, static_cast<int>(state.range(0))};
+    std::vector<uchar> buffer;
+
+    while (state.keep_running())
+    {
+        cv::imencode(".jpg", frame, buffer, params);
+        do_not_optimize(buffer.data());
+    }
+
+    state.set_bytes_processed(state.iterations() * frame.total() * frame.elemSize());
+    state.set_label(std::to_string(buffer.size()) + " bytes");
+}
+// JPEG quality
+MICRO_BENCHMARK(BM_imencode)
+    ->args({50})
+    ->args({75})
+    ->args({95});
+
+void BM_jpeg_encoder(benchmark_state& state)
+{
+    auto frame = make_frame(state.range(0), state.range(1));
+    jpeg_encoder_params params;
+    params.m_threads = state.range(2);
+    params.m_parallel_min_pixels = 0;
+    jpeg_encoder_pool::configure(params);
+    jpeg_settings settings;
+    std::vector<uchar> buffer;
+
+    while (state.keep_running())
+    {
+        jpeg_encoder_pool::encode(frame, settings, buffer);
+        do_not_optimize(buffer.data());
+    }
+
+    jpeg_encoder_pool::stop();
+    state.set_bytes_processed(state.iterations() * frame.total() * frame.elemSize());
+    state.set_label(std::to_string(buffer.size()) + " bytes");
+}
+// Width, height, pool threads encoding the stripes, quality 95 as BM_imencode/95
+MICRO_BENCHMARK(BM_jpeg_encoder)
+    ->args({640, 480, 0})
+    ->args({3840, 2160, 0})
+    ->args({3840, 2160, 3});
+
+void BM_jpeg_overlay(benchmark_state& state)
+{
+    std::vector<uchar> source;
+    cv::imencode(".jpg", make_frame(640, 480), source, std::vector<int>{cv::IMWRITE_JPEG_QUALITY, 95});
+    std::vector<Detection> detections;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        float left = 0.05f + 0.2f * (i % 4);
+        float top = 0.05f + 0.3f * (i / 4 % 3);
+        detections.emplace_back(0.95f, std::array<float, Detection::mNumCorners>{{left, top, left + 0.15f, top + 0.25f}});
+    }
+    jpeg_overlay overlay;
+    std::vector<uchar> buffer;
+
+    while (state.keep_running())
+    {
+        overlay.draw_boxes(source, detections, cv::Scalar(0, 0, 255), buffer);
+        do_not_optimize(buffer.data());
+    }
+
+    state.set_items_processed(state.iterations());
+    state.set_label(std::to_string(buffer.size()) + " bytes");
+}
+// Boxes drawn into a quality 95 JPEG, compare with BM_imencode/95
+MICRO_BENCHMARK(BM_jpeg_overlay)
+    ->args({1})
+    ->args({4})
+    ->args({12});
+
+// A context of batch size 1 without any detections, for the cost of cutting and resizing the tiles
+class null_context : public InferenceContext
+{
+public:
+    bool infer(const std::vector<cv::Mat>&, std::vector<Detection>& detections) override
+    {
+        detections.clear();
+        return true;
+    }
+
+    bool infer_batch(const std::vector<cv::Mat>& batch, std::vector<std::vector<Detection>>& detections) override
+    {
+        detections.assign(batch.size(), std::vector<Detection>());
+        return true;
+    }
+
+    int get_max_batch_size() const override
+    {
+        return 1;
+    }
+
+    int get_input_height() const override
+    {
+        return 240;
+    }
+
+    int get_input_width() const override
+    {
+        return 320;
+    }
+};
+
+void BM_infer_tiles(benchmark_state& state)
+{
+    auto frame = make_frame(1920, 1080);
+    auto reference = frame.clone();
+    null_context context;
+
+    // Regions of the input size and larger ones after them, as getDetectionRegions gives them
+    std::vector<Detection> previous;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        float left = 0.05f + 0.2f * (i % 4);
+        float size = (i % 2) ? 0.25f : 0.05f;
+        previous.emplace_back(0.95f, std::array<float, Detection::mNumCorners>{{left, 0.3f, left + size, 0.3f + size}});
+    }
+    auto regions = getDetectionRegions(frame.size(), cv::Size(320, 240), previous, 2.0f);
+    std::vector<Detection> detections;
+
+    while (state.keep_running())
+    {
+        inferTiles(context, frame, regions, detections);
+        do_not_optimize(detections.data());
+    }
+
+    // The tiles are views of the frame, none of them may be written to
+    if (cv::norm(frame, reference, cv::NORM_INF) != 0)
+    {
+        fprintf(stderr, "BM_infer_tiles: inferTiles modified the frame\n");
+        std::abort();
+    }
+
+    state.set_items_processed(state.iterations() * regions.size());
+}
+// Regions around the previous detections of a 1080p frame
+MICRO_BENCHMARK(BM_infer_tiles)
+    ->args({2})
+    ->args({8});
+
+void BM_change_detector(benchmark_state& state)
+{
+    auto width = state.range(0);
+    auto height = state.range(1);
+    auto frame = make_frame(width, height);
+    // Above any change and without refresh, every frame is compared with the same reference
+    change_detector detector(256, 0);
+    detector.is_changed(frame);
+
+    while (state.keep_running())
+    {
+        do_not_optimize(detector.is_changed(frame));
+    }
+
+    state.set_items_processed(state.iterations());
+    state.set_bytes_processed(state.iterations() * width * height * 3);
+}
+MICRO_BENCHMARK(BM_change_detector)
+    ->args({640, 480})
+    ->args({1920, 1080});
+
+void BM_files_iterator(benchmark_state& state)
+{
+    const auto& directory = get_frames_directory(state.range(0));
+
+    while (state.keep_running())
+    {
+        files_iterator files(directory.get_images_dir(), ".jpg");
+        do_not_optimize(files.is_finished());
+    }
+
+    state.set_items_processed(state.iterations() * state.range(0));
+}
+MICRO_BENCHMARK(BM_files_iterator)
+    ->args({1000})
+    ->args({10000});
+
+void BM_half_from_float(benchmark_state& state)
+{
+    std::vector<float> values(state.range(0));
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (auto& value : values)
+    {
+        value = distribution(random);
+    }
+    std::vector<half_float::half> halfs(values.size());
+
+    while (state.keep_running())
+    {
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            halfs[i] = half_float::half(values[i]);
+        }
+        do_not_optimize(halfs.data());
+    }
+
+    state.set_items_processed(state.iterations() * values.size());
+}
+MICRO_BENCHMARK(BM_half_from_float)
+    ->args({1 << 16});
+
+void BM_half_to_float(benchmark_state& state)
+{
+    std::vector<half_float::half> halfs(state.range(0));
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (auto& value : halfs)
+    {
+        value = half_float::half(distribution(random));
+    }
+    std::vector<float> values(halfs.size());
+
+    while (state.keep_running())
+    {
+        for (size_t i = 0; i < halfs.size(); ++i)
+        {
+            values[i] = halfs[i];
+        }
+        do_not_optimize(values.data());
+    }
+
+    state.set_items_processed(state.iterations() * halfs.size());
+}
+MICRO_BENCHMARK(BM_half_to_float)
+    ->args({1 << 16});
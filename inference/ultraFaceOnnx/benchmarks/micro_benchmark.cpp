@@ -0,0 +1,363 @@
+#include "micro_benchmark.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+int64_t get_thread_cpu_time_ns()
+{
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+std::vector<std::unique_ptr<benchmark>>& get_registry()
+{
+    static std::vector<std::unique_ptr<benchmark>> registry;
+    return registry;
+}
+
+struct run_result
+{
+    std::string m_name;
+    std::string m_label;
+    uint64_t m_iterations;
+    double m_real_time_ns;
+    double m_cpu_time_ns;
+    double m_items_per_second;
+    double m_bytes_per_second;
+};
+
+std::string get_run_name(const benchmark& bench, const std::vector<long>& args)
+{
+    std::string name = bench.get_name();
+    for (auto arg : args)
+    {
+        name += "/" + std::to_string(arg);
+    }
+    return name;
+}
+
+// Grows the iterations count until a run lasts the minimal time, like Google Benchmark does
+run_result run(const benchmark& bench, const std::vector<long>& args, double min_time_s)
+{
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        benchmark_state state(args, iterations);
+        bench.get_function()(state);
+
+        auto real_time_s = state.get_real_time_ns() / 1e9;
+        if ((real_time_s >= min_time_s) || (iterations >= 1000000000))
+        {
+            run_result result;
+            result.m_name = get_run_name(bench, args);
+            result.m_label = state.get_label();
+            result.m_iterations = state.iterations();
+            result.m_real_time_ns = state.get_real_time_ns() / state.iterations();
+            result.m_cpu_time_ns = state.get_cpu_time_ns() / state.iterations();
+            result.m_items_per_second = real_time_s > 0 ? state.get_items_processed() / real_time_s : 0;
+            result.m_bytes_per_second = real_time_s > 0 ? state.get_bytes_processed() / real_time_s : 0;
+            return result;
+        }
+
+        // Aim a bit past the minimal time, at most 10x more iterations per step
+        auto multiplier = real_time_s > 0 ? min_time_s * 1.4 / real_time_s : 10.0;
+        multiplier = std::min(std::max(multiplier, 2.0), 10.0);
+        iterations = static_cast<uint64_t>(iterations * multiplier);
+    }
+}
+
+std::string json_string(const std::string& value)
+{
+    std::string result = "\"";
+    for (auto c : value)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+void write_json(std::ostream& out, const std::vector<run_result>& results)
+{
+    char date[64];
+    auto now = std::time(nullptr);
+    tm local;
+    localtime_r(&now, &local);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &local);
+
+    char host_name[256] = {};
+    gethostname(host_name, sizeof(host_name) - 1);
+
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"date\": " << json_string(date) << ",\n"
+        << "    \"host_name\": " << json_string(host_name) << ",\n"
+        << "    \"executable\": \"micro_benchmarks\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n"
+#endif
+        << "  },\n"
+        << "  \"benchmarks\": [";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\n"
+            << "      \"name\": " << json_string(result.m_name) << ",\n"
+            << "      \"run_name\": " << json_string(result.m_name) << ",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << result.m_iterations << ",\n"
+            << "      \"real_time\": " << result.m_real_time_ns << ",\n"
+            << "      \"cpu_time\": " << result.m_cpu_time_ns << ",\n"
+            << "      \"time_unit\": \"ns\"";
+        if (result.m_items_per_second > 0)
+        {
+            out << ",\n      \"items_per_second\": " << result.m_items_per_second;
+        }
+        if (result.m_bytes_per_second > 0)
+        {
+            out << ",\n      \"bytes_per_second\": " << result.m_bytes_per_second;
+        }
+        if (!result.m_label.empty())
+        {
+            out << ",\n      \"label\": " << json_string(result.m_label);
+        }
+        out << "\n    }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+} // anonymous namespace
+
+benchmark_state::benchmark_state(const std::vector<long>& args, uint64_t max_iterations)
+    :m_args(args),
+    m_max_iterations(max_iterations)
+{
+}
+
+bool benchmark_state::keep_running()
+{
+    if (!m_running && (m_iterations == 0))
+    {
+        start_timer();
+    }
+
+    if (m_iterations < m_max_iterations)
+    {
+        ++m_iterations;
+        return true;
+    }
+
+    if (m_running)
+    {
+        stop_timer();
+    }
+    return false;
+}
+
+long benchmark_state::range(size_t index) const
+{
+    return m_args.at(index);
+}
+
+uint64_t benchmark_state::iterations() const
+{
+    return m_iterations;
+}
+
+void benchmark_state::pause_timing()
+{
+    stop_timer();
+}
+
+void benchmark_state::resume_timing()
+{
+    start_timer();
+}
+
+void benchmark_state::set_items_processed(int64_t items)
+{
+    m_items_processed = items;
+}
+
+void benchmark_state::set_bytes_processed(int64_t bytes)
+{
+    m_bytes_processed = bytes;
+}
+
+void benchmark_state::set_label(const std::string& label)
+{
+    m_label = label;
+}
+
+double benchmark_state::get_real_time_ns() const
+{
+    return std::chrono::duration<double, std::nano>(m_real_time).count();
+}
+
+double benchmark_state::get_cpu_time_ns() const
+{
+    return static_cast<double>(m_cpu_time_ns);
+}
+
+int64_t benchmark_state::get_items_processed() const
+{
+    return m_items_processed;
+}
+
+int64_t benchmark_state::get_bytes_processed() const
+{
+    return m_bytes_processed;
+}
+
+const std::string& benchmark_state::get_label() const
+{
+    return m_label;
+}
+
+void benchmark_state::start_timer()
+{
+    m_running = true;
+    m_real_start = std::chrono::steady_clock::now();
+    m_cpu_start_ns = get_thread_cpu_time_ns();
+}
+
+void benchmark_state::stop_timer()
+{
+    m_real_time += std::chrono::steady_clock::now() - m_real_start;
+    m_cpu_time_ns += get_thread_cpu_time_ns() - m_cpu_start_ns;
+    m_running = false;
+}
+
+benchmark::benchmark(const std::string& name, benchmark_function function)
+    :m_name(name),
+    m_function(function)
+{
+}
+
+benchmark* benchmark::args(std::initializer_list<long> values)
+{
+    m_args.emplace_back(values);
+    return this;
+}
+
+const std::string& benchmark::get_name() const
+{
+    return m_name;
+}
+
+benchmark_function benchmark::get_function() const
+{
+    return m_function;
+}
+
+const std::vector<std::vector<long>>& benchmark::get_args() const
+{
+    return m_args;
+}
+
+benchmark* register_benchmark(const std::string& name, benchmark_function function)
+{
+    get_registry().emplace_back(new benchmark(name, function));
+    return get_registry().back().get();
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string output;
+    double min_time;
+    bool list = false;
+
+    po::options_description desc;
+    desc.add_options()
+        ("filter,f", po::value<std::string>(&filter), "Runs only the benchmarks with the substring in their name.")
+        ("min_time,m", po::value<double>(&min_time)->default_value(0.5), "Minimal time of a run in seconds.")
+        ("output,o", po::value<std::string>(&output), "Write the JSON results into the file instead of stdout.")
+        ("list,l", po::bool_switch(&list), "Lists the benchmarks without running them.");
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<run_result> results;
+    for (const auto& bench : get_registry())
+    {
+        auto args_list = bench->get_args();
+        if (args_list.empty())
+        {
+            args_list.emplace_back();
+        }
+
+        for (const auto& args : args_list)
+        {
+            auto name = get_run_name(*bench, args);
+            if (name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+
+            if (list)
+            {
+                std::cout << name << std::endl;
+                continue;
+            }
+
+            results.push_back(run(*bench, args, min_time));
+            const auto& result = results.back();
+            // Progress goes to stderr, so stdout has only the JSON
+            fprintf(stderr, "%-48s %14.0f ns %14.0f ns %12lu\n",
+                result.m_name.c_str(), result.m_real_time_ns, result.m_cpu_time_ns,
+                static_cast<unsigned long>(result.m_iterations));
+        }
+    }
+
+    if (list)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    if (!output.empty())
+    {
+        std::ofstream file(output);
+        write_json(file, results);
+    }
+    else
+    {
+        write_json(std::cout, results);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#ifndef MICRO_BENCHMARK_H
+#define MICRO_BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// A minimal harness in the style of Google Benchmark, so the suite builds
+// without extra dependencies. Its JSON output follows the Google Benchmark
+// format, so its tools (e.g. compare.py) can diff two runs.
+//
+//   void BM_something(benchmark_state& state)
+//   {
+//       auto fixture = make_fixture(state.range(0));
+//       while (state.keep_running())
+//       {
+//           something(fixture);
+//       }
+//       state.set_items_processed(state.iterations() * state.range(0));
+//   }
+//   MICRO_BENCHMARK(BM_something)->args({100})->args({10000});
+
+class benchmark_state
+{
+public:
+    benchmark_state(const std::vector<long>& args, uint64_t max_iterations);
+
+    // Times the loop, the code before the first call is the untimed setup
+    bool keep_running();
+
+    long range(size_t index) const;
+
+    uint64_t iterations() const;
+
+    // Excludes the code between the calls from the timing, e.g. per iteration fixture resets
+    void pause_timing();
+    void resume_timing();
+
+    void set_items_processed(int64_t items);
+    void set_bytes_processed(int64_t bytes);
+    void set_label(const std::string& label);
+
+    double get_real_time_ns() const;
+    double get_cpu_time_ns() const;
+    int64_t get_items_processed() const;
+    int64_t get_bytes_processed() const;
+    const std::string& get_label() const;
+
+private:
+    void start_timer();
+    void stop_timer();
+
+    std::vector<long> m_args;
+    uint64_t m_max_iterations;
+    uint64_t m_iterations = 0;
+    bool m_running = false;
+    std::chrono::steady_clock::time_point m_real_start;
+    int64_t m_cpu_start_ns = 0;
+    std::chrono::steady_clock::duration m_real_time{0};
+    int64_t m_cpu_time_ns = 0;
+    int64_t m_items_processed = 0;
+    int64_t m_bytes_processed = 0;
+    std::string m_label;
+};
+
+typedef void (*benchmark_function)(benchmark_state&);
+
+class benchmark
+{
+public:
+    benchmark(const std::string& name, benchmark_function function);
+
+    // Adds a run with the arguments, a benchmark without any runs once without arguments
+    benchmark* args(std::initializer_list<long> values);
+
+    const std::string& get_name() const;
+    benchmark_function get_function() const;
+    const std::vector<std::vector<long>>& get_args() const;
+
+private:
+    std::string m_name;
+    benchmark_function m_function;
+    std::vector<std::vector<long>> m_args;
+};
+
+benchmark* register_benchmark(const std::string& name, benchmark_function function);
+
+// Keeps the compiler from optimizing away a computed value
+template <class T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#define MICRO_BENCHMARK_CONCAT_(a, b) a##b
+#define MICRO_BENCHMARK_CONCAT(a, b) MICRO_BENCHMARK_CONCAT_(a, b)
+#define MICRO_BENCHMARK(function) \
+    static benchmark* MICRO_BENCHMARK_CONCAT(function##_registration_, __LINE__) \
+        = register_benchmark(#function, function)
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Tells the frames worth an inference from the ones showing the same static scene.
+// Every frame is shrunk to a grayscale thumbnail and compared block by block
+// with the thumbnail of the last inferred frame. The change of a frame is the mean
+// absolute pixel difference of its most changed block, so a face entering a corner
+// counts, while the sensor noise spread over the whole scene does not.
+class change_detector
+{
+public:
+    // threshold: the change in gray levels from which a frame is inferred.
+    // refresh_interval: frames after which a frame is inferred anyway, 0 never.
+    change_detector(int threshold, int refresh_interval);
+
+    // True if the frame needs an inference, it becomes the reference then
+    bool is_changed(const cv::Mat& frame);
+
+    uint64_t get_inferred_count() const;
+
+    uint64_t get_skipped_count() const;
+
+private:
+    // The mean absolute difference of the most changed block
+    int get_change();
+
+    static const int s_width = 64;
+    static const int s_height = 48;
+    static const int s_block_size = 8;
+
+    int m_threshold;
+    int m_refresh_interval;
+    int m_frames_since_inference = 0;
+    bool m_has_reference = false;
+    cv::Mat m_small;
+    cv::Mat m_thumbnail;
+    cv::Mat m_reference;
+    std::vector<uint32_t> m_block_sums;
+    uint64_t m_inferred_count = 0;
+    uint64_t m_skipped_count = 0;
+};
+
+#endif
@@ -20,5 +20,9 @@ private:
     std::vector<std::string>::iterator m_current;
 };
 
+// Reads a whole file into the buffer, sized from the file, with no per byte copy.
+// Leaves the buffer empty when the file cannot be read.
+bool read_file(const std::string& path, std::vector<unsigned char>& content);
+
 
 #endif 
\ No newline at end of file
@@ -17,8 +17,17 @@ public:
     
     cv::Mat read_frame() override;
 
+    // The path, device, inode, size and modification time of the next file, so a replaced file is another frame
+    std::string get_frame_identity() override;
+
+    void skip_frame() override;
+
+    const std::vector<uchar>* get_encoded_frame() const override;
+
 private:
     files_iterator m_files_iterator;
+
+    std::vector<uchar> m_encoded_frame;
 };
 
 #endif
\ No newline at end of file
@@ -2,12 +2,27 @@
 #define FRAME_READER_H
 
 #include <opencv2/imgproc/imgproc.hpp>
+#include <string>
+#include <vector>
 
 class frame_reader
 {
 public:
     virtual bool is_finished() = 0;
     virtual cv::Mat read_frame() = 0;
+    // Identifies the frame the next read_frame returns without reading it, e.g. for caching its detections.
+    // Empty if the source cannot tell, e.g. a live one.
+    virtual std::string get_frame_identity() { return std::string(); }
+    // Moves past the next frame, without decoding it if the source allows
+    virtual void skip_frame() { read_frame(); }
+    // The encoded bytes of the frame the last read_frame returned, nullptr if the source only has pixels
+    virtual const std::vector<uchar>* get_encoded_frame() const { return nullptr; }
+    // True if the last read_frame returned no frame only because the source has none yet,
+    // the caller comes back later rather than blocking on it
+    virtual bool is_waiting() const { return false; }
+    // True if the frame the last read_frame returned is a view of memory the source shares,
+    // which must be copied before drawing on it
+    virtual bool is_frame_shared() const { return false; }
     virtual ~frame_reader() = default;
 };
 
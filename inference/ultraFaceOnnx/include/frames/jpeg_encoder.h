@@ -0,0 +1,72 @@
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct jpeg_settings
+{
+    int m_quality = 95;
+    bool m_subsampling = true;      // 4:2:0 chroma, 4:4:4 otherwise
+    bool m_fast_dct = false;        // the faster, less accurate integer DCT
+    bool m_optimize = false;        // Huffman tables of the frame, smaller but a second pass
+    bool m_progressive = false;
+};
+
+// Tells the outputs of different settings apart, e.g. in the output cache key
+std::string get_jpeg_settings_key(const jpeg_settings& settings);
+
+// A libjpeg compressor kept from frame to frame, writing straight into the output.
+// The output is sized up front from the previous frame, so it rarely grows while encoding.
+class jpeg_encoder
+{
+public:
+    jpeg_encoder();
+
+    ~jpeg_encoder();
+
+    jpeg_encoder(const jpeg_encoder&) = delete;
+    jpeg_encoder& operator=(const jpeg_encoder&) = delete;
+
+    // Encodes the rows of a BGR frame as a JPEG of their own, all of them by default.
+    // Returns false if libjpeg fails.
+    bool encode(
+        const cv::Mat& frame,
+        const jpeg_settings& settings,
+        std::vector<uchar>& output,
+        int first_row = 0,
+        int row_count = -1);
+
+private:
+    // The libjpeg structures, kept out of the header
+    struct state;
+    std::unique_ptr<state> m_state;
+};
+
+struct jpeg_encoder_params
+{
+    int m_threads = 0;                          // encoding the stripes of a large frame, besides the caller
+    size_t m_parallel_min_pixels = 3840 * 1080; // frames from which they do
+};
+
+// Encodes the frames with a compressor per thread. The large frames are cut into
+// stripes of whole MCU rows encoded in parallel on the pool threads, and spliced
+// into a single JPEG with a restart marker between two stripes, which the restart
+// interval of the JPEG makes valid. Optimized and progressive JPEGs are encoded
+// on the calling thread, their stripes cannot share the Huffman tables or the scans.
+class jpeg_encoder_pool
+{
+public:
+    // Starts the pool threads, without them every frame is encoded on the calling thread
+    static void configure(const jpeg_encoder_params& params);
+
+    static void stop();
+
+    static bool encode(const cv::Mat& frame, const jpeg_settings& settings, std::vector<uchar>& output);
+};
+
+#endif
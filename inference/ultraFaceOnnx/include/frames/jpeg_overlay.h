@@ -0,0 +1,65 @@
+#ifndef JPEG_OVERLAY_H
+#define JPEG_OVERLAY_H
+
+#include "../inference/detection.h"
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Draws the boxes of the detections into a JPEG without decoding and encoding it again.
+// The DCT coefficients of the source are read with libjpeg, only the 8x8 blocks the
+// box edges cross are transformed back to samples, drawn on and quantized again with
+// the tables of the source, every other block is copied through as it is.
+// The lines look like the ones of cv::rectangle with a thickness of 1, except that
+// in subsampled chroma they are as wide as a chroma sample.
+class jpeg_overlay
+{
+public:
+    jpeg_overlay();
+
+    // Writes the source with the boxes drawn to the output.
+    // Returns false if the source is not a JPEG it can patch, e.g. not YCbCr
+    // or rotated by its EXIF orientation, the frame must be encoded in full then.
+    bool draw_boxes(
+        const std::vector<uchar>& source,
+        const std::vector<Detection>& detections,
+        const cv::Scalar& color,
+        std::vector<uchar>& output);
+
+    uint64_t get_patched_count() const;
+
+    uint64_t get_fallback_count() const;
+
+private:
+    bool patch(
+        const std::vector<uchar>& source,
+        const std::vector<Detection>& detections,
+        const cv::Scalar& color,
+        std::vector<uchar>& output);
+
+    // Collects the samples of the box edges in a component, as bits of the blocks they are in
+    void mark_edges(
+        const std::vector<Detection>& detections,
+        int image_width,
+        int image_height,
+        int horizontal_factor,
+        int max_horizontal_factor,
+        int vertical_factor,
+        int max_vertical_factor,
+        uint32_t width_in_blocks);
+
+    // Sets the marked samples of a block of quantized coefficients to the value
+    void patch_block(short* coefficients, const uint16_t* quantization, uint64_t mask, float value);
+
+    float m_basis[8][8];    // orthonormal DCT-II basis, [sample][frequency]
+
+    std::vector<std::pair<uint32_t, uint64_t>> m_block_masks;   // block index in the component, samples
+
+    uint64_t m_patched_count = 0;
+    uint64_t m_fallback_count = 0;
+};
+
+#endif
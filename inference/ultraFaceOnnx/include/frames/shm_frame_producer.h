@@ -0,0 +1,37 @@
+#ifndef SHM_FRAME_PRODUCER_H
+#define SHM_FRAME_PRODUCER_H
+
+#include "shm_ring.h"
+
+#include <opencv2/core.hpp>
+
+#include <string>
+
+// Publishes frames into a shared memory ring to be read by shm_frame_reader.
+// Frames are dropped rather than blocking when the consumer falls behind.
+class shm_frame_producer
+{
+public:
+    shm_frame_producer(const std::string& name, uint32_t slot_count, uint32_t slot_size);
+
+    // Marks the ring closed and removes its name
+    ~shm_frame_producer();
+
+    // Copies a BGR frame into the next free slot, returns false if the ring is full
+    bool write_frame(const cv::Mat& frame);
+
+    // Copies an encoded JPEG into the next free slot, returns false if the ring is full
+    bool write_jpeg(const unsigned char* data, size_t size);
+
+    // Lets the consumer finish once the published frames are read
+    void close();
+
+private:
+    shm_slot_header* acquire_slot(size_t size);
+
+    void publish_slot();
+
+    shm_ring m_ring;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SHM_FRAME_READER_H
+#define SHM_FRAME_READER_H
+
+#include "frame_reader.h"
+#include "shm_ring.h"
+
+#include <chrono>
+#include <string>
+
+// Consumes frames published by shm_frame_producer.
+// Raw frames are returned as views over the shared segment, without copying,
+// so a frame stays valid only until the next read_frame call.
+class shm_frame_reader : public frame_reader
+{
+public:
+    // Fails if another consumer reads the ring
+    shm_frame_reader(const std::string& name);
+
+    ~shm_frame_reader() override;
+
+    // Also once the producer is gone and its frames are read,
+    // or when it published nothing for the wait timeout
+    bool is_finished() override;
+
+    // Returns an empty frame right away if nothing is published yet
+    cv::Mat read_frame() override;
+
+    bool is_waiting() const override;
+
+    bool is_frame_shared() const override;
+
+private:
+    // Takes the ring over from a consumer process that is gone
+    void claim_ring();
+
+    void release_slot();
+
+    // Gives the slot back to the producer
+    void advance_tail();
+
+    bool is_slot_valid(const shm_slot_header& slot) const;
+
+    bool is_producer_alive() const;
+
+    shm_ring m_ring;
+    bool m_holds_slot = false;
+    bool m_waiting = false;
+    bool m_producer_gone = false;
+    bool m_timed_out = false;
+
+    std::chrono::steady_clock::time_point m_last_frame_time;
+
+    const std::chrono::milliseconds m_wait_timeout = std::chrono::milliseconds(5000);
+};
+
+#endif
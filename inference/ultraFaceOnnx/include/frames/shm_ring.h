@@ -0,0 +1,88 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "../shm/shm_segment.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Layout of a POSIX shared memory frames ring:
+//
+//   shm_ring_header | slot 0 (shm_slot_header, payload) | slot 1 | ...
+//
+// The ring has a single producer and a single consumer, which claims the ring first.
+// The producer fills the slot at head and then publishes it by advancing head,
+// the consumer owns the slot at tail until it advances tail.
+// So the consumer may use the payload in place, without copying it out.
+
+const uint32_t SHM_RING_MAGIC = 0x55465246; // "UFRF"
+const uint32_t SHM_RING_VERSION = 3;
+const size_t SHM_RING_ALIGNMENT = 64;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory indices must be lock free");
+
+enum class shm_frame_format : uint32_t
+{
+    raw_bgr = 0,
+    jpeg = 1
+};
+
+struct alignas(SHM_RING_ALIGNMENT) shm_ring_header
+{
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_slot_count;
+    uint32_t m_slot_size;   // payload capacity of each slot in bytes
+    std::atomic<uint64_t> m_head; // sequence number of the next frame to write
+    std::atomic<uint64_t> m_tail; // sequence number of the next frame to read
+    std::atomic<uint32_t> m_closed; // set by the producer after the last frame
+    int32_t m_producer_pid; // a consumer that waits for frames checks it is still alive
+    std::atomic<int32_t> m_consumer_pid; // the process of the consumer, 0 if none reads the ring
+};
+
+struct alignas(SHM_RING_ALIGNMENT) shm_slot_header
+{
+    shm_frame_format m_format;
+    uint32_t m_rows;
+    uint32_t m_cols;
+    uint32_t m_step;
+    uint64_t m_size;
+    uint64_t m_sequence;
+    int64_t m_timestamp_ns;
+};
+
+// Maps a named POSIX shared memory segment holding a frames ring
+class shm_ring
+{
+public:
+    // Creates a new segment, fails if the name is taken
+    static shm_ring create(const std::string& name, uint32_t slot_count, uint32_t slot_size);
+
+    // Opens a segment created by a producer
+    static shm_ring open(const std::string& name);
+
+    shm_ring_header& header() const;
+    shm_slot_header& slot_header(uint64_t sequence) const;
+    unsigned char* slot_data(uint64_t sequence) const;
+
+    // The payload capacity of a slot, as validated when the ring was mapped
+    uint32_t get_slot_size() const;
+
+    // Removes the segment name, the mapping stays valid for those who have it
+    void unlink();
+
+private:
+    shm_ring(shm_segment&& segment, uint32_t slot_count, uint32_t slot_size);
+
+    static size_t get_slot_stride(uint32_t slot_size);
+
+    shm_segment m_segment;
+
+    // Validated copies of the header, the slots stay inside the segment whatever the producer writes there
+    uint32_t m_slot_count;
+    uint32_t m_slot_size;
+};
+
+#endif
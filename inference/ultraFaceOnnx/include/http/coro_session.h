@@ -0,0 +1,118 @@
+#ifndef CORO_SESSION_H
+#define CORO_SESSION_H
+
+#include "../inference/modelRegistry.h"
+#include "frame_processor.h"
+#include "handler_allocator.h"
+
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+// Handles an HTTP server connection as a stackless coroutine.
+// Streams the same way as session, but the whole read-process-pause-write
+// cycle is a single function, and the one reference to the session
+// is moved from one operation to the next instead of being copied.
+// Handlers are allocated from memory recycled within the connection.
+class coro_session : public std::enable_shared_from_this<coro_session>
+{
+    // Completion handler of every operation: resumes the coroutine
+    class handler
+    {
+    public:
+        using allocator_type = handler_allocator<char>;
+
+        explicit handler(std::shared_ptr<coro_session>&& self)
+            :m_self(std::move(self))
+        {
+        }
+
+        allocator_type get_allocator() const;
+
+        void operator()(boost::system::error_code ec, std::size_t bytes_transferred = 0);
+
+    private:
+        std::shared_ptr<coro_session> m_self;
+    };
+
+    boost::asio::generic::stream_protocol::socket m_socket;
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+    boost::beast::multi_buffer m_buffer;
+
+    boost::beast::http::request<boost::beast::http::string_body> m_req;
+
+    std::shared_ptr<boost::beast::http::response<boost::beast::http::empty_body>> m_header_res;
+
+    std::shared_ptr<boost::beast::http::response<boost::beast::http::vector_body<unsigned char>>> m_res;
+
+    std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> m_string_res;
+
+    // The cached frame being sent after its part header, and how much of it is sent
+    std::shared_ptr<const cached_output> m_file;
+
+    size_t m_file_offset = 0;
+
+    std::chrono::seconds m_trace_duration;
+
+    boost::asio::steady_timer m_timer;
+
+    ModelRegistry& m_model_registry;
+
+    frame_processor m_frame_processor;
+
+    const std::string m_frame_boundary = "frame";
+
+    boost::asio::coroutine m_coroutine;
+
+    handler_memory m_handler_memory;
+
+public:
+    // Take ownership of the stream
+    coro_session(boost::asio::io_context& ioc,
+        boost::asio::generic::stream_protocol::socket socket,
+        const std::string& base_folder,
+        ModelRegistry& model_registry)
+        : m_socket(std::move(socket)),
+        m_strand(m_socket.get_executor()),
+        m_timer(ioc),
+        m_model_registry(model_registry),
+        m_frame_processor(base_folder, model_registry)
+    {
+    }
+
+    void run();
+
+private:
+    void resume(
+        std::shared_ptr<coro_session>&& self,
+        boost::system::error_code ec,
+        std::size_t bytes_transferred);
+
+    boost::asio::executor_binder<handler, boost::asio::strand<boost::asio::io_context::executor_type>>
+    make_handler(std::shared_ptr<coro_session>&& self);
+
+    // Returns true for a trace capture request, remembering its duration
+    bool is_trace_request();
+
+    bool is_readiness_request();
+
+    bool is_models_api_request();
+
+    bool is_jobs_api_request();
+
+    bool open_source();
+
+    void write_next_frame(std::shared_ptr<coro_session>&& self);
+
+    void do_close();
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef DEBUG_TRACE_H
+#define DEBUG_TRACE_H
+
+#include "query.h"
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+// GET /debug/trace?seconds=N records the frame spans of all the sessions
+// for N seconds (5 by default) and responds with the trace-event JSON.
+
+bool is_debug_trace_request(const query& q);
+
+std::chrono::seconds get_trace_duration(const query& q);
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> make_trace_response(
+    unsigned version,
+    std::string&& json);
+
+// Only one capture runs at a time
+std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> make_trace_busy_response(
+    unsigned version);
+
+#endif
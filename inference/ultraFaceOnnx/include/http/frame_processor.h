@@ -0,0 +1,204 @@
+#ifndef FRAME_PROCESSOR_H
+#define FRAME_PROCESSOR_H
+
+#include "../inference/detectionTracker.h"
+#include "../inference/modelRegistry.h"
+#include "../inference/tiling.h"
+#include "../frames/change_detector.h"
+#include "../frames/frame_reader.h"
+#include "../frames/jpeg_encoder.h"
+#include "../frames/jpeg_overlay.h"
+#include "../shm/detections_log.h"
+#include "../shm/detections_publisher.h"
+#include "../statistics.h"
+#include "query.h"
+#include "routing.h"
+#include "../trace/tracer.h"
+#include "output_cache.h"
+
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+// An encoded frame waiting to be written, an empty buffer without a file ends the stream
+struct encoded_frame
+{
+    std::vector<uchar> m_buffer;
+    uint64_t m_trace_id;
+    int64_t m_queued_us;    // -1 when the frame is not traced
+    std::shared_ptr<const cached_output> m_file;    // sent instead of the buffer when set
+};
+
+// Reads the frames of a streaming request, runs the inference on them
+// and queues the encoded frames with the detections drawn.
+// Shared by the session implementations, which only differ in the I/O.
+class frame_processor
+{
+public:
+    frame_processor(
+        const std::string& base_folder,
+        ModelRegistry& model_registry)
+        :m_routing(std::map<std::string, std::string>{{"base_dir", base_folder}}),
+        m_model_registry(model_registry),
+        m_session_id(tracer::next_session_id())
+    {
+    }
+
+    // Creates the frames source requested by the query, returns false if it or the model is unknown.
+    // Takes the inference context only then, so requests that do not stream need none.
+    bool open(const query& q);
+
+    // All the frames are read and sent
+    bool is_finished() const;
+
+    bool has_frames() const;
+
+    // The pause between the frames of the stream, longer on the lower quality levels
+    std::chrono::nanoseconds get_frame_pause() const;
+
+    // Processes frames as long as the pause before the next write allows.
+    // Queues an empty buffer after the last frame.
+    // Returns the part of the pause that is left, and queues nothing
+    // if the source has no frame yet, then it is processed again after the pause.
+    std::chrono::nanoseconds process_frames(std::chrono::nanoseconds pause);
+
+    encoded_frame pop_frame();
+
+    // Bracket the socket write of a popped frame, for its trace span
+    void trace_write_start(uint64_t trace_id);
+    void trace_write_end();
+
+    // Where ?record=1 logs the detections of the sources and ?replay=1 reads them, none if empty
+    static void set_detections_log_directory(const std::string& directory);
+
+    // Prepended to the names of ?publish=<name>, which may only hold letters, digits, '_' and '-'
+    static void set_publish_prefix(const std::string& prefix);
+
+private:
+    void process_frame();
+
+    // Resizes the frame, or its tiles, to the model input and runs the inference on it
+    bool detect(const cv::Mat& frame, std::vector<Detection>& detections);
+
+    // Runs the inference on the regions around the previous detections.
+    // Returns false when the full frame pass is due instead.
+    bool detect_regions(const cv::Mat& frame, std::vector<Detection>& detections);
+
+    // Hashes the identity of a frame with the model, the detection settings and the suffix, 0 if it has none
+    uint64_t get_cache_key(const std::string& identity, const std::string& suffix = std::string()) const;
+
+    // Queues the cached output of the next frame without reading it, returns false on a miss
+    bool send_cached_output(const std::string& identity, uint64_t& key);
+
+    // Switches to the model and the pace of the quality level
+    bool use_quality_level(size_t level);
+
+    // Takes the JPEG settings of the request, returns false if they are invalid
+    bool parse_jpeg_settings(const query& q);
+
+    // Maps the detections log of the source instead of taking an inference context
+    bool open_replay(const query& q);
+
+    // The logged detections of the current frame, none if the log has no record of it
+    void replay_detections(std::vector<Detection>& detections);
+
+    routing m_routing;
+
+    ModelRegistry& m_model_registry;
+
+    // Keeps the model version alive for the whole stream, even if it is reloaded meanwhile
+    std::shared_ptr<InferenceEngine> m_inference_engine;
+
+    std::unique_ptr<InferenceContext> m_inference_context;
+
+    // Follows the load-adaptive quality level, unless the request pins the quality or the model
+    bool m_adaptive = false;
+
+    size_t m_quality_level = 0;
+
+    std::chrono::nanoseconds m_frame_pause = std::chrono::nanoseconds(35000000);
+
+    std::unique_ptr<frame_reader> m_frame_reader;
+
+    // Infers overlapping tiles of the frame at the model resolution, with ?tiles=<columns>x<rows>
+    bool m_tiled = false;
+
+    TilingParams m_tiling_params;
+
+    // Propagates the detections between the frames the detector runs on, with ?track=<frames>|auto
+    std::unique_ptr<DetectionTracker> m_tracker;
+
+    // Detects the faces again in the regions around the previous detections, with ?roi=<frames per full pass>
+    int m_roi_interval = 0;
+
+    float m_roi_scale = 2.0f;
+
+    int m_frames_since_full_pass = 0;
+
+    std::vector<Detection> m_roi_detections;
+
+    // Reuses the detections of the last inferred frame while the scene is static, with ?gate=<threshold>
+    std::unique_ptr<change_detector> m_change_detector;
+
+    std::vector<Detection> m_last_detections;
+
+    // Reuses the detections of the frames seen before, unless ?cache=0
+    DetectionCache* m_detection_cache = nullptr;
+
+    // The settings the full frame detections depend on besides the model, part of the cache key
+    std::string m_detection_settings;
+
+    // Sends the annotated frames of the output cache, when the frames do not depend on the previous ones
+    bool m_cache_outputs = false;
+
+    uint64_t m_cached_outputs = 0;
+
+    // With ?jpeg_quality=, ?subsampling=420|444, ?fast_dct=1, ?optimize=1 and ?progressive=1
+    jpeg_settings m_jpeg_settings;
+
+    // Draws the boxes into the JPEG of the source instead of encoding the frame again,
+    // unless ?overlay=full or the JPEG settings of the request differ from the defaults
+    bool m_compressed_overlay = true;
+
+    jpeg_overlay m_jpeg_overlay;
+
+    // Runs the second model on the detected faces, with ?attributes=1
+    FaceStageBatcher* m_face_stage = nullptr;
+
+    uint64_t m_detected_frames = 0;
+
+    uint64_t m_tracked_frames = 0;
+
+    std::unique_ptr<detections_publisher> m_detections_publisher;
+
+    // Logs the detections of every frame, with ?record=1
+    std::unique_ptr<detections_log_writer> m_detections_log_writer;
+
+    // Draws the logged detections without running any inference, with ?replay=1
+    std::unique_ptr<detections_log_reader> m_detections_log_reader;
+
+    uint64_t m_replay_record = 0;
+
+    std::queue<encoded_frame> m_frame_buffers;
+
+    statistics m_statistics;
+
+    uint64_t m_frame_index = 0;
+
+    uint32_t m_session_id;
+
+    uint64_t m_write_trace_id = 0;
+
+    int64_t m_write_start_us = -1;
+
+    const uint32_t m_published_records = 64;
+
+    const uint32_t m_published_max_boxes = 256;
+
+    // The least pause before polling a source that had no frame
+    const std::chrono::nanoseconds m_poll_pause = std::chrono::milliseconds(1);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef HANDLER_ALLOCATOR_H
+#define HANDLER_ALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+// Memory for the handlers of a connection's asynchronous operations.
+// The same few blocks are recycled for every operation instead of going to the heap.
+// Not thread safe: the connection must have at most one operation in flight,
+// which holds for a composed operation and the lower level operations it runs.
+class handler_memory
+{
+public:
+    handler_memory()
+    {
+        m_in_use.fill(false);
+    }
+
+    handler_memory(const handler_memory&) = delete;
+    handler_memory& operator=(const handler_memory&) = delete;
+
+    void* allocate(std::size_t size)
+    {
+        if (size <= m_block_size)
+        {
+            for (std::size_t i = 0; i < m_block_count; ++i)
+            {
+                if (!m_in_use[i])
+                {
+                    m_in_use[i] = true;
+                    return &m_storage[i];
+                }
+            }
+        }
+
+        return ::operator new(size);
+    }
+
+    void deallocate(void* pointer)
+    {
+        for (std::size_t i = 0; i < m_block_count; ++i)
+        {
+            if (pointer == &m_storage[i])
+            {
+                m_in_use[i] = false;
+                return;
+            }
+        }
+
+        ::operator delete(pointer);
+    }
+
+private:
+    static const std::size_t m_block_size = 1024;
+    static const std::size_t m_block_count = 4;
+
+    std::array<typename std::aligned_storage<m_block_size>::type, m_block_count> m_storage;
+    std::array<bool, m_block_count> m_in_use;
+};
+
+// Standard allocator on top of handler_memory, associated with the handlers
+template <typename T>
+class handler_allocator
+{
+public:
+    using value_type = T;
+
+    explicit handler_allocator(handler_memory& memory)
+        :m_memory(memory)
+    {
+    }
+
+    template <typename U>
+    handler_allocator(const handler_allocator<U>& other)
+        :m_memory(other.m_memory)
+    {
+    }
+
+    T* allocate(std::size_t n) const
+    {
+        return static_cast<T*>(m_memory.allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T* pointer, std::size_t) const
+    {
+        m_memory.deallocate(pointer);
+    }
+
+    bool operator==(const handler_allocator& other) const
+    {
+        return &m_memory == &other.m_memory;
+    }
+
+    bool operator!=(const handler_allocator& other) const
+    {
+        return &m_memory != &other.m_memory;
+    }
+
+private:
+    template <typename> friend class handler_allocator;
+
+    handler_memory& m_memory;
+};
+
+#endif
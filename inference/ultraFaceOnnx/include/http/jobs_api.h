@@ -0,0 +1,52 @@
+#ifndef JOBS_API_H
+#define JOBS_API_H
+
+#include "query.h"
+#include "../inference/modelRegistry.h"
+
+#include <boost/beast/http.hpp>
+
+#include <memory>
+#include <string>
+
+// Offline bulk processing of archived frames, unpaced.
+// POST /jobs/filesystem/<dir>?ext=jpg&model=<name>&format=jsonl|binary queues a job
+// for the directory, the source path is the one of a stream request.
+// GET /jobs lists the jobs, GET /jobs/<id> reports the progress of one.
+//
+// A job runs the frames in batches on several worker threads, each with its own
+// inference context, and writes the detections of every frame in the frames
+// order into <results dir>/<id>.jsonl, one JSON object per line, or into
+// <results dir>/<id>.bin as records of
+//     uint64 frame index, uint32 detections count, count x {float score, float box[4]}.
+// The limits keep the jobs from starving the live streams: only so many jobs run
+// at once, the rest wait in a bounded queue, and the workers pause while the
+// load-adaptive quality policy has degraded the streams, until the level
+// recovers or the streams end.
+// Only the latest finished jobs are listed, their results files stay.
+
+struct jobs_params
+{
+    std::string m_base_dir;
+    std::string m_results_dir = "jobs";
+    int m_max_running = 1;
+    int m_workers = 4;
+    int m_max_queued = 16;
+    int m_max_finished = 100;   // done and failed jobs kept for GET /jobs, the oldest go first
+};
+
+// Starts the job runners, the jobs API answers 503 before
+void start_jobs(const jobs_params& params);
+
+// Stops the running jobs after their current frames and joins the runners
+void stop_jobs();
+
+bool is_jobs_request(const query& q);
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> make_jobs_response(
+    ModelRegistry& registry,
+    boost::beast::http::verb method,
+    const query& q,
+    unsigned version);
+
+#endif
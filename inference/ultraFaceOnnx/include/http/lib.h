@@ -1,8 +1,13 @@
 #ifndef LIB_H
 #define LIB_H
 
+#include "asyncLog.h"
+
 #include <boost/beast/core/error.hpp>
 #include <chrono>
+#include <cstring>
+
+// Messages go through the asynchronous log writer, the calls do not block on the output
 
 void fail(boost::system::error_code ec, char const* what);
 
@@ -10,8 +15,19 @@ void log(char const* message);
 
 void log(std::string message);
 
+// Per frame messages: compiled out when INFERENCE_LOG_MAX_SEVERITY
+// excludes kVERBOSE and filtered out at runtime by the reportable severity
+inline void log_verbose(char const* message)
+{
+    using inference::asyncLog::Severity;
+    if (inference::asyncLog::isEnabled(Severity::kVERBOSE))
+    {
+        inference::asyncLog::write(Severity::kVERBOSE, message, std::strlen(message));
+    }
+}
+
 std::time_t get_time();
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -1,37 +1,63 @@
 #ifndef LISTENER_H
 #define LISTENER_H
 
-#include "../inference/ultraFaceOnnx.h"
+#include "../inference/modelRegistry.h"
 
 #include <boost/asio/dispatch.hpp>
-#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/basic_socket_acceptor.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
 #include <boost/beast/core.hpp>
 
 #include <memory>
+#include <string>
+#include <sys/types.h>
 
 
-// Accepts incoming connections and launches the sessions
+enum class session_type
+{
+    callback,
+    coroutine
+};
+
+// Accepts incoming connections and launches the sessions.
+// The protocol is generic, so the same listener serves both
+// TCP endpoints and AF_UNIX stream socket paths.
 class listener : public std::enable_shared_from_this<listener>
 {
 public:
     listener(boost::asio::io_context& ioc,
-        boost::asio::ip::tcp::endpoint endpoint,
+        boost::asio::generic::stream_protocol::endpoint endpoint,
         const std::string& base_dir,
-        UltraFaceOnnxEngine& inferenceEngine);
+        ModelRegistry& model_registry,
+        session_type type);
+
+    // Removes the socket file of an AF_UNIX endpoint
+    ~listener();
 
     // Start accepting incoming connections
     void run();
 
 private:
+    // Unlinks a socket file nobody listens on, fails if a server answers or the path is not a socket
+    bool remove_stale_socket(
+        const boost::asio::generic::stream_protocol::endpoint& endpoint,
+        boost::beast::error_code& ec);
+
     void do_accept();
 
     void on_accept(boost::beast::error_code ec);
 
-    boost::asio::ip::tcp::acceptor m_acceptor;
-    boost::asio::ip::tcp::socket m_socket;
+    boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> m_acceptor;
+    boost::asio::generic::stream_protocol::socket m_socket;
     boost::asio::io_context& m_ioc;
     std::string m_base_dir;
-    UltraFaceOnnxEngine& m_inference_engine;
+    ModelRegistry& m_model_registry;
+    session_type m_session_type;
+
+    // The socket file bound, empty for TCP
+    std::string m_socket_path;
+    dev_t m_socket_device = 0;
+    ino_t m_socket_inode = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef MJPEG_H
+#define MJPEG_H
+
+#include "output_cache.h"
+
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/beast/http.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Responses of a Motion JPEG stream. Kept in shared_ptrs as their lifetime
+// has to extend for the duration of the async write.
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::empty_body>> make_mjpeg_header(
+    unsigned version,
+    const std::string& boundary);
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::vector_body<unsigned char>>> make_mjpeg_frame(
+    std::vector<unsigned char>&& buffer,
+    unsigned version,
+    bool keep_alive,
+    const std::string& boundary);
+
+// The part header of a frame sent from a file, the file follows it
+std::shared_ptr<boost::beast::http::response<boost::beast::http::empty_body>> make_mjpeg_file_header(
+    size_t size,
+    unsigned version,
+    bool keep_alive,
+    const std::string& boundary);
+
+// Sends the rest of the file from the offset with sendfile, without copying it through the user space.
+// Returns false when the socket takes no more for now, the caller waits until it is writable and calls again.
+bool send_mjpeg_file(
+    boost::asio::generic::stream_protocol::socket& socket,
+    const cached_output& file,
+    size_t& offset,
+    boost::system::error_code& ec);
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::empty_body>> make_mjpeg_termination(
+    unsigned version,
+    const std::string& boundary);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef MODELS_API_H
+#define MODELS_API_H
+
+#include "query.h"
+#include "../inference/modelRegistry.h"
+
+#include <boost/beast/http.hpp>
+
+#include <memory>
+
+// GET /models lists the served models and their versions,
+// and the hit rate and size of the detection cache if there is one.
+// POST /models/<name>/reload builds the model again in the background
+// and swaps it in, the running streams finish on the previous version.
+// Streams pick a model by ?model=<name>, the first one by default.
+
+bool is_models_request(const query& q);
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> make_models_response(
+    ModelRegistry& registry,
+    boost::beast::http::verb method,
+    const query& q,
+    unsigned version);
+
+#endif
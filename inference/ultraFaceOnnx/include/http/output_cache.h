@@ -0,0 +1,70 @@
+#ifndef OUTPUT_CACHE_H
+#define OUTPUT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Annotated output frames on disk, for the repeat viewers of an archive.
+// A frame is a JPEG file named by the hash of its key: the source file
+// identity (path, inode, size, modification time), the model key with the
+// detection threshold, the detection settings and the JPEG quality.
+// A hit is neither read nor decoded, drawn or encoded, the session sends
+// the file straight into the multipart stream with sendfile.
+// The directory is bounded in size, the least recently used files go first;
+// after a restart the use order starts from the modification times.
+
+struct output_cache_params
+{
+    std::string m_directory;                // no output cache if empty
+    size_t m_max_bytes = size_t(1) << 30;
+};
+
+// An open cached frame, the file is closed with the last reference.
+// Being open, it can be sent even if it is evicted meanwhile.
+class cached_output
+{
+public:
+    cached_output(int fd, size_t size)
+        :m_fd(fd),
+        m_size(size)
+    {}
+
+    ~cached_output();
+
+    cached_output(const cached_output&) = delete;
+    cached_output& operator=(const cached_output&) = delete;
+
+    int get_fd() const
+    {
+        return m_fd;
+    }
+
+    size_t get_size() const
+    {
+        return m_size;
+    }
+
+private:
+    int m_fd;
+    size_t m_size;
+};
+
+class output_cache
+{
+public:
+    // Indexes the frames already in the directory and evicts down to the size bound
+    static void configure(const output_cache_params& params);
+
+    static bool is_enabled();
+
+    // Opens the frame of the key, nullptr on a miss
+    static std::shared_ptr<const cached_output> lookup(uint64_t key);
+
+    // Writes the frame atomically, so a concurrent lookup never opens a partial one
+    static void store(uint64_t key, const std::vector<unsigned char>& buffer);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef QUALITY_POLICY_H
+#define QUALITY_POLICY_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Load-adaptive stream quality. The configured levels go from the best one,
+// e.g. the 640x480 model at full fps, down to the cheapest one, e.g. the
+// 320x240 model at a lower fps. The sessions report the processing time of
+// every frame; when its moving average breaks the latency SLO, or too many
+// inferences run at once, for the degrade time, all the adaptive sessions
+// step one level down. They step back up once the load stays below the
+// recover ratio of the SLO for the recover time, so the levels do not flap.
+// Without any frame reported for the recover time, e.g. once the streams end,
+// the level steps back up as well.
+// A session pins a level with ?quality=<level> or a model with ?model=<name>.
+
+struct quality_level
+{
+    std::string m_model;
+    std::chrono::nanoseconds m_frame_pause;
+};
+
+struct quality_params
+{
+    std::vector<quality_level> m_levels;
+    double m_latency_slo_ms = 30.0;
+    int m_max_in_flight = 8;
+    double m_recover_ratio = 0.6;
+    std::chrono::milliseconds m_degrade_after = std::chrono::milliseconds(1000);
+    std::chrono::milliseconds m_recover_after = std::chrono::milliseconds(5000);
+};
+
+class quality_policy
+{
+public:
+    // Enables the policy, without levels the sessions stream at the default quality
+    static void configure(const quality_params& params);
+
+    static bool is_enabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static size_t get_levels_count();
+
+    static const quality_level& get_level_settings(size_t level);
+
+    // The level of the adaptive sessions
+    static size_t get_level()
+    {
+        auto level = s_level.load(std::memory_order_relaxed);
+        return (level > 0) ? recover_idle(level) : level;
+    }
+
+    // Updates the load from the processing time of a frame and steps the level if due
+    static void report_frame(std::chrono::nanoseconds processing_time);
+
+private:
+    friend class inference_in_flight;
+
+    // Steps the level up when no frame was reported for the recover time
+    static size_t recover_idle(size_t level);
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<size_t> s_level;
+    static std::atomic<int> s_in_flight;
+};
+
+// Counts an inference running, for the load
+class inference_in_flight
+{
+public:
+    inference_in_flight()
+    {
+        quality_policy::s_in_flight.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~inference_in_flight()
+    {
+        quality_policy::s_in_flight.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    inference_in_flight(const inference_in_flight&) = delete;
+    inference_in_flight& operator=(const inference_in_flight&) = delete;
+};
+
+#endif
@@ -8,6 +8,10 @@
 struct query
 {
     query(const std::string& query_string);
+
+    // Returns the value of the first parameter with the name or the default value
+    std::string get_parameter(const std::string& name, const std::string& default_value = "") const;
+
     std::vector<std::string> m_path;
     std::vector<std::pair<std::string, std::string>> m_parameters;
 };
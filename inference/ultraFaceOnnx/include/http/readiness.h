@@ -0,0 +1,22 @@
+#ifndef READINESS_H
+#define READINESS_H
+
+#include "query.h"
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+
+// GET /ready answers 200 with the figures of the startup warm-up, for the readiness
+// probes of orchestrators. The listeners only start once the warm-up is done,
+// so until then the probe cannot connect at all.
+
+void set_ready(std::chrono::milliseconds warm_up_duration, int prepared_contexts);
+
+bool is_ready_request(const query& q);
+
+std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> make_ready_response(
+    unsigned version);
+
+#endif
@@ -4,6 +4,7 @@
 #include "query.h"
 #include "../frames/frame_reader.h"
 #include "../frames/filesystem_frame_reader.h"
+#include "../frames/shm_frame_reader.h"
 
 #include <functional>
 #include <map>
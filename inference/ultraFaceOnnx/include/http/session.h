@@ -1,12 +1,10 @@
 #ifndef SESSION_H
 #define SESSION_H
 
-#include "../inference/inferenceContext.h"
-#include "../frames/filesystem_frame_reader.h"
-#include "../statistics.h"
-#include "routing.h"
+#include "../inference/modelRegistry.h"
+#include "frame_processor.h"
 
-#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/steady_timer.hpp>
@@ -17,49 +15,47 @@
 #include <chrono>
 #include <functional>
 #include <memory>
-#include <queue>
 #include <string>
 
 // Handles an HTTP server connection
 class session : public std::enable_shared_from_this<session>
 {
-    boost::asio::ip::tcp::socket m_socket;
+    boost::asio::generic::stream_protocol::socket m_socket;
     boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
     boost::beast::multi_buffer m_buffer;
 
-    std::unique_ptr<InferenceContext> m_inference_context;
-
     boost::beast::http::request<boost::beast::http::string_body> m_req;
 
     std::shared_ptr<boost::beast::http::response<boost::beast::http::empty_body>> m_header_res;
 
     std::shared_ptr<boost::beast::http::response<boost::beast::http::vector_body<unsigned char>>> m_res;
-    
-    std::queue<std::vector<uchar>> m_frame_buffers;
 
-    boost::asio::steady_timer m_timer;
+    std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>> m_string_res;
+
+    // The cached frame being sent after its part header, and how much of it is sent
+    std::shared_ptr<const cached_output> m_file;
 
-    const std::chrono::nanoseconds m_frame_pause = std::chrono::nanoseconds(35000000);
+    size_t m_file_offset = 0;
 
-    statistics m_statistics;
+    boost::asio::steady_timer m_timer;
 
-    routing m_routing;
+    ModelRegistry& m_model_registry;
 
-    std::unique_ptr<frame_reader> m_frame_reader;
+    frame_processor m_frame_processor;
 
     const std::string m_frame_boundary = "frame";
 
 public:
     // Take ownership of the stream
     session(boost::asio::io_context& ioc,
-        boost::asio::ip::tcp::socket socket,
+        boost::asio::generic::stream_protocol::socket socket,
         const std::string& base_folder,
-        std::unique_ptr<InferenceContext>&& inference_context)
+        ModelRegistry& model_registry)
         : m_socket(std::move(socket)),
         m_strand(m_socket.get_executor()),
         m_timer(ioc),
-        m_routing(std::map<std::string, std::string>{{"base_dir", base_folder}}),
-        m_inference_context(std::move(inference_context))
+        m_model_registry(model_registry),
+        m_frame_processor(base_folder, model_registry)
     {
     }
 
@@ -79,9 +75,20 @@ private:
 
     void on_timer(const boost::system::error_code& error);
 
-    void do_close();
+    // Sends the cached frame once its part header is written, and whenever the socket takes more of it
+    void on_file_writable(boost::system::error_code ec);
+
+    void do_trace(const query& q);
 
-    void process_frame();
+    void on_trace_timer(const boost::system::error_code& error);
+
+    void write_string_response();
+
+    void on_string_write(
+        boost::system::error_code ec,
+        std::size_t bytes_transferred);
+
+    void do_close();
 };
 
 #endif
\ No newline at end of file
@@ -3,12 +3,16 @@
 
 #include <array>
 #include <algorithm>
+#include <cstdint>
+#include <vector>
 
 struct Detection
 {
     float mScore;
     constexpr static const int mNumCorners = 4; 
     std::array<float, mNumCorners> mBox;
+    uint32_t mTrackId = 0;  // 0 when the detection is not tracked
+    std::vector<float> mAttributes;     // Outputs of the face stage, e.g. landmarks, empty without one
 
     Detection(float score, std::array<float, mNumCorners>&& box)
         : mScore(score), mBox(box)
@@ -0,0 +1,95 @@
+#ifndef DETECTION_CACHE_H
+#define DETECTION_CACHE_H
+
+#include "detection.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//!
+//! \brief Configuration of the detection cache, off without memory entries and a directory
+//!
+struct DetectionCacheParams
+{
+    size_t mMemoryEntries{0};           //!< Frames kept in the in-memory LRU tier
+    std::string mDirectory;             //!< Directory of the on-disk tier, none if empty
+    size_t mMaxLogSize{256 << 20};      //!< Bytes of the on-disk log, it starts over when full
+};
+
+struct DetectionCacheStats
+{
+    uint64_t mMemoryHits;
+    uint64_t mDiskHits;
+    uint64_t mMisses;
+    size_t mMemoryEntries;
+    size_t mDiskEntries;
+    size_t mDiskBytes;
+};
+
+//!
+//! \brief Detections of frames seen before, by a key of the frame and the model, shared by the sessions
+//!
+//! \details The key hashes the identity of the frame and the model key of the engine, so a changed
+//!          model or file misses without any invalidation. The in-memory tier is an LRU list.
+//!          The on-disk tier is an append-only log mapped into memory, indexed in memory by
+//!          scanning it on open, so the cache survives restarts. Only the scores and the boxes
+//!          are stored, the tracks and the attributes depend on the stream.
+//!
+class DetectionCache
+{
+public:
+    explicit DetectionCache(const DetectionCacheParams& params);
+
+    ~DetectionCache();
+
+    DetectionCache(const DetectionCache&) = delete;
+    DetectionCache& operator=(const DetectionCache&) = delete;
+
+    //!
+    //! \brief Gives the detections stored under the key, from memory or else from the disk
+    //!
+    bool lookup(uint64_t key, std::vector<Detection>& detections);
+
+    void store(uint64_t key, const std::vector<Detection>& detections);
+
+    DetectionCacheStats get_stats();
+
+private:
+    //!
+    //! \brief Maps the log and indexes its complete records, starts a new log if it is unusable
+    //!
+    //! \details The log is locked by the process, another process sharing the directory runs
+    //!          without the on-disk tier, and so does one that cannot reserve its blocks.
+    //!
+    void openLog();
+
+    void readRecord(size_t offset, std::vector<Detection>& detections) const;
+
+    void appendRecord(uint64_t key, const std::vector<Detection>& detections);
+
+    void remember(uint64_t key, const std::vector<Detection>& detections);
+
+    DetectionCacheParams mParams;
+
+    std::mutex mMutex;
+
+    using Entry = std::pair<uint64_t, std::vector<Detection>>;
+    std::list<Entry> mRecentlyUsed;     //!< Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> mMemoryIndex;
+
+    int mFd{-1};
+    unsigned char* mLog{nullptr};       //!< Mapping of the whole log, mParams.mMaxLogSize bytes
+    std::unordered_map<uint64_t, size_t> mDiskIndex;    //!< Record offsets in the log
+
+    uint64_t mMemoryHits{0};
+    uint64_t mDiskHits{0};
+    uint64_t mMisses{0};
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef DETECTION_TRACKER_H
+#define DETECTION_TRACKER_H
+
+#include "detection.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+//!
+//! \brief The settings of the tracking between the detections
+//!
+struct TrackerParams
+{
+    int mDetectionInterval{5};      //!< Frames per detection, 0 picks it from the measured motion
+    int mMaxDetectionInterval{15};  //!< Upper bound of the adaptive interval
+    float mMaxDrift{0.1f};          //!< Drift of a box between detections, relative to its size, for the adaptive interval
+    float mIouThreshold{0.3f};      //!< Minimal overlap of a detection with the predicted box of its track
+    int mMaxMisses{2};              //!< Detections a track may miss before it is dropped
+    float mConfidenceDecay{0.9f};   //!< Confidence factor of every predicted frame
+    float mMinConfidence{0.5f};     //!< A track below it makes the next frame a detection
+    float mPositionGain{0.6f};      //!< Alpha of the alpha-beta filter of the box
+    float mVelocityGain{0.3f};      //!< Beta of the alpha-beta filter of the box
+};
+
+//!
+//! \brief Propagates the detections between the frames the detector runs on.
+//!
+//! \details The detections are associated to the tracks greedily by the IoU with their predicted boxes.
+//!          Each track follows a constant velocity model of its box center and size, corrected by
+//!          an alpha-beta filter, the steady state form of a Kalman filter for that model.
+//!          The tracked detections carry the track ids.
+//!
+class DetectionTracker
+{
+public:
+    explicit DetectionTracker(const TrackerParams& params);
+
+    //!
+    //! \brief Whether the detector should run on the next frame: the interval is over or a track is lost
+    //!
+    bool is_detection_due() const;
+
+    //!
+    //! \brief Corrects the tracks with the detections of a frame and gives them the track ids
+    //!
+    void update(std::vector<Detection>& detections);
+
+    //!
+    //! \brief Predicts the tracks into a frame without a detection
+    //!
+    void predict(std::vector<Detection>& detections);
+
+    //!
+    //! \brief The frames per detection, measured when the interval is adaptive
+    //!
+    int get_detection_interval() const;
+
+private:
+    struct Track
+    {
+        uint32_t mId;
+        float mScore;
+        float mConfidence;
+        int mMisses;
+        std::array<float, 4> mState;    //!< center x, center y, width, height
+        std::array<float, 4> mVelocity; //!< per frame
+    };
+
+    void advance();
+    void updateInterval();
+    Detection makeDetection(const Track& track) const;
+
+    TrackerParams mParams;
+    std::vector<Track> mTracks;
+    uint32_t mNextId{1};
+    int mFramesSinceDetection{0};
+    int mInterval;
+    bool mLost{true};     //!< No detection yet or a track is lost
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef FACE_STAGE_H
+#define FACE_STAGE_H
+
+#include "detection.h"
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+//!
+//! \brief Configuration of the second model stage, run on the face crops of the detections,
+//!        e.g. a landmarks or a recognition model
+//!
+struct FaceStageParams
+{
+    std::string mOnnxFileName;                      //!< No face stage if empty
+    std::string mInputTensorName{"input"};
+    std::string mOutputTensorName{"output"};
+    float mCropScale{1.2f};                         //!< Size of a crop relative to its detection box
+    std::array<float, 3> mPreprocessingMeans{{127.0f, 127.0f, 127.0f}};
+    float mPreprocessingNorm{128.0f};
+    int mContexts{2};                               //!< Execution contexts, each run by a batching thread
+    std::chrono::microseconds mMaxDelay{2000};      //!< Longest wait of a crop for the others of its batch
+};
+
+//!
+//! \brief A face to run the stage on: the frame it is in and its normalized box
+//!
+struct FaceCrop
+{
+    const cv::Mat* mFrame;
+    std::array<float, Detection::mNumCorners> mBox;
+};
+
+//!
+//! \brief Crops, resizes and normalizes the faces straight into the planar float input tensor,
+//!        sampling the frames bilinearly without intermediate images
+//!
+void preprocessFaceCrops(
+    const std::vector<FaceCrop>& crops,
+    int inputWidth,
+    int inputHeight,
+    const FaceStageParams& params,
+    float* hostDataBuffer);
+
+//!
+//! \brief Per thread state of the face stage, implemented by the backends
+//!
+class FaceStageContext
+{
+public:
+    virtual ~FaceStageContext() {}
+
+    //!
+    //! \brief Runs the stage on at most the batch size of crops, giving the output vector of every crop
+    //!
+    virtual bool infer(const std::vector<FaceCrop>& crops, std::vector<std::vector<float>>& outputs) = 0;
+};
+
+//!
+//! \brief The face stage model, shared by its contexts
+//!
+class FaceStageEngine
+{
+public:
+    virtual ~FaceStageEngine() {}
+
+    virtual bool build() = 0;
+
+    virtual std::unique_ptr<FaceStageContext> create_context() = 0;
+
+    virtual int get_max_batch_size() const = 0;
+
+    //!
+    //! \brief The count of the output values of a face
+    //!
+    virtual int get_output_size() const = 0;
+};
+
+//!
+//! \brief Creates the face stage of the inference backend, it still has to be built
+//!
+std::unique_ptr<FaceStageEngine> createFaceStageEngine(
+    const std::string& backend,
+    const FaceStageParams& params,
+    const std::vector<std::string>& dataDirs,
+    bool fp16);
+
+#endif
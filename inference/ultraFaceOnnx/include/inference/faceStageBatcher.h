@@ -0,0 +1,74 @@
+#ifndef FACE_STAGE_BATCHER_H
+#define FACE_STAGE_BATCHER_H
+
+#include "detection.h"
+#include "faceStage.h"
+
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//!
+//! \brief Runs the face stage on the crops of all the sessions, batched across the sessions
+//!
+//! \details Every context has a thread taking the queued crops of several frames into one batch.
+//!          A batch runs when it is full or when its oldest crop waited the max delay, so a
+//!          session waits at most the delay plus the inference of one batch.
+//!
+class FaceStageBatcher
+{
+public:
+    FaceStageBatcher(std::unique_ptr<FaceStageEngine> engine, const FaceStageParams& params);
+
+    ~FaceStageBatcher();
+
+    //!
+    //! \brief Builds the engine and starts the threads of its contexts
+    //!
+    bool start();
+
+    //!
+    //! \brief Runs the stage on the detections of the frame, filling their attributes
+    //!
+    //! \details Blocks the calling thread until the batches with its crops ran.
+    //!
+    bool process(const cv::Mat& frame, std::vector<Detection>& detections);
+
+    //!
+    //! \brief The count of the attributes of a detection
+    //!
+    int get_output_size() const;
+
+private:
+    struct Request
+    {
+        std::vector<FaceCrop> mCrops;
+        std::vector<std::vector<float>> mOutputs;
+        std::chrono::steady_clock::time_point mQueuedAt;
+        bool mDone;
+        bool mSucceeded;
+    };
+
+    void run(FaceStageContext& context);
+
+    std::unique_ptr<FaceStageEngine> mEngine;
+    FaceStageParams mParams;
+    size_t mMaxBatchSize{1};
+    std::vector<std::unique_ptr<FaceStageContext>> mContexts;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mQueueChanged;
+    std::condition_variable mRequestsDone;
+    std::deque<Request*> mQueue;
+    size_t mQueuedCrops{0};
+    bool mStopping{false};
+};
+
+#endif
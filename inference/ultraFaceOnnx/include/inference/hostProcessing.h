@@ -0,0 +1,45 @@
+#ifndef HOST_PROCESSING_H
+#define HOST_PROCESSING_H
+
+#include "detection.h"
+#include "ultraFaceInferenceParams.h"
+
+#include <opencv2/core.hpp>
+#include <set>
+#include <vector>
+
+//!
+//! \brief The host side of the inference: preparing the input tensor and parsing the output tensors.
+//!        Works on plain host buffers, so it does not need a GPU or an engine.
+//!
+
+//!
+//! \brief Normalizes a batch of BGR frames of the input size into the planar float input tensor
+//!
+void preprocessBatch(
+    const std::vector<cv::Mat>& batch,
+    const UltraFaceInferenceParams& params,
+    float* hostDataBuffer);
+
+//!
+//! \brief Keeps the boxes scored above the detection threshold and suppresses the overlapping ones
+//!
+void parseDetections(
+    const float* scores,
+    const float* boxes,
+    const UltraFaceInferenceParams& params,
+    std::vector<Detection>& detections);
+
+float getIntersectionArea(const Detection& first, const Detection& second);
+
+float getIou(const Detection& first, const Detection& second);
+
+//!
+//! \brief Greedy non maximum suppression, consumes allDetections
+//!
+void nms(
+    std::multiset<Detection, ScoreDescendingCompare>& allDetections,
+    std::vector<Detection>& resultDetections,
+    float iouThreshold);
+
+#endif
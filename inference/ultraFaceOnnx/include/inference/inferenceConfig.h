@@ -0,0 +1,55 @@
+#ifndef INFERENCE_CONFIG_H
+#define INFERENCE_CONFIG_H
+
+#include "detectionCache.h"
+#include "faceStage.h"
+#include "inferenceEngine.h"
+#include "mockInferenceParams.h"
+#include "ultraFaceInferenceParams.h"
+#include "warmUp.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//!
+//! \brief A named model served next to the others, picked by the model query parameter
+//!
+struct ModelConfig
+{
+    std::string mName;
+    std::string mOnnxFileName;
+};
+
+//!
+//! \brief Backend selection and model parameters, shared by the server and the tools
+//!
+struct InferenceConfig
+{
+    std::string mBackend{"tensorrt"};
+    std::shared_ptr<UltraFaceInferenceParams> mParams{std::make_shared<UltraFaceInferenceParams>()};
+    MockInferenceParams mMockParams;
+    WarmUpParams mWarmUp;
+    std::vector<ModelConfig> mModels;   //!< From the MODEL lines, the model of ONNX_FILE_NAME if there are none
+    FaceStageParams mFaceStage;         //!< Second model run on the detected faces, from the FACE_STAGE lines
+    DetectionCacheParams mDetectionCache;
+};
+
+//!
+//! \brief Applies a "NAME value" line of config.ini if it configures the inference
+//!
+//! \return Returns false for the names of other settings
+//!
+bool readInferenceConfig(const std::string& name, const std::string& value, InferenceConfig& config);
+
+//!
+//! \brief Reads the inference settings of a config file, skipping the other settings
+//!
+bool readInferenceConfigFile(const std::string& fileName, InferenceConfig& config);
+
+//!
+//! \brief Creates the configured backend, it still has to be built
+//!
+std::unique_ptr<InferenceEngine> createInferenceEngine(const InferenceConfig& config);
+
+#endif
@@ -1,61 +1,38 @@
 #ifndef INFERENCE_CONTEXT_H
 #define INFERENCE_CONTEXT_H
 
-#include "buffers.h"
 #include "detection.h"
-#include "ultraFaceInferenceParams.h"
 
-#include <opencv2/imgcodecs.hpp>
-#include <memory>
-#include <set>
+#include <opencv2/core.hpp>
 #include <vector>
 
+//!
+//! \brief Per session inference state, implemented by the inference backends
+//!
 class InferenceContext
 {
-    template <typename T>
-    using InferenceUniquePtr = std::unique_ptr<T, inferenceCommon::InferDeleter>;
-
 public:
-    InferenceContext(
-        nvinfer1::IExecutionContext* executionContext,
-        std::shared_ptr<std::vector<BindingInfo>> bindings,
-        std::shared_ptr<UltraFaceInferenceParams> params)
-        :mParams(params)
-    {
-        mExecutionContext = InferenceUniquePtr<nvinfer1::IExecutionContext>(executionContext);
-        mBufferManager = std::unique_ptr<inferenceCommon::BufferManager>(
-            new inferenceCommon::BufferManager(executionContext, bindings));
-    }
+    virtual ~InferenceContext() {}
 
     //!
-    //! \brief Runs the TensorRT inference engine
+    //! \brief Runs the inference on a batch of frames of the input size
     //!
-    bool infer(const std::vector<cv::Mat>& batch, std::vector<Detection>& detections);
-
-    int get_input_height() const;
-    int get_input_width() const;
-
-private:
-
-    bool preprocessInput(const std::vector<cv::Mat>& batch);
+    virtual bool infer(const std::vector<cv::Mat>& batch, std::vector<Detection>& detections) = 0;
 
     //!
-    //! \brief Classifies digits and verify result
+    //! \brief Runs the inference on a batch of frames of the input size and keeps the detections of every frame apart
     //!
-    bool parseOutput(std::vector<Detection>& detections);
+    virtual bool infer_batch(
+        const std::vector<cv::Mat>& batch,
+        std::vector<std::vector<Detection>>& detections) = 0;
 
-    float get_intersection_area(const Detection & first, const Detection & second);
-
-    float get_iou(const Detection & first, const Detection & second);
-
-    void nms(
-        std::multiset<Detection, ScoreDescendingCompare>& all_detections,
-        std::vector<Detection>& result_detections,
-        float iou_threshold);
+    //!
+    //! \brief The most frames an inference takes
+    //!
+    virtual int get_max_batch_size() const = 0;
 
-    InferenceUniquePtr<nvinfer1::IExecutionContext> mExecutionContext;
-    std::unique_ptr<inferenceCommon::BufferManager> mBufferManager;
-    std::shared_ptr<UltraFaceInferenceParams> mParams;
+    virtual int get_input_height() const = 0;
+    virtual int get_input_width() const = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
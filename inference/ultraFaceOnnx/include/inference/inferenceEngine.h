@@ -0,0 +1,53 @@
+#ifndef INFERENCE_ENGINE_H
+#define INFERENCE_ENGINE_H
+
+#include "inferenceContext.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//!
+//! \brief An inference backend shared by all the sessions
+//!
+class InferenceEngine
+{
+public:
+    virtual ~InferenceEngine() {}
+
+    //!
+    //! \brief Prepares the backend, called once before serving
+    //!
+    virtual bool build() = 0;
+
+    //!
+    //! \brief Describes the model and the params its detections depend on, set by build
+    //!
+    //! \details Results stored under the key of one model are never found under another one,
+    //!          so caches of the detections need no invalidation when a model changes.
+    //!
+    virtual const std::string& get_model_key() const = 0;
+
+    //!
+    //! \brief Gives the inference state of a session, a prepared one if any is left
+    //!
+    std::unique_ptr<InferenceContext> get_inference_context();
+
+    //!
+    //! \brief Keeps a warmed up context for the next session
+    //!
+    void add_prepared_context(std::unique_ptr<InferenceContext>&& context);
+
+protected:
+    //!
+    //! \brief Creates a new inference state, implemented by the backends
+    //!
+    virtual std::unique_ptr<InferenceContext> create_inference_context() = 0;
+
+private:
+    std::mutex mPreparedMutex;
+    std::vector<std::unique_ptr<InferenceContext>> mPreparedContexts;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef MOCK_INFERENCE_CONTEXT_H
+#define MOCK_INFERENCE_CONTEXT_H
+
+#include "inferenceContext.h"
+#include "mockInferenceParams.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+//!
+//! \brief Data of the mock backend loaded once and shared by all the contexts
+//!
+struct MockInferenceData
+{
+    MockInferenceParams mParams;
+    std::map<int, std::vector<float>> mLatencyTrace; //!< Latencies in milliseconds by batch size
+    std::vector<std::vector<Detection>> mReplayedDetections;
+};
+
+//!
+//! \brief Returns synthetic detections after a simulated inference latency, without a GPU
+//!
+class MockInferenceContext : public InferenceContext
+{
+public:
+    MockInferenceContext(std::shared_ptr<const MockInferenceData> data, unsigned seed);
+
+    //!
+    //! \brief Blocks the calling thread for the simulated latency, like the synchronous TensorRT execution
+    //!
+    bool infer(const std::vector<cv::Mat>& batch, std::vector<Detection>& detections) override;
+
+    bool infer_batch(
+        const std::vector<cv::Mat>& batch,
+        std::vector<std::vector<Detection>>& detections) override;
+
+    int get_max_batch_size() const override;
+
+    int get_input_height() const override;
+    int get_input_width() const override;
+
+private:
+    std::chrono::microseconds getLatency(size_t batchSize);
+
+    void addDetections(std::vector<Detection>& detections);
+
+    std::shared_ptr<const MockInferenceData> mData;
+    std::mt19937 mRandom;
+    std::map<int, size_t> mTracePositions;
+    size_t mReplayPosition{0};
+};
+
+#endif
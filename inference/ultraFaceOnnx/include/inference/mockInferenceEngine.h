@@ -0,0 +1,48 @@
+#ifndef MOCK_INFERENCE_ENGINE_H
+#define MOCK_INFERENCE_ENGINE_H
+
+#include "inferenceEngine.h"
+#include "mockInferenceContext.h"
+#include "mockInferenceParams.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+//!
+//! \brief Inference backend without TensorRT or a GPU, for testing the serving layers under load
+//!
+class MockInferenceEngine : public InferenceEngine
+{
+public:
+    MockInferenceEngine(const MockInferenceParams& params)
+        : mParams(params)
+    {
+    }
+
+    //!
+    //! \brief Loads the latency trace and the replayed detections
+    //!
+    bool build() override;
+
+    const std::string& get_model_key() const override;
+
+    //!
+    //! \brief Reads the detections of a frame per line, as the replayed ones and the golden ones of the regression harness
+    //!
+    static bool readDetections(const std::string& fileName, std::vector<std::vector<Detection>>& detections);
+
+protected:
+    std::unique_ptr<InferenceContext> create_inference_context() override;
+
+private:
+    bool readLatencyTrace(const std::string& fileName, MockInferenceData& data);
+
+    MockInferenceParams mParams;
+    std::shared_ptr<const MockInferenceData> mData;
+    std::string mModelKey;
+    std::atomic<unsigned> mContextCount{0};
+};
+
+#endif
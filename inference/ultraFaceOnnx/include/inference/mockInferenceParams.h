@@ -0,0 +1,31 @@
+#ifndef MOCK_INFERENCE_PARAMS_H
+#define MOCK_INFERENCE_PARAMS_H
+
+#include <string>
+
+enum class MockLatencyDistribution
+{
+    kFIXED,
+    kLOGNORMAL,
+    kTRACE
+};
+
+//!
+//! \brief Configuration of the mock inference backend
+//!
+struct MockInferenceParams
+{
+    int mInputWidth{320};
+    int mInputHeight{240};
+    MockLatencyDistribution mLatencyDistribution{MockLatencyDistribution::kFIXED};
+    float mLatencyMs{5.0f};         //!< Fixed latency of a frame or the median of the lognormal one
+    float mLatencySigma{0.25f};     //!< Shape of the lognormal latency
+    std::string mLatencyTraceFile;  //!< Measured latencies, lines of "<latency_ms>" or "<batch_size> <latency_ms>"
+    float mBatchScaling{1.0f};      //!< Cost of every frame after the first one of a batch, relative to the first
+    int mMaxBatchSize{16};
+    std::string mDetectionsFile;    //!< Replayed detections, a line per frame of "<score> <left> <top> <right> <bottom>" groups
+    float mDetectionsMean{2.0f};    //!< Mean count of the random detections of a frame
+    unsigned mSeed{42};
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include "detectionCache.h"
+#include "faceStageBatcher.h"
+#include "inferenceConfig.h"
+#include "inferenceEngine.h"
+#include "warmUp.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ModelStatus
+{
+    std::string mName;
+    std::string mOnnxFileName;
+    unsigned mVersion;
+    bool mReloading;
+    bool mDefault;
+};
+
+enum class ReloadResult
+{
+    kSTARTED,
+    kUNKNOWN_MODEL,
+    kBUSY
+};
+
+//!
+//! \brief The served models by name, each with its own params, engine and prepared contexts
+//!
+//! \details A session holds the engine it started with, so a reload swaps the engine
+//!          for the next sessions only. The old engine and its contexts go away with
+//!          the last session using them, without dropping any stream.
+//!
+class ModelRegistry
+{
+public:
+    explicit ModelRegistry(const InferenceConfig& config);
+
+    ~ModelRegistry();
+
+    //!
+    //! \brief Builds and warms up all the models, called once before serving
+    //!
+    bool build(WarmUpReport& report);
+
+    //!
+    //! \brief The current engine of the model, of the first one for an empty name
+    //!
+    //! \return Returns nullptr for an unknown model
+    //!
+    std::shared_ptr<InferenceEngine> get_engine(const std::string& name);
+
+    //!
+    //! \brief Builds a new version of the model in the background and swaps it in when it is warmed up
+    //!
+    ReloadResult reload(const std::string& name);
+
+    std::vector<ModelStatus> get_models();
+
+    //!
+    //! \brief The face stage shared by the sessions of all the models
+    //!
+    //! \return Returns nullptr when no FACE_STAGE_ONNX is configured
+    //!
+    FaceStageBatcher* get_face_stage();
+
+    //!
+    //! \brief The detections of the frames seen before, shared by the sessions of all the models
+    //!
+    //! \return Returns nullptr when no DETECTION_CACHE_ENTRIES or DETECTION_CACHE_DIR is configured
+    //!
+    DetectionCache* get_detection_cache();
+
+private:
+    struct Model
+    {
+        ModelConfig mConfig;
+        std::shared_ptr<InferenceEngine> mEngine;
+        unsigned mVersion;
+        bool mReloading;
+        std::thread mReloadThread;
+    };
+
+    std::shared_ptr<InferenceEngine> buildEngine(const ModelConfig& model, WarmUpReport& report) const;
+
+    void reloadModel(const ModelConfig& model);
+
+    Model* findModel(const std::string& name);
+
+    InferenceConfig mConfig;
+    std::mutex mMutex;
+    std::vector<Model> mModels;
+    std::unique_ptr<FaceStageBatcher> mFaceStage;
+    std::unique_ptr<DetectionCache> mDetectionCache;
+};
+
+#endif
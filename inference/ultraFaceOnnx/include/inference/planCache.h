@@ -0,0 +1,69 @@
+#ifndef PLAN_CACHE_H
+#define PLAN_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//!
+//! \brief A cached plan mapped into memory, unmapped on destruction
+//!
+class MappedPlan
+{
+public:
+    MappedPlan(void* mapping, size_t mappingSize, size_t planOffset);
+    ~MappedPlan();
+
+    MappedPlan(const MappedPlan&) = delete;
+    MappedPlan& operator=(const MappedPlan&) = delete;
+
+    const void* data() const;
+    size_t size() const;
+
+private:
+    void* mMapping;
+    size_t mMappingSize;
+    size_t mPlanOffset;
+};
+
+//!
+//! \brief Prepared models on disk, so a restart does not repeat the build.
+//!
+//! \details The cache stores opaque blobs, a serialized TensorRT engine or the pre-packed
+//!          weights of another backend. A blob is stored under a key describing everything
+//!          it depends on, e.g. the model hash, the precision flags and the runtime version.
+//!          The file name holds a hash of the key and the file header the full key, so a
+//!          mismatch of any part is a miss and the caller builds again.
+//!
+class PlanCache
+{
+public:
+    explicit PlanCache(const std::string& directory);
+
+    //!
+    //! \brief Maps the plan stored under the key
+    //!
+    //! \return Returns nullptr if there is no such plan or its key differs
+    //!
+    std::unique_ptr<MappedPlan> load(const std::string& name, const std::string& key) const;
+
+    //!
+    //! \brief Writes the plan, replacing the file atomically so concurrent readers see a whole one
+    //!
+    bool store(const std::string& name, const std::string& key, const void* data, size_t size) const;
+
+private:
+    std::string getPath(const std::string& name, const std::string& key) const;
+
+    std::string mDirectory;
+};
+
+//!
+//! \brief FNV-1a hash of the file content, zero if the file cannot be read
+//!
+uint64_t hashFile(const std::string& fileName);
+
+uint64_t hashString(const std::string& value);
+
+#endif
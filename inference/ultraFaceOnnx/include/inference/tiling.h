@@ -0,0 +1,51 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include "detection.h"
+#include "inferenceContext.h"
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+//!
+//! \brief Splitting of a large frame into overlapping tiles, each inferred at the model resolution,
+//!        so small faces keep enough pixels to be detected
+//!
+struct TilingParams
+{
+    int mColumns{2};
+    int mRows{2};
+    float mOverlap{0.2f};       //!< Part of a tile shared with its neighbour
+    bool mFullFrame{true};      //!< Infers the whole frame too, for the faces larger than a tile
+};
+
+//!
+//! \brief The tiles of the grid covering the frame
+//!
+std::vector<cv::Rect> getTiles(const cv::Size& frameSize, const TilingParams& params);
+
+//!
+//! \brief Regions around the detections of a previous frame, to detect the same faces again at a fraction of the cost
+//!
+//! \details A region is the box enlarged by the scale, shaped like the model input and at least as large,
+//!          so the faces are not upscaled, and moved inside the frame.
+//!
+std::vector<cv::Rect> getDetectionRegions(
+    const cv::Size& frameSize,
+    const cv::Size& inputSize,
+    const std::vector<Detection>& detections,
+    float scale);
+
+//!
+//! \brief Infers the tiles in batches of the context and merges their detections with a global nms
+//!
+//! \details The tiles are cv::Mat views of the frame, they are only copied when resized to the input size.
+//!          The boxes are mapped back to the frame before the merge.
+//!
+bool inferTiles(
+    InferenceContext& context,
+    const cv::Mat& frame,
+    const std::vector<cv::Rect>& tiles,
+    std::vector<Detection>& detections);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TRT_FACE_STAGE_H
+#define TRT_FACE_STAGE_H
+
+#include "buffers.h"
+#include "common.h"
+#include "faceStage.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//!
+//! \brief Runs the face stage with a TensorRT execution context, the crops are preprocessed
+//!        straight into the input host buffer
+//!
+class TrtFaceStageContext : public FaceStageContext
+{
+    template <typename T>
+    using InferenceUniquePtr = std::unique_ptr<T, inferenceCommon::InferDeleter>;
+
+public:
+    TrtFaceStageContext(
+        nvinfer1::IExecutionContext* executionContext,
+        std::shared_ptr<std::vector<BindingInfo>> bindings,
+        const FaceStageParams& params,
+        const nvinfer1::Dims& inputDims,
+        int outputSize)
+        :mParams(params),
+        mInputDims(inputDims),
+        mOutputSize(outputSize)
+    {
+        mExecutionContext = InferenceUniquePtr<nvinfer1::IExecutionContext>(executionContext);
+        mBufferManager = std::unique_ptr<inferenceCommon::BufferManager>(
+            new inferenceCommon::BufferManager(executionContext, bindings));
+    }
+
+    bool infer(const std::vector<FaceCrop>& crops, std::vector<std::vector<float>>& outputs) override;
+
+private:
+    InferenceUniquePtr<nvinfer1::IExecutionContext> mExecutionContext;
+    std::unique_ptr<inferenceCommon::BufferManager> mBufferManager;
+    FaceStageParams mParams;
+    nvinfer1::Dims mInputDims;
+    int mOutputSize;
+};
+
+//!
+//! \brief Builds the face stage model of an ONNX file with one input and one output tensor
+//!
+class TrtFaceStageEngine : public FaceStageEngine
+{
+    template <typename T>
+    using InferenceUniquePtr = std::unique_ptr<T, inferenceCommon::InferDeleter>;
+
+public:
+    TrtFaceStageEngine(const FaceStageParams& params, const std::vector<std::string>& dataDirs, bool fp16)
+        :mParams(params),
+        mDataDirs(dataDirs),
+        mFp16(fp16)
+    {
+    }
+
+    bool build() override;
+
+    std::unique_ptr<FaceStageContext> create_context() override;
+
+    int get_max_batch_size() const override;
+
+    int get_output_size() const override;
+
+private:
+    FaceStageParams mParams;
+    std::vector<std::string> mDataDirs;
+    bool mFp16;
+    nvinfer1::Dims mInputDims;  //!< N C H W, the batch size is fixed by the model
+    int mOutputSize{0};
+    std::shared_ptr<nvinfer1::ICudaEngine> mEngine;
+    std::shared_ptr<std::vector<BindingInfo>> mBindings;
+    std::mutex mMutex;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TRT_INFERENCE_CONTEXT_H
+#define TRT_INFERENCE_CONTEXT_H
+
+#include "buffers.h"
+#include "detection.h"
+#include "inferenceContext.h"
+#include "ultraFaceInferenceParams.h"
+
+#include <opencv2/imgcodecs.hpp>
+#include <memory>
+#include <vector>
+
+//!
+//! \brief Runs the inference with a TensorRT execution context
+//!
+class TrtInferenceContext : public InferenceContext
+{
+    template <typename T>
+    using InferenceUniquePtr = std::unique_ptr<T, inferenceCommon::InferDeleter>;
+
+public:
+    TrtInferenceContext(
+        nvinfer1::IExecutionContext* executionContext,
+        std::shared_ptr<std::vector<BindingInfo>> bindings,
+        std::shared_ptr<UltraFaceInferenceParams> params)
+        :mParams(params)
+    {
+        mExecutionContext = InferenceUniquePtr<nvinfer1::IExecutionContext>(executionContext);
+        mBufferManager = std::unique_ptr<inferenceCommon::BufferManager>(
+            new inferenceCommon::BufferManager(executionContext, bindings));
+    }
+
+    //!
+    //! \brief Runs the TensorRT inference engine
+    //!
+    bool infer(const std::vector<cv::Mat>& batch, std::vector<Detection>& detections) override;
+
+    bool infer_batch(
+        const std::vector<cv::Mat>& batch,
+        std::vector<std::vector<Detection>>& detections) override;
+
+    int get_max_batch_size() const override;
+
+    int get_input_height() const override;
+    int get_input_width() const override;
+
+private:
+
+    //!
+    //! \brief Preprocesses the batch and runs it through the engine, the outputs are left in the host buffers
+    //!
+    bool execute(const std::vector<cv::Mat>& batch);
+
+    bool preprocessInput(const std::vector<cv::Mat>& batch);
+
+    //!
+    //! \brief Parses the detections of a frame of the batch
+    //!
+    bool parseOutput(int batchIndex, std::vector<Detection>& detections);
+
+    InferenceUniquePtr<nvinfer1::IExecutionContext> mExecutionContext;
+    std::unique_ptr<inferenceCommon::BufferManager> mBufferManager;
+    std::shared_ptr<UltraFaceInferenceParams> mParams;
+};
+
+#endif
\ No newline at end of file
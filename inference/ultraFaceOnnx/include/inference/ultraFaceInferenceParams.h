@@ -5,6 +5,7 @@
 #include "argsParser.h"
 
 #include <array>
+#include <string>
 
 struct UltraFaceInferenceParams : public inferenceCommon::OnnxInferenceParams
 {
@@ -15,6 +16,7 @@ struct UltraFaceInferenceParams : public inferenceCommon::OnnxInferenceParams
     int mNumClasses;
     int mDetectionClassIndex;
     float mDetectionThreshold;
+    std::string mEngineCacheDir;    //!< Serialized engine plans of previous starts, no caching if empty
 };
 
 #endif
\ No newline at end of file
@@ -5,8 +5,10 @@
 #include "buffers.h"
 #include "common.h"
 #include "detection.h"
-#include "inferenceContext.h"
+#include "inferenceEngine.h"
 #include "parserOnnxConfig.h"
+#include "planCache.h"
+#include "trtInferenceContext.h"
 #include "ultraFaceInferenceParams.h"
 
 #include <array>
@@ -20,7 +22,7 @@
 //!
 //! \details It creates the network using an ONNX model
 //!
-class UltraFaceOnnxEngine
+class UltraFaceOnnxEngine : public InferenceEngine
 {
     template <typename T>
     using InferenceUniquePtr = std::unique_ptr<T, inferenceCommon::InferDeleter>;
@@ -35,21 +37,39 @@ public:
     //!
     //! \brief Function builds the network engine
     //!
-    bool build();
+    bool build() override;
 
-    std::unique_ptr<InferenceContext> get_inference_context();
+    const std::string& get_model_key() const override;
+
+protected:
+    std::unique_ptr<InferenceContext> create_inference_context() override;
 
 private:
     std::shared_ptr<UltraFaceInferenceParams> mParams;
 
     nvinfer1::Dims mInputDims;  //!< The dimensions of the input to the network.
 
+    InferenceUniquePtr<nvinfer1::IRuntime> mRuntime; //!< Deserializes cached plans, outlives their engine
+
     std::shared_ptr<nvinfer1::ICudaEngine> mEngine; //!< The TensorRT engine used to run the network
 
     std::shared_ptr<std::vector<BindingInfo>> mBindings;
 
+    std::string mModelKey;
+
     std::mutex mMutex;
 
+    bool initializeEngine();
+
+    std::string getCacheKey(const nvinfer1::Dims& inputDims) const;
+
+    //!
+    //! \brief Deserializes the cached plan of the key, returns false on a miss
+    //!
+    bool loadEngine(const PlanCache& cache, const std::string& key);
+
+    void storeEngine(const PlanCache& cache, const std::string& key);
+
     //!
     //! \brief Parses an ONNX model for MNIST and creates a TensorRT network
     //!
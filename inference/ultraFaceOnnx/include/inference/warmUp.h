@@ -0,0 +1,32 @@
+#ifndef WARM_UP_H
+#define WARM_UP_H
+
+#include "inferenceEngine.h"
+
+#include <chrono>
+#include <vector>
+
+//!
+//! \brief Startup warm-up, so the first sessions do not pay for the lazy initialization
+//!
+struct WarmUpParams
+{
+    int mContexts{4};               //!< Contexts created ahead and handed to the first sessions
+    int mIterations{3};             //!< Dummy inferences per context and batch size
+    std::vector<int> mBatchSizes{1};
+};
+
+struct WarmUpReport
+{
+    std::chrono::milliseconds mDuration{0};
+    int mContexts{0};
+    int mFailedInferences{0};
+};
+
+//!
+//! \brief Creates the contexts, runs the dummy inferences on them and a JPEG encode and decode,
+//!        then leaves the contexts prepared in the engine
+//!
+WarmUpReport warmUp(InferenceEngine& engine, const WarmUpParams& params);
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef DETECTIONS_LOG_H
+#define DETECTIONS_LOG_H
+
+#include "detections_ring.h"
+#include "../inference/detection.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout of a detections log file, the detections of the frames of a source:
+//
+//   detections_log_header | record 0 | record 1 | ...
+//
+// Every record has the same size, so record N starts at
+// sizeof(detections_log_header) + N * m_record_size:
+//
+//   detections_log_record | max_boxes * detections_record_box
+//
+// The records are appended in the frame order. A partial record at the end
+// of the file, left by a crash, is not part of the log.
+//
+// The sparse index is a second file, the log path with ".idx" appended,
+// holding a detections_log_index_entry for every DETECTIONS_LOG_INDEX_INTERVAL
+// records: entry N describes record N * DETECTIONS_LOG_INDEX_INTERVAL.
+// A seek is a binary search of the index and a scan of at most an interval of
+// records, a range is scanned from there. Both files map straight into memory.
+// All fields are in the host byte order.
+
+const uint32_t DETECTIONS_LOG_MAGIC = 0x55464c44; // "UFLD"
+const uint32_t DETECTIONS_LOG_VERSION = 1;
+const uint32_t DETECTIONS_LOG_INDEX_INTERVAL = 64;
+
+struct alignas(64) detections_log_header
+{
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_max_boxes;
+    uint32_t m_record_size;
+};
+
+struct detections_log_record
+{
+    uint64_t m_frame_index;     // frame number within the source
+    int64_t m_timestamp_ns;     // system clock time of the processing
+    uint32_t m_box_count;       // boxes following the record, at most m_max_boxes
+    uint32_t m_reserved;
+};
+
+struct detections_log_index_entry
+{
+    uint64_t m_frame_index;
+    int64_t m_timestamp_ns;
+};
+
+// The log of a source in the directory, e.g. "filesystem/my_archive?ext=png"
+// goes to "<directory>/filesystem.my_5farchive.png.dlog"
+std::string get_detections_log_path(
+    const std::string& directory,
+    const std::vector<std::string>& source_path,
+    const std::string& extention);
+
+// Records the detections of the frames of a stream into a temporary file of its own,
+// "<path>.XXXXXX". The log replaces the previous one of the source once the stream
+// is committed, a writer destroyed before, e.g. when the client disconnects, removes
+// what it wrote. Throws std::system_error if the log cannot be created.
+class detections_log_writer
+{
+public:
+    detections_log_writer(const std::string& path, uint32_t max_boxes);
+
+    ~detections_log_writer();
+
+    detections_log_writer(const detections_log_writer&) = delete;
+    detections_log_writer& operator=(const detections_log_writer&) = delete;
+
+    // Boxes beyond the record capacity are dropped, the lowest scores first
+    void append(uint64_t frame_index, const std::vector<Detection>& detections);
+
+    // Replaces the log of the source with the recorded one, after the last frame of the source
+    void commit();
+
+private:
+    std::string m_path;
+    std::string m_temp_path;
+    bool m_committed = false;
+    int m_fd;
+    int m_index_fd;
+    uint32_t m_max_boxes;
+    uint64_t m_record_count = 0;
+    std::vector<unsigned char> m_record;
+};
+
+// Maps a detections log for reading.
+// Throws std::system_error if there is no valid log.
+class detections_log_reader
+{
+public:
+    explicit detections_log_reader(const std::string& path);
+
+    ~detections_log_reader();
+
+    detections_log_reader(const detections_log_reader&) = delete;
+    detections_log_reader& operator=(const detections_log_reader&) = delete;
+
+    uint64_t get_record_count() const;
+
+    const detections_log_record& record(uint64_t record_number) const;
+
+    // The number of the first record of the frame index or a later one,
+    // get_record_count() if the log ends before it
+    uint64_t seek(uint64_t frame_index) const;
+
+    void read_detections(uint64_t record_number, std::vector<Detection>& detections) const;
+
+private:
+    const unsigned char* m_log = nullptr;
+    size_t m_log_size = 0;
+    const detections_log_index_entry* m_index = nullptr;
+    size_t m_index_size = 0;     // entries describing complete records
+    size_t m_index_bytes = 0;
+    uint64_t m_record_count = 0;
+    uint32_t m_record_size = 0;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef DETECTIONS_PUBLISHER_H
+#define DETECTIONS_PUBLISHER_H
+
+#include "detections_ring.h"
+#include "../inference/detection.h"
+
+#include <string>
+#include <vector>
+
+// Writes per frame detections into a named shared memory ring
+class detections_publisher
+{
+public:
+    detections_publisher(
+        const std::string& name,
+        uint32_t record_count,
+        uint32_t max_boxes,
+        uint32_t max_attributes = 0)
+        :m_ring(detections_ring::create(name, record_count, max_boxes, max_attributes))
+    {}
+
+    // Removes the ring name, readers keep their mappings
+    ~detections_publisher();
+
+    // Boxes beyond the ring capacity are dropped, the lowest scores first,
+    // and so are the attributes beyond the slots of a box
+    void publish(
+        uint64_t frame_index,
+        int frame_width,
+        int frame_height,
+        const std::vector<Detection>& detections);
+
+private:
+    detections_ring m_ring;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef DETECTIONS_RING_H
+#define DETECTIONS_RING_H
+
+#include "shm_segment.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Layout of a POSIX shared memory detections ring:
+//
+//   detections_ring_header | record 0 | record 1 | ... | record (record_count - 1)
+//
+// Every record has the same size:
+//
+//   detections_record_header | max_boxes * detections_record_box | max_boxes * max_attributes floats
+//
+// The attributes of a box are the outputs of the face stage, e.g. landmarks,
+// m_attribute_count of them per box are valid.
+// The ring has a single writer and any number of readers, nobody takes locks.
+// Frame number N goes to record N % record_count. Each record is guarded
+// by a sequence lock: m_lock is 2 * N + 1 while frame N is being written
+// and 2 * N + 2 once it is complete. A reader copies the record out and
+// accepts the copy only if m_lock held the same even value before and after.
+// m_head in the ring header is the number of frames published so far.
+// All fields are in the host byte order.
+
+const uint32_t DETECTIONS_RING_MAGIC = 0x55464452; // "UFDR"
+const uint32_t DETECTIONS_RING_VERSION = 3;
+const size_t DETECTIONS_RING_ALIGNMENT = 64;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory indices must be lock free");
+
+struct alignas(DETECTIONS_RING_ALIGNMENT) detections_ring_header
+{
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_record_count;
+    uint32_t m_max_boxes;
+    uint32_t m_record_size;     // bytes between the starts of two records
+    uint32_t m_max_attributes;  // attribute slots per box
+    std::atomic<uint64_t> m_head;
+};
+
+struct detections_record_header
+{
+    std::atomic<uint64_t> m_lock;
+    uint64_t m_sequence;        // frame number within the ring
+    int64_t m_timestamp_ns;     // steady clock time of the publication
+    uint64_t m_frame_index;     // frame number within the source
+    uint32_t m_frame_width;
+    uint32_t m_frame_height;
+    uint32_t m_box_count;       // boxes following the header, at most m_max_boxes
+    uint32_t m_attribute_count; // attributes of each box, at most m_max_attributes
+};
+
+struct detections_record_box
+{
+    float m_score;
+    float m_box[4];             // left, top, right, bottom normalized to [0, 1]
+    uint32_t m_track_id;        // 0 when the stream is not tracked
+};
+
+// Maps a named segment holding a detections ring
+class detections_ring
+{
+public:
+    static detections_ring create(
+        const std::string& name,
+        uint32_t record_count,
+        uint32_t max_boxes,
+        uint32_t max_attributes);
+
+    static detections_ring open(const std::string& name);
+
+    detections_ring_header& header() const;
+    detections_record_header& record_header(uint64_t sequence) const;
+    detections_record_box* record_boxes(uint64_t sequence) const;
+    float* record_attributes(uint64_t sequence) const;     // max_attributes floats per box
+
+    // The layout as validated when the ring was mapped
+    uint32_t get_record_count() const;
+    uint32_t get_max_boxes() const;
+    uint32_t get_max_attributes() const;
+
+    void unlink();
+
+private:
+    detections_ring(
+        shm_segment&& segment,
+        uint32_t record_count,
+        uint32_t max_boxes,
+        uint32_t max_attributes);
+
+    static size_t get_record_size(uint32_t max_boxes, uint32_t max_attributes);
+
+    shm_segment m_segment;
+
+    // Validated copies of the header, the records stay inside the segment whatever the writer puts there
+    uint32_t m_record_count;
+    uint32_t m_max_boxes;
+    uint32_t m_max_attributes;
+    size_t m_record_size;
+};
+
+#endif
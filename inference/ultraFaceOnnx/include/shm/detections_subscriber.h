@@ -0,0 +1,47 @@
+#ifndef DETECTIONS_SUBSCRIBER_H
+#define DETECTIONS_SUBSCRIBER_H
+
+#include "detections_ring.h"
+#include "../inference/detection.h"
+
+#include <string>
+#include <vector>
+
+struct detections_frame
+{
+    uint64_t m_sequence;
+    int64_t m_timestamp_ns;
+    uint64_t m_frame_index;
+    int m_frame_width;
+    int m_frame_height;
+    std::vector<Detection> m_detections;
+};
+
+// Polls a detections ring written by detections_publisher.
+// Any number of subscribers may read the same ring, none of them blocks the writer.
+class detections_subscriber
+{
+public:
+    detections_subscriber(const std::string& name)
+        :m_ring(detections_ring::open(name))
+    {}
+
+    // Reads the oldest frame not seen yet that is still in the ring.
+    // Returns false if there is no new frame.
+    bool poll(detections_frame& frame);
+
+    // Reads the most recent frame, skipping everything older
+    bool poll_latest(detections_frame& frame);
+
+    // Frames overwritten by the writer before this subscriber got to them
+    uint64_t get_lost_count() const;
+
+private:
+    bool read_record(uint64_t sequence, detections_frame& frame);
+
+    detections_ring m_ring;
+    uint64_t m_next_sequence = 0;
+    uint64_t m_lost_count = 0;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SHM_SEGMENT_H
+#define SHM_SEGMENT_H
+
+#include <cstddef>
+#include <string>
+
+// Named POSIX shared memory segment mapped for reading and writing
+class shm_segment
+{
+public:
+    // Creates a new zero filled segment, fails if the name is taken
+    static shm_segment create(const std::string& name, size_t size);
+
+    // Opens a segment created by another process
+    static shm_segment open(const std::string& name);
+
+    shm_segment(shm_segment&& other);
+    shm_segment& operator=(shm_segment&& other) = delete;
+    shm_segment(const shm_segment&) = delete;
+    ~shm_segment();
+
+    unsigned char* data() const;
+    size_t size() const;
+
+    // Removes the segment name if this segment created it,
+    // the mapping stays valid for those who have it
+    void unlink();
+
+private:
+    shm_segment(const std::string& name, int fd, size_t size, bool created);
+
+    std::string m_name;
+    unsigned char* m_address;
+    size_t m_size;
+    bool m_created;     // the name is ours to remove
+};
+
+#endif
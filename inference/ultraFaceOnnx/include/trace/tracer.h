@@ -0,0 +1,109 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Opt-in per-frame tracing. While a capture runs, spans are appended to
+// buffers owned by the recording threads, without locks. At the end of the
+// capture the spans are exported as Chrome trace-event JSON, which can be
+// opened in chrome://tracing or Perfetto. Outside of a capture a span only
+// costs a relaxed atomic load.
+//
+// A frame's trace id is the session id in the upper 32 bits and the frame
+// number in the lower ones. A thread sets the current trace id with a
+// trace_scope, and the nested spans pick it up, down to the inference code.
+class tracer
+{
+public:
+    static bool is_enabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static int64_t now_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint64_t make_trace_id(uint32_t session_id, uint64_t frame_index)
+    {
+        return (static_cast<uint64_t>(session_id) << 32) | (frame_index & 0xffffffff);
+    }
+
+    static uint32_t next_session_id();
+
+    static uint64_t get_current_trace_id()
+    {
+        return s_current_trace_id;
+    }
+
+    // Appends a span to the calling thread's buffer
+    static void record(const char* name, uint64_t trace_id, int64_t start_us, int64_t end_us);
+
+    // Starts recording, returns false if another capture is running
+    static bool start_capture();
+
+    // Stops recording and returns the spans of the capture as trace-event JSON
+    static std::string stop_capture();
+
+private:
+    friend class trace_scope;
+
+    static std::atomic<bool> s_enabled;
+    static thread_local uint64_t s_current_trace_id;
+};
+
+// Sets the trace id of the frame processed by the calling thread
+class trace_scope
+{
+public:
+    explicit trace_scope(uint64_t trace_id)
+        :m_previous_trace_id(tracer::s_current_trace_id)
+    {
+        tracer::s_current_trace_id = trace_id;
+    }
+
+    ~trace_scope()
+    {
+        tracer::s_current_trace_id = m_previous_trace_id;
+    }
+
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+    uint64_t m_previous_trace_id;
+};
+
+// Records the lifetime of the object as a span of the current frame.
+// The name must be a string literal, only the pointer is kept.
+class trace_span
+{
+public:
+    explicit trace_span(const char* name)
+        :m_name(name),
+        m_start_us(tracer::is_enabled() ? tracer::now_us() : -1)
+    {
+    }
+
+    ~trace_span()
+    {
+        if ((m_start_us >= 0) && tracer::is_enabled())
+        {
+            tracer::record(m_name, tracer::get_current_trace_id(), m_start_us, tracer::now_us());
+        }
+    }
+
+    trace_span(const trace_span&) = delete;
+    trace_span& operator=(const trace_span&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start_us;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "frames/change_detector.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+change_detector::change_detector(int threshold, int refresh_interval)
+    :m_threshold(threshold),
+    m_refresh_interval(refresh_interval),
+    m_block_sums((s_width / s_block_size) * (s_height / s_block_size))
+{
+}
+
+bool change_detector::is_changed(const cv::Mat& frame)
+{
+    cv::resize(frame, m_small, cv::Size(s_width, s_height), 0, 0, cv::INTER_AREA);
+    if (m_small.channels() == 3)
+    {
+        cv::cvtColor(m_small, m_thumbnail, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+        std::swap(m_small, m_thumbnail);
+    }
+
+    ++m_frames_since_inference;
+    bool refresh = (m_refresh_interval > 0) && (m_frames_since_inference >= m_refresh_interval);
+    if (m_has_reference && !refresh && (get_change() < m_threshold))
+    {
+        ++m_skipped_count;
+        return false;
+    }
+
+    std::swap(m_reference, m_thumbnail);
+    m_has_reference = true;
+    m_frames_since_inference = 0;
+    ++m_inferred_count;
+    return true;
+}
+
+uint64_t change_detector::get_inferred_count() const
+{
+    return m_inferred_count;
+}
+
+uint64_t change_detector::get_skipped_count() const
+{
+    return m_skipped_count;
+}
+
+int change_detector::get_change()
+{
+    const int blocks_per_row = s_width / s_block_size;
+    std::fill(m_block_sums.begin(), m_block_sums.end(), 0);
+
+    for (int y = 0; y < s_height; ++y)
+    {
+        const uchar* current = m_thumbnail.ptr<uchar>(y);
+        const uchar* reference = m_reference.ptr<uchar>(y);
+        uint32_t* row_sums = &m_block_sums[(y / s_block_size) * blocks_per_row];
+#ifdef __SSE2__
+        // Sums the absolute differences of each 8 pixel half, the row parts of two neighbouring blocks
+        for (int x = 0; x < s_width; x += 16)
+        {
+            auto sad = _mm_sad_epu8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + x)));
+            row_sums[x / s_block_size] += _mm_cvtsi128_si32(sad);
+            row_sums[x / s_block_size + 1] += _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+        }
+#else
+        for (int x = 0; x < s_width; ++x)
+        {
+            row_sums[x / s_block_size] += std::abs(current[x] - reference[x]);
+        }
+#endif
+    }
+
+    auto max_sum = *std::max_element(m_block_sums.cbegin(), m_block_sums.cend());
+    return max_sum / (s_block_size * s_block_size);
+}
@@ -1,6 +1,10 @@
 #include "frames/files_iterator.h"
 
+#include <cerrno>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
 
 files_iterator::files_iterator(const std::string& path, const std::string& extention)
 {
@@ -31,9 +35,48 @@ bool files_iterator::is_finished() const
 bool files_iterator::move_next()
 {
     ++m_current;
+    return !is_finished();
 }
 
 std::string files_iterator::get_file_path() const
 {
     return *m_current;
-}
\ No newline at end of file
+}
+
+bool read_file(const std::string& path, std::vector<unsigned char>& content)
+{
+    content.clear();
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // The file may still shrink while read, the buffer keeps what was read
+    content.resize(status.st_size);
+    size_t done = 0;
+    while (done < content.size())
+    {
+        auto count = read(fd, content.data() + done, content.size() - done);
+        if ((count < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            break;
+        }
+        done += count;
+    }
+    close(fd);
+
+    content.resize(done);
+    return done > 0;
+}
@@ -1,8 +1,11 @@
 #include "frames/filesystem_frame_reader.h"
 
+#include "trace/tracer.h"
+
 #include <opencv2/imgcodecs.hpp>
 
-#include <iostream>
+#include <sys/stat.h>
+#include <vector>
 
 bool filesystem_frame_reader::is_finished()
 {
@@ -13,5 +16,47 @@ cv::Mat filesystem_frame_reader::read_frame()
 {
     auto path = m_files_iterator.get_file_path();
     m_files_iterator.move_next();
-    return cv::imread(path);
-}
\ No newline at end of file
+
+    // Reading and decoding separately, so they show as separate trace spans.
+    // The file is kept for the overlay drawn straight into the JPEG.
+    if (!read_file(path, m_encoded_frame))
+    {
+        return cv::Mat();
+    }
+
+    trace_span span("decode");
+    return cv::imdecode(m_encoded_frame, cv::IMREAD_COLOR);
+}
+
+std::string filesystem_frame_reader::get_frame_identity()
+{
+    if (m_files_iterator.is_finished())
+    {
+        return std::string();
+    }
+
+    auto path = m_files_iterator.get_file_path();
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        return std::string();
+    }
+
+    return path
+        + ";" + std::to_string(status.st_dev)
+        + ";" + std::to_string(status.st_ino)
+        + ";" + std::to_string(status.st_size)
+        + ";" + std::to_string(status.st_mtim.tv_sec)
+        + "." + std::to_string(status.st_mtim.tv_nsec);
+}
+
+void filesystem_frame_reader::skip_frame()
+{
+    m_files_iterator.move_next();
+    m_encoded_frame.clear();
+}
+
+const std::vector<uchar>* filesystem_frame_reader::get_encoded_frame() const
+{
+    return &m_encoded_frame;
+}
@@ -0,0 +1,385 @@
+#include "frames/jpeg_encoder.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <csetjmp>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include <jpeglib.h>
+
+#ifndef JCS_EXTENSIONS
+#error "The BGR input of the JPEG encoder needs libjpeg-turbo"
+#endif
+
+namespace
+{
+
+struct error_manager
+{
+    jpeg_error_mgr m_manager;
+    jmp_buf m_jump;
+};
+
+void on_error(j_common_ptr info)
+{
+    longjmp(reinterpret_cast<error_manager*>(info->err)->m_jump, 1);
+}
+
+void on_message(j_common_ptr)
+{
+}
+
+// The destination writes into the output vector, sized from the previous frame
+struct output_buffer
+{
+    std::vector<uchar>* m_output = nullptr;
+    size_t m_size_hint = 64 << 10;
+};
+
+output_buffer& get_output_buffer(j_compress_ptr compress)
+{
+    return *static_cast<output_buffer*>(compress->client_data);
+}
+
+void start_output(j_compress_ptr compress)
+{
+    auto& buffer = get_output_buffer(compress);
+    buffer.m_output->resize(buffer.m_size_hint);
+    compress->dest->next_output_byte = buffer.m_output->data();
+    compress->dest->free_in_buffer = buffer.m_output->size();
+}
+
+boolean grow_output(j_compress_ptr compress)
+{
+    // Called when the whole buffer is used
+    auto& output = *get_output_buffer(compress).m_output;
+    auto used = output.size();
+    output.resize(used * 2);
+    compress->dest->next_output_byte = output.data() + used;
+    compress->dest->free_in_buffer = output.size() - used;
+    return TRUE;
+}
+
+void end_output(j_compress_ptr compress)
+{
+    auto& buffer = get_output_buffer(compress);
+    buffer.m_output->resize(buffer.m_output->size() - compress->dest->free_in_buffer);
+    buffer.m_size_hint = std::max<size_t>(buffer.m_output->size() + buffer.m_output->size() / 4, 16 << 10);
+}
+
+} // anonymous namespace
+
+struct jpeg_encoder::state
+{
+    jpeg_compress_struct m_compress;
+    jpeg_destination_mgr m_destination;
+    error_manager m_error;
+    output_buffer m_buffer;
+    std::vector<JSAMPROW> m_rows;
+};
+
+jpeg_encoder::jpeg_encoder()
+    :m_state(new state())
+{
+    auto& compress = m_state->m_compress;
+    compress.err = jpeg_std_error(&m_state->m_error.m_manager);
+    m_state->m_error.m_manager.error_exit = on_error;
+    m_state->m_error.m_manager.output_message = on_message;
+    jpeg_create_compress(&compress);
+
+    compress.client_data = &m_state->m_buffer;
+    m_state->m_destination.init_destination = start_output;
+    m_state->m_destination.empty_output_buffer = grow_output;
+    m_state->m_destination.term_destination = end_output;
+    compress.dest = &m_state->m_destination;
+}
+
+jpeg_encoder::~jpeg_encoder()
+{
+    jpeg_destroy_compress(&m_state->m_compress);
+}
+
+bool jpeg_encoder::encode(
+    const cv::Mat& frame,
+    const jpeg_settings& settings,
+    std::vector<uchar>& output,
+    int first_row,
+    int row_count)
+{
+    auto& compress = m_state->m_compress;
+    m_state->m_buffer.m_output = &output;
+    if (setjmp(m_state->m_error.m_jump))
+    {
+        // The compressor is ready for the next frame again
+        jpeg_abort_compress(&compress);
+        return false;
+    }
+
+    compress.image_width = frame.cols;
+    compress.image_height = (row_count < 0) ? frame.rows - first_row : row_count;
+    compress.input_components = 3;
+    compress.in_color_space = JCS_EXT_BGR;
+    jpeg_set_defaults(&compress);
+    jpeg_set_quality(&compress, settings.m_quality, TRUE);
+    if (!settings.m_subsampling)
+    {
+        compress.comp_info[0].h_samp_factor = 1;
+        compress.comp_info[0].v_samp_factor = 1;
+    }
+    compress.dct_method = settings.m_fast_dct ? JDCT_IFAST : JDCT_ISLOW;
+    compress.optimize_coding = settings.m_optimize ? TRUE : FALSE;
+    if (settings.m_progressive)
+    {
+        jpeg_simple_progression(&compress);
+    }
+
+    jpeg_start_compress(&compress, TRUE);
+    m_state->m_rows.resize(compress.image_height);
+    for (size_t i = 0; i < m_state->m_rows.size(); ++i)
+    {
+        m_state->m_rows[i] = const_cast<uchar*>(frame.ptr<uchar>(first_row + i));
+    }
+    while (compress.next_scanline < compress.image_height)
+    {
+        jpeg_write_scanlines(&compress, m_state->m_rows.data() + compress.next_scanline,
+            compress.image_height - compress.next_scanline);
+    }
+    jpeg_finish_compress(&compress);
+    return true;
+}
+
+namespace
+{
+
+struct pool_state
+{
+    // Also when the server exits without stopping the pool, e.g. on an exception
+    ~pool_state()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_queued.notify_all();
+        }
+
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    jpeg_encoder_params m_params;
+    bool m_stopping = false;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+};
+
+pool_state& get_state()
+{
+    static pool_state state;
+    return state;
+}
+
+jpeg_encoder& get_thread_encoder()
+{
+    thread_local jpeg_encoder encoder;
+    return encoder;
+}
+
+void run_tasks()
+{
+    auto& state = get_state();
+    std::unique_lock<std::mutex> lock(state.m_mutex);
+    while (true)
+    {
+        state.m_queued.wait(lock, [&state] { return state.m_stopping || !state.m_tasks.empty(); });
+        if (state.m_stopping)
+        {
+            return;
+        }
+
+        auto task = std::move(state.m_tasks.front());
+        state.m_tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+// The offsets of the frame header and of the scan data of a JPEG written by libjpeg
+bool find_segments(const std::vector<uchar>& jpeg, size_t& frame_header, size_t& scan_header, size_t& scan_data)
+{
+    frame_header = 0;
+    size_t offset = 2;
+    while (offset + 4 <= jpeg.size())
+    {
+        if (jpeg[offset] != 0xFF)
+        {
+            return false;
+        }
+
+        auto marker = jpeg[offset + 1];
+        size_t length = (jpeg[offset + 2] << 8) | jpeg[offset + 3];
+        if ((marker == 0xC0) || (marker == 0xC1))
+        {
+            frame_header = offset;
+        }
+        else if (marker == 0xDA)
+        {
+            scan_header = offset;
+            scan_data = offset + 2 + length;
+            return (frame_header != 0) && (scan_data + 2 <= jpeg.size());
+        }
+        offset += 2 + length;
+    }
+    return false;
+}
+
+// Joins the stripes into the headers of the first one, with the height of the frame.
+// Every stripe but the last one holds restart_interval MCUs, so the restart markers fall between them.
+bool splice_stripes(
+    const std::vector<std::vector<uchar>>& stripes,
+    size_t stripe_count,
+    int height,
+    int restart_interval,
+    std::vector<uchar>& output)
+{
+    size_t frame_header = 0;
+    size_t scan_header = 0;
+    size_t scan_data = 0;
+    const auto& first = stripes[0];
+    if (!find_segments(first, frame_header, scan_header, scan_data))
+    {
+        return false;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < stripe_count; ++i)
+    {
+        size += stripes[i].size();
+    }
+    output.clear();
+    output.reserve(size);
+
+    output.insert(output.end(), first.begin(), first.begin() + scan_header);
+    output[frame_header + 5] = static_cast<uchar>(height >> 8);
+    output[frame_header + 6] = static_cast<uchar>(height);
+    const uchar restart[] = {0xFF, 0xDD, 0x00, 0x04,
+        static_cast<uchar>(restart_interval >> 8), static_cast<uchar>(restart_interval)};
+    output.insert(output.end(), restart, restart + sizeof(restart));
+    output.insert(output.end(), first.begin() + scan_header, first.end() - 2);
+
+    for (size_t i = 1; i < stripe_count; ++i)
+    {
+        const auto& stripe = stripes[i];
+        if (!find_segments(stripe, frame_header, scan_header, scan_data))
+        {
+            return false;
+        }
+        output.push_back(0xFF);
+        output.push_back(static_cast<uchar>(0xD0 + (i - 1) % 8));
+        output.insert(output.end(), stripe.begin() + scan_data, stripe.end() - 2);
+    }
+    output.push_back(0xFF);
+    output.push_back(0xD9);
+    return true;
+}
+
+} // anonymous namespace
+
+std::string get_jpeg_settings_key(const jpeg_settings& settings)
+{
+    return ";jpeg=" + std::to_string(settings.m_quality)
+        + (settings.m_subsampling ? ",420" : ",444")
+        + (settings.m_fast_dct ? ",fast" : "")
+        + (settings.m_optimize ? ",optimize" : "")
+        + (settings.m_progressive ? ",progressive" : "");
+}
+
+void jpeg_encoder_pool::configure(const jpeg_encoder_params& params)
+{
+    auto& state = get_state();
+    state.m_params = params;
+    state.m_stopping = false;
+    for (int i = 0; i < params.m_threads; ++i)
+    {
+        state.m_threads.emplace_back(run_tasks);
+    }
+}
+
+void jpeg_encoder_pool::stop()
+{
+    get_state().stop();
+}
+
+bool jpeg_encoder_pool::encode(const cv::Mat& frame, const jpeg_settings& settings, std::vector<uchar>& output)
+{
+    if (frame.type() != CV_8UC3)
+    {
+        return cv::imencode(".jpg", frame, output, std::vector<int>{cv::IMWRITE_JPEG_QUALITY, settings.m_quality});
+    }
+
+    // Stripes of whole MCU rows, none left empty
+    auto& state = get_state();
+    int mcu_size = settings.m_subsampling ? 16 : 8;
+    int mcu_rows = (frame.rows + mcu_size - 1) / mcu_size;
+    int stripe_count = 1;
+    if (!state.m_threads.empty() && !settings.m_optimize && !settings.m_progressive
+        && (frame.total() >= state.m_params.m_parallel_min_pixels))
+    {
+        stripe_count = std::min(static_cast<int>(state.m_threads.size()) + 1, mcu_rows);
+    }
+    int stripe_mcu_rows = (mcu_rows + stripe_count - 1) / stripe_count;
+    stripe_count = (mcu_rows + stripe_mcu_rows - 1) / stripe_mcu_rows;
+    int restart_interval = (frame.cols + mcu_size - 1) / mcu_size * stripe_mcu_rows;
+    if ((stripe_count < 2) || (restart_interval > 0xFFFF))
+    {
+        return get_thread_encoder().encode(frame, settings, output);
+    }
+
+    thread_local std::vector<std::vector<uchar>> stripes;
+    stripes.resize(std::max<size_t>(stripes.size(), stripe_count));
+    int stripe_rows = stripe_mcu_rows * mcu_size;
+
+    std::vector<std::future<bool>> encoded;
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        for (int i = 1; i < stripe_count; ++i)
+        {
+            auto first_row = i * stripe_rows;
+            auto row_count = std::min(stripe_rows, frame.rows - first_row);
+            auto& stripe = stripes[i];
+            auto task = std::make_shared<std::packaged_task<bool()>>([&frame, &settings, &stripe, first_row, row_count]
+            {
+                return get_thread_encoder().encode(frame, settings, stripe, first_row, row_count);
+            });
+            encoded.push_back(task->get_future());
+            state.m_tasks.emplace_back([task] { (*task)(); });
+        }
+        state.m_queued.notify_all();
+    }
+
+    // The stripes refer to the frame, all of them are waited for
+    bool succeeded = get_thread_encoder().encode(frame, settings, stripes[0], 0, stripe_rows);
+    for (auto& stripe : encoded)
+    {
+        succeeded = stripe.get() && succeeded;
+    }
+
+    return succeeded && splice_stripes(stripes, stripe_count, frame.rows, restart_interval, output);
+}
@@ -0,0 +1,347 @@
+#include "frames/jpeg_overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <jpeglib.h>
+
+namespace
+{
+
+struct error_manager
+{
+    jpeg_error_mgr m_manager;
+    jmp_buf m_jump;
+};
+
+void on_error(j_common_ptr info)
+{
+    longjmp(reinterpret_cast<error_manager*>(info->err)->m_jump, 1);
+}
+
+void on_message(j_common_ptr)
+{
+}
+
+// The libjpeg state of a patch, released however the patch ends.
+// Constructed before the setjmp, so a libjpeg error skips no destructor.
+struct transcoder
+{
+    transcoder()
+    {
+        std::memset(&m_decompress, 0, sizeof(m_decompress));
+        std::memset(&m_compress, 0, sizeof(m_compress));
+        m_decompress.err = jpeg_std_error(&m_error.m_manager);
+        m_compress.err = &m_error.m_manager;
+        m_error.m_manager.error_exit = on_error;
+        m_error.m_manager.output_message = on_message;
+    }
+
+    ~transcoder()
+    {
+        // Destroying a structure that was never created does nothing
+        jpeg_destroy_compress(&m_compress);
+        jpeg_destroy_decompress(&m_decompress);
+        free(m_output);
+    }
+
+    jpeg_decompress_struct m_decompress;
+    jpeg_compress_struct m_compress;
+    error_manager m_error;
+    unsigned char* m_output = nullptr;
+    unsigned long m_output_size = 0;
+};
+
+// The EXIF orientation of the image, 1 if it has none
+int get_orientation(const jpeg_decompress_struct& decompress)
+{
+    for (auto marker = decompress.marker_list; marker; marker = marker->next)
+    {
+        const JOCTET* data = marker->data;
+        size_t size = marker->data_length;
+        if ((marker->marker != JPEG_APP0 + 1) || (size < 14) || (std::memcmp(data, "Exif\0\0", 6) != 0))
+        {
+            continue;
+        }
+
+        // A TIFF header, the orientation is an entry of the first directory
+        const JOCTET* tiff = data + 6;
+        size -= 6;
+        bool little_endian = (tiff[0] == 'I');
+        auto read16 = [&](size_t offset) -> uint32_t
+        {
+            return little_endian ? (tiff[offset] | (tiff[offset + 1] << 8)) : ((tiff[offset] << 8) | tiff[offset + 1]);
+        };
+        auto read32 = [&](size_t offset) -> uint32_t
+        {
+            return little_endian ? (read16(offset) | (read16(offset + 2) << 16)) : ((read16(offset) << 16) | read16(offset + 2));
+        };
+
+        size_t directory = read32(4);
+        if (directory + 2 > size)
+        {
+            return 1;
+        }
+        size_t entries = read16(directory);
+        for (size_t i = 0; i < entries; ++i)
+        {
+            size_t entry = directory + 2 + i * 12;
+            if (entry + 12 > size)
+            {
+                break;
+            }
+            if (read16(entry) == 0x0112)
+            {
+                return read16(entry + 8);
+            }
+        }
+        return 1;
+    }
+    return 1;
+}
+
+} // anonymous namespace
+
+jpeg_overlay::jpeg_overlay()
+{
+    for (int x = 0; x < 8; ++x)
+    {
+        for (int u = 0; u < 8; ++u)
+        {
+            m_basis[x][u] = ((u == 0) ? std::sqrt(0.125f) : 0.5f) * std::cos((2 * x + 1) * u * M_PI / 16);
+        }
+    }
+}
+
+bool jpeg_overlay::draw_boxes(
+    const std::vector<uchar>& source,
+    const std::vector<Detection>& detections,
+    const cv::Scalar& color,
+    std::vector<uchar>& output)
+{
+    if (!patch(source, detections, color, output))
+    {
+        ++m_fallback_count;
+        return false;
+    }
+
+    ++m_patched_count;
+    return true;
+}
+
+uint64_t jpeg_overlay::get_patched_count() const
+{
+    return m_patched_count;
+}
+
+uint64_t jpeg_overlay::get_fallback_count() const
+{
+    return m_fallback_count;
+}
+
+bool jpeg_overlay::patch(
+    const std::vector<uchar>& source,
+    const std::vector<Detection>& detections,
+    const cv::Scalar& color,
+    std::vector<uchar>& output)
+{
+    if ((source.size() < 4) || (source[0] != 0xFF) || (source[1] != 0xD8))
+    {
+        return false;
+    }
+
+    transcoder codecs;
+    auto& decompress = codecs.m_decompress;
+    auto& compress = codecs.m_compress;
+    if (setjmp(codecs.m_error.m_jump))
+    {
+        return false;
+    }
+
+    jpeg_create_decompress(&decompress);
+    jpeg_create_compress(&compress);
+    jpeg_mem_src(&decompress, const_cast<unsigned char*>(source.data()), source.size());
+    jpeg_save_markers(&decompress, JPEG_APP0 + 1, 0xFFFF);
+    if ((jpeg_read_header(&decompress, TRUE) != JPEG_HEADER_OK)
+        || (decompress.num_components != 3)
+        || (decompress.jpeg_color_space != JCS_YCbCr)
+        || (get_orientation(decompress) != 1))
+    {
+        return false;
+    }
+
+    auto coefficients = jpeg_read_coefficients(&decompress);
+
+    // The BGR color in JFIF YCbCr
+    const float values[3] = {
+        static_cast<float>(0.299 * color[2] + 0.587 * color[1] + 0.114 * color[0]),
+        static_cast<float>(-0.168736 * color[2] - 0.331264 * color[1] + 0.5 * color[0] + 128),
+        static_cast<float>(0.5 * color[2] - 0.418688 * color[1] - 0.081312 * color[0] + 128)};
+
+    for (int c = 0; c < 3; ++c)
+    {
+        const auto& component = decompress.comp_info[c];
+        mark_edges(detections, decompress.image_width, decompress.image_height,
+            component.h_samp_factor, decompress.max_h_samp_factor,
+            component.v_samp_factor, decompress.max_v_samp_factor,
+            component.width_in_blocks);
+
+        for (const auto& block : m_block_masks)
+        {
+            auto rows = (*decompress.mem->access_virt_barray)(reinterpret_cast<j_common_ptr>(&decompress),
+                coefficients[c], block.first / component.width_in_blocks, 1, TRUE);
+            patch_block(rows[0][block.first % component.width_in_blocks], component.quant_table->quantval,
+                block.second, values[c]);
+        }
+    }
+
+    // The entropy coding is redone, the quantization tables and the sampling stay the source's
+    jpeg_copy_critical_parameters(&decompress, &compress);
+    jpeg_mem_dest(&compress, &codecs.m_output, &codecs.m_output_size);
+    jpeg_write_coefficients(&compress, coefficients);
+    jpeg_finish_compress(&compress);
+    jpeg_finish_decompress(&decompress);
+
+    output.assign(codecs.m_output, codecs.m_output + codecs.m_output_size);
+    return true;
+}
+
+void jpeg_overlay::mark_edges(
+    const std::vector<Detection>& detections,
+    int image_width,
+    int image_height,
+    int horizontal_factor,
+    int max_horizontal_factor,
+    int vertical_factor,
+    int max_vertical_factor,
+    uint32_t width_in_blocks)
+{
+    m_block_masks.clear();
+    auto mark = [&](int x, int y)
+    {
+        x = x * horizontal_factor / max_horizontal_factor;
+        y = y * vertical_factor / max_vertical_factor;
+        m_block_masks.emplace_back((y / 8) * width_in_blocks + x / 8, uint64_t(1) << ((y % 8) * 8 + x % 8));
+    };
+
+    // The corners in pixels as cv::rectangle takes them, the edges clipped to the image
+    for (const auto& detection : detections)
+    {
+        int left = static_cast<int>(detection.mBox[0] * image_width);
+        int top = static_cast<int>(detection.mBox[1] * image_height);
+        int right = static_cast<int>(detection.mBox[2] * image_width);
+        int bottom = static_cast<int>(detection.mBox[3] * image_height);
+        if (left > right)
+        {
+            std::swap(left, right);
+        }
+        if (top > bottom)
+        {
+            std::swap(top, bottom);
+        }
+
+        int first_column = std::max(left, 0);
+        int last_column = std::min(right, image_width - 1);
+        int first_row = std::max(top, 0);
+        int last_row = std::min(bottom, image_height - 1);
+        for (int y : {top, bottom})
+        {
+            if ((y < 0) || (y >= image_height))
+            {
+                continue;
+            }
+            for (int x = first_column; x <= last_column; ++x)
+            {
+                mark(x, y);
+            }
+        }
+        for (int x : {left, right})
+        {
+            if ((x < 0) || (x >= image_width))
+            {
+                continue;
+            }
+            for (int y = first_row; y <= last_row; ++y)
+            {
+                mark(x, y);
+            }
+        }
+    }
+
+    // One entry per block, in the order of the blocks
+    std::sort(m_block_masks.begin(), m_block_masks.end());
+    size_t merged = 0;
+    for (size_t i = 0; i < m_block_masks.size(); ++i)
+    {
+        if ((merged > 0) && (m_block_masks[merged - 1].first == m_block_masks[i].first))
+        {
+            m_block_masks[merged - 1].second |= m_block_masks[i].second;
+        }
+        else
+        {
+            m_block_masks[merged++] = m_block_masks[i];
+        }
+    }
+    m_block_masks.resize(merged);
+}
+
+void jpeg_overlay::patch_block(short* coefficients, const uint16_t* quantization, uint64_t mask, float value)
+{
+    // The coefficients are in the natural order, row by row of the vertical frequencies
+    float block[8][8];
+    float temp[8][8];
+    for (int v = 0; v < 8; ++v)
+    {
+        for (int x = 0; x < 8; ++x)
+        {
+            float sum = 0.0f;
+            for (int u = 0; u < 8; ++u)
+            {
+                sum += coefficients[v * 8 + u] * quantization[v * 8 + u] * m_basis[x][u];
+            }
+            temp[v][x] = sum;
+        }
+    }
+    for (int y = 0; y < 8; ++y)
+    {
+        for (int x = 0; x < 8; ++x)
+        {
+            float sum = 0.0f;
+            for (int v = 0; v < 8; ++v)
+            {
+                sum += m_basis[y][v] * temp[v][x];
+            }
+            // Level shifted by 128, the unmarked samples keep their exact values
+            block[y][x] = (mask & (uint64_t(1) << (y * 8 + x))) ? value - 128.0f : sum;
+        }
+    }
+
+    for (int y = 0; y < 8; ++y)
+    {
+        for (int u = 0; u < 8; ++u)
+        {
+            float sum = 0.0f;
+            for (int x = 0; x < 8; ++x)
+            {
+                sum += block[y][x] * m_basis[x][u];
+            }
+            temp[y][u] = sum;
+        }
+    }
+    for (int v = 0; v < 8; ++v)
+    {
+        for (int u = 0; u < 8; ++u)
+        {
+            float sum = 0.0f;
+            for (int y = 0; y < 8; ++y)
+            {
+                sum += m_basis[y][v] * temp[y][u];
+            }
+            coefficients[v * 8 + u] = static_cast<short>(std::lround(sum / quantization[v * 8 + u]));
+        }
+    }
+}
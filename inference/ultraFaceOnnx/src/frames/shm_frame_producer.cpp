@@ -0,0 +1,93 @@
+#include "frames/shm_frame_producer.h"
+
+#include <chrono>
+#include <cstring>
+
+shm_frame_producer::shm_frame_producer(const std::string& name, uint32_t slot_count, uint32_t slot_size)
+    :m_ring(shm_ring::create(name, slot_count, slot_size))
+{
+}
+
+shm_frame_producer::~shm_frame_producer()
+{
+    close();
+    m_ring.unlink();
+}
+
+bool shm_frame_producer::write_frame(const cv::Mat& frame)
+{
+    if (frame.type() != CV_8UC3)
+    {
+        return false;
+    }
+
+    auto row_size = frame.cols * frame.elemSize();
+    auto slot = acquire_slot(row_size * frame.rows);
+    if (!slot)
+    {
+        return false;
+    }
+
+    auto data = m_ring.slot_data(slot->m_sequence);
+    for (int row = 0; row < frame.rows; ++row)
+    {
+        std::memcpy(data + row * row_size, frame.ptr(row), row_size);
+    }
+
+    slot->m_format = shm_frame_format::raw_bgr;
+    slot->m_rows = frame.rows;
+    slot->m_cols = frame.cols;
+    slot->m_step = row_size;
+    slot->m_size = row_size * frame.rows;
+    publish_slot();
+
+    return true;
+}
+
+bool shm_frame_producer::write_jpeg(const unsigned char* data, size_t size)
+{
+    auto slot = acquire_slot(size);
+    if (!slot)
+    {
+        return false;
+    }
+
+    std::memcpy(m_ring.slot_data(slot->m_sequence), data, size);
+    slot->m_format = shm_frame_format::jpeg;
+    slot->m_rows = 0;
+    slot->m_cols = 0;
+    slot->m_step = 0;
+    slot->m_size = size;
+    publish_slot();
+
+    return true;
+}
+
+void shm_frame_producer::close()
+{
+    m_ring.header().m_closed.store(1, std::memory_order_release);
+}
+
+shm_slot_header* shm_frame_producer::acquire_slot(size_t size)
+{
+    auto& header = m_ring.header();
+    auto head = header.m_head.load(std::memory_order_relaxed);
+    auto tail = header.m_tail.load(std::memory_order_acquire);
+    if ((head - tail >= header.m_slot_count) || (size > header.m_slot_size))
+    {
+        return nullptr;
+    }
+
+    auto& slot = m_ring.slot_header(head);
+    slot.m_sequence = head;
+    return &slot;
+}
+
+void shm_frame_producer::publish_slot()
+{
+    auto& header = m_ring.header();
+    auto head = header.m_head.load(std::memory_order_relaxed);
+    m_ring.slot_header(head).m_timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    header.m_head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,148 @@
+#include "frames/shm_frame_reader.h"
+#include "trace/tracer.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <cerrno>
+#include <signal.h>
+#include <system_error>
+#include <unistd.h>
+
+shm_frame_reader::shm_frame_reader(const std::string& name)
+    :m_ring(shm_ring::open(name)),
+    m_last_frame_time(std::chrono::steady_clock::now())
+{
+    claim_ring();
+}
+
+shm_frame_reader::~shm_frame_reader()
+{
+    release_slot();
+
+    int32_t consumer = getpid();
+    m_ring.header().m_consumer_pid.compare_exchange_strong(consumer, 0, std::memory_order_release);
+}
+
+void shm_frame_reader::claim_ring()
+{
+    auto& consumer_pid = m_ring.header().m_consumer_pid;
+    int32_t consumer = 0;
+    while (!consumer_pid.compare_exchange_strong(consumer, getpid(), std::memory_order_acquire))
+    {
+        // Another reader of this process, or of a process still running
+        if ((consumer == getpid()) || (kill(consumer, 0) == 0) || (errno != ESRCH))
+        {
+            throw std::system_error(EBUSY, std::generic_category(), "The frames ring has a consumer already");
+        }
+    }
+}
+
+bool shm_frame_reader::is_finished()
+{
+    const auto& header = m_ring.header();
+    return m_timed_out
+        || ((m_producer_gone || header.m_closed.load(std::memory_order_acquire))
+            && (header.m_tail.load(std::memory_order_relaxed) + (m_holds_slot ? 1 : 0)
+                == header.m_head.load(std::memory_order_acquire)));
+}
+
+bool shm_frame_reader::is_waiting() const
+{
+    return m_waiting;
+}
+
+bool shm_frame_reader::is_frame_shared() const
+{
+    return m_holds_slot;
+}
+
+cv::Mat shm_frame_reader::read_frame()
+{
+    // The previous frame is not used anymore, give its slot back to the producer
+    release_slot();
+
+    auto& header = m_ring.header();
+    auto tail = header.m_tail.load(std::memory_order_relaxed);
+    auto now = std::chrono::steady_clock::now();
+    m_waiting = false;
+    if (header.m_head.load(std::memory_order_acquire) == tail)
+    {
+        // A producer that died without closing the ring ends the stream as well
+        if (!header.m_closed.load(std::memory_order_acquire))
+        {
+            if (now - m_last_frame_time > m_wait_timeout)
+            {
+                m_timed_out = true;
+            }
+            else if (!is_producer_alive())
+            {
+                m_producer_gone = true;
+            }
+            else
+            {
+                m_waiting = true;
+            }
+        }
+        return cv::Mat();
+    }
+    m_last_frame_time = now;
+
+    // The slot header is the producer's to write, it is read once
+    auto slot = m_ring.slot_header(tail);
+    auto data = m_ring.slot_data(tail);
+    if (!is_slot_valid(slot))
+    {
+        // Skipped, the frame would not fit in the slot
+        advance_tail();
+        return cv::Mat();
+    }
+
+    if (slot.m_format == shm_frame_format::jpeg)
+    {
+        // Decoding already copies, so the slot can be reused right away
+        cv::Mat frame;
+        {
+            trace_span span("decode");
+            frame = cv::imdecode(cv::Mat(1, slot.m_size, CV_8UC1, data), cv::IMREAD_COLOR);
+        }
+        advance_tail();
+        return frame;
+    }
+
+    m_holds_slot = true;
+    return cv::Mat(slot.m_rows, slot.m_cols, CV_8UC3, data, slot.m_step);
+}
+
+bool shm_frame_reader::is_slot_valid(const shm_slot_header& slot) const
+{
+    uint64_t slot_size = m_ring.get_slot_size();
+    if (slot.m_format == shm_frame_format::jpeg)
+    {
+        return (slot.m_size > 0) && (slot.m_size <= slot_size);
+    }
+
+    uint64_t row_size = uint64_t(slot.m_cols) * 3;
+    return (slot.m_format == shm_frame_format::raw_bgr)
+        && (slot.m_rows > 0) && (slot.m_cols > 0)
+        && (slot.m_step >= row_size)
+        && (uint64_t(slot.m_step) * (slot.m_rows - 1) + row_size <= slot_size);
+}
+
+void shm_frame_reader::release_slot()
+{
+    if (m_holds_slot)
+    {
+        advance_tail();
+        m_holds_slot = false;
+    }
+}
+
+void shm_frame_reader::advance_tail()
+{
+    m_ring.header().m_tail.fetch_add(1, std::memory_order_release);
+}
+
+bool shm_frame_reader::is_producer_alive() const
+{
+    return (kill(m_ring.header().m_producer_pid, 0) == 0) || (errno != ESRCH);
+}
@@ -0,0 +1,89 @@
+#include "frames/shm_ring.h"
+
+#include <cerrno>
+#include <new>
+#include <system_error>
+#include <unistd.h>
+
+shm_ring shm_ring::create(const std::string& name, uint32_t slot_count, uint32_t slot_size)
+{
+    auto segment = shm_segment::create(name, sizeof(shm_ring_header) + slot_count * get_slot_stride(slot_size));
+
+    auto header = new (segment.data()) shm_ring_header();
+    header->m_slot_count = slot_count;
+    header->m_slot_size = slot_size;
+    header->m_head.store(0, std::memory_order_relaxed);
+    header->m_tail.store(0, std::memory_order_relaxed);
+    header->m_closed.store(0, std::memory_order_relaxed);
+    header->m_producer_pid = getpid();
+    header->m_consumer_pid.store(0, std::memory_order_relaxed);
+    header->m_version = SHM_RING_VERSION;
+    // Consumers check the magic before anything else
+    std::atomic_thread_fence(std::memory_order_release);
+    header->m_magic = SHM_RING_MAGIC;
+
+    return shm_ring(std::move(segment), slot_count, slot_size);
+}
+
+shm_ring shm_ring::open(const std::string& name)
+{
+    auto segment = shm_segment::open(name);
+    if (segment.size() < sizeof(shm_ring_header))
+    {
+        throw std::system_error(EINVAL, std::generic_category(), "Not a frames ring: " + name);
+    }
+
+    const auto header = reinterpret_cast<const shm_ring_header*>(segment.data());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto slot_count = header->m_slot_count;
+    auto slot_size = header->m_slot_size;
+    if ((header->m_magic != SHM_RING_MAGIC)
+        || (header->m_version != SHM_RING_VERSION)
+        || (slot_count == 0)
+        || (segment.size() < sizeof(shm_ring_header) + slot_count * get_slot_stride(slot_size)))
+    {
+        throw std::system_error(EINVAL, std::generic_category(), "Not a frames ring: " + name);
+    }
+
+    return shm_ring(std::move(segment), slot_count, slot_size);
+}
+
+shm_ring::shm_ring(shm_segment&& segment, uint32_t slot_count, uint32_t slot_size)
+    :m_segment(std::move(segment)),
+    m_slot_count(slot_count),
+    m_slot_size(slot_size)
+{
+}
+
+shm_ring_header& shm_ring::header() const
+{
+    return *reinterpret_cast<shm_ring_header*>(m_segment.data());
+}
+
+shm_slot_header& shm_ring::slot_header(uint64_t sequence) const
+{
+    auto index = sequence % m_slot_count;
+    auto offset = sizeof(shm_ring_header) + index * get_slot_stride(m_slot_size);
+    return *reinterpret_cast<shm_slot_header*>(m_segment.data() + offset);
+}
+
+unsigned char* shm_ring::slot_data(uint64_t sequence) const
+{
+    return reinterpret_cast<unsigned char*>(&slot_header(sequence)) + sizeof(shm_slot_header);
+}
+
+uint32_t shm_ring::get_slot_size() const
+{
+    return m_slot_size;
+}
+
+void shm_ring::unlink()
+{
+    m_segment.unlink();
+}
+
+size_t shm_ring::get_slot_stride(uint32_t slot_size)
+{
+    auto stride = sizeof(shm_slot_header) + slot_size;
+    return (stride + SHM_RING_ALIGNMENT - 1) / SHM_RING_ALIGNMENT * SHM_RING_ALIGNMENT;
+}
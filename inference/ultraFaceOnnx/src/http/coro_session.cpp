@@ -0,0 +1,243 @@
+#include "logger.h"
+#include "http/coro_session.h"
+#include "http/debug_trace.h"
+#include "http/lib.h"
+#include "http/mjpeg.h"
+#include "http/jobs_api.h"
+#include "http/models_api.h"
+#include "http/query.h"
+#include "http/readiness.h"
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/write.hpp>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using stream_protocol = boost::asio::generic::stream_protocol;
+
+coro_session::handler::allocator_type coro_session::handler::get_allocator() const
+{
+    return allocator_type(m_self->m_handler_memory);
+}
+
+void coro_session::handler::operator()(boost::system::error_code ec, std::size_t bytes_transferred)
+{
+    auto& session = *m_self;
+    session.resume(std::move(m_self), ec, bytes_transferred);
+}
+
+void coro_session::run()
+{
+    resume(shared_from_this(), boost::system::error_code(), 0);
+}
+
+#include <boost/asio/yield.hpp>
+
+void coro_session::resume(
+    std::shared_ptr<coro_session>&& self,
+    boost::system::error_code ec,
+    std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+
+    reenter(m_coroutine)
+    {
+        // Make the request empty before reading,
+        // otherwise the operation behavior is undefined.
+        m_req = {};
+
+        log("Started reading socket");
+        yield http::async_read(m_socket, m_buffer, m_req, make_handler(std::move(self)));
+
+        // This indicates that the session was closed
+        if (ec == http::error::end_of_stream)
+        {
+            do_close();
+            yield break;
+        }
+
+        if (ec)
+        {
+            fail(ec, "read");
+            yield break;
+        }
+
+        if (is_trace_request())
+        {
+            if (tracer::start_capture())
+            {
+                log("Capturing a trace.");
+                m_timer.expires_after(m_trace_duration);
+                yield m_timer.async_wait(make_handler(std::move(self)));
+                m_string_res = make_trace_response(m_req.version(), tracer::stop_capture());
+            }
+            else
+            {
+                m_string_res = make_trace_busy_response(m_req.version());
+            }
+        }
+        else if (is_readiness_request())
+        {
+            m_string_res = make_ready_response(m_req.version());
+        }
+        else if (is_models_api_request())
+        {
+            m_string_res = make_models_response(
+                m_model_registry, m_req.method(), query(m_req.target().to_string()), m_req.version());
+        }
+        else if (is_jobs_api_request())
+        {
+            m_string_res = make_jobs_response(
+                m_model_registry, m_req.method(), query(m_req.target().to_string()), m_req.version());
+        }
+
+        if (m_string_res)
+        {
+            yield http::async_write(m_socket, *m_string_res, make_handler(std::move(self)));
+            if (ec)
+            {
+                fail(ec, "write");
+                yield break;
+            }
+
+            do_close();
+            yield break;
+        }
+
+        if (!open_source())
+        {
+            yield break;
+        }
+
+        inference::gLogInfo << "Start streaming the GPU inference results." << std::endl;
+
+        m_header_res = make_mjpeg_header(m_req.version(), m_frame_boundary);
+
+        log("Writing M-JPEG header.");
+        yield http::async_write(m_socket, *m_header_res, make_handler(std::move(self)));
+
+        while (!m_frame_processor.is_finished())
+        {
+            if (ec)
+            {
+                fail(ec, "write");
+                yield break;
+            }
+
+            // A frame left from the previous round goes after the full pause,
+            // otherwise the pause is spent on processing the next frames
+            m_timer.expires_after(
+                m_frame_processor.has_frames()
+                    ? m_frame_processor.get_frame_pause()
+                    : m_frame_processor.process_frames(m_frame_processor.get_frame_pause()));
+            yield m_timer.async_wait(make_handler(std::move(self)));
+
+            // The source had no frame yet, it is polled again after the pause
+            if (!m_frame_processor.has_frames())
+            {
+                continue;
+            }
+
+            yield write_next_frame(std::move(self));
+
+            // A cached frame follows its part header straight from the file
+            while (m_file)
+            {
+                if (ec || send_mjpeg_file(m_socket, *m_file, m_file_offset, ec))
+                {
+                    m_file.reset();
+                }
+                else
+                {
+                    yield m_socket.async_wait(stream_protocol::socket::wait_write, make_handler(std::move(self)));
+                }
+            }
+            m_frame_processor.trace_write_end();
+        }
+
+        log("Closing");
+        do_close();
+    }
+}
+
+#include <boost/asio/unyield.hpp>
+
+boost::asio::executor_binder<coro_session::handler, boost::asio::strand<boost::asio::io_context::executor_type>>
+coro_session::make_handler(std::shared_ptr<coro_session>&& self)
+{
+    return boost::asio::bind_executor(m_strand, handler(std::move(self)));
+}
+
+bool coro_session::is_trace_request()
+{
+    query q(m_req.target().to_string());
+    m_trace_duration = get_trace_duration(q);
+    return is_debug_trace_request(q);
+}
+
+bool coro_session::is_readiness_request()
+{
+    return is_ready_request(query(m_req.target().to_string()));
+}
+
+bool coro_session::is_models_api_request()
+{
+    return is_models_request(query(m_req.target().to_string()));
+}
+
+bool coro_session::is_jobs_api_request()
+{
+    return is_jobs_request(query(m_req.target().to_string()));
+}
+
+bool coro_session::open_source()
+{
+    auto query_string = m_req.target().to_string();
+    log("Parsing request query: " + query_string);
+    query q(query_string);
+    if (q.m_path.empty())
+    {
+        log("Wrong request format: frames source unknown.");
+        return false;
+    }
+
+    return m_frame_processor.open(q);
+}
+
+void coro_session::write_next_frame(std::shared_ptr<coro_session>&& self)
+{
+    auto frame = m_frame_processor.pop_frame();
+    if (frame.m_file)
+    {
+        log_verbose("Writing cached response.");
+        m_file = std::move(frame.m_file);
+        m_file_offset = 0;
+        m_header_res = make_mjpeg_file_header(
+            m_file->get_size(), m_req.version(), m_req.keep_alive(), m_frame_boundary);
+        m_frame_processor.trace_write_start(frame.m_trace_id);
+        http::async_write(m_socket, *m_header_res, make_handler(std::move(self)));
+    }
+    else if (frame.m_buffer.empty())
+    {
+        // Writing termination boundary
+        log("Writing termination boundary.");
+        m_header_res = make_mjpeg_termination(m_req.version(), m_frame_boundary);
+        http::async_write(m_socket, *m_header_res, make_handler(std::move(self)));
+    }
+    else
+    {
+        log_verbose("Writing response.");
+        m_res = make_mjpeg_frame(std::move(frame.m_buffer), m_req.version(), m_req.keep_alive(), m_frame_boundary);
+        m_frame_processor.trace_write_start(frame.m_trace_id);
+        http::async_write(m_socket, *m_res, make_handler(std::move(self)));
+    }
+}
+
+void coro_session::do_close()
+{
+    // Send a shutdown
+    boost::system::error_code ec;
+    m_socket.shutdown(stream_protocol::socket::shutdown_send, ec);
+    m_socket.close();
+}
@@ -0,0 +1,54 @@
+#include "http/debug_trace.h"
+
+#include <boost/beast/version.hpp>
+
+#include <algorithm>
+
+namespace http = boost::beast::http;
+
+bool is_debug_trace_request(const query& q)
+{
+    return (q.m_path.size() == 2) && (q.m_path[0] == "debug") && (q.m_path[1] == "trace");
+}
+
+std::chrono::seconds get_trace_duration(const query& q)
+{
+    const long max_seconds = 60;
+    long seconds = 5;
+    try
+    {
+        seconds = std::stol(q.get_parameter("seconds", "5"));
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    return std::chrono::seconds(std::min(std::max(seconds, 1L), max_seconds));
+}
+
+std::shared_ptr<http::response<http::string_body>> make_trace_response(
+    unsigned version,
+    std::string&& json)
+{
+    auto res = std::make_shared<http::response<http::string_body>>(
+        std::piecewise_construct,
+        std::make_tuple(std::move(json)),
+        std::make_tuple(http::status::ok, version));
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "application/json");
+    res->prepare_payload();
+
+    return res;
+}
+
+std::shared_ptr<http::response<http::string_body>> make_trace_busy_response(
+    unsigned version)
+{
+    auto res = std::make_shared<http::response<http::string_body>>(http::status::service_unavailable, version);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "text/plain");
+    res->body() = "A trace capture is already running.";
+    res->prepare_payload();
+
+    return res;
+}
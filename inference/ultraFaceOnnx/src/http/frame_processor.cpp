@@ -0,0 +1,784 @@
+#include "logger.h"
+#include "http/frame_processor.h"
+#include "http/lib.h"
+#include "http/quality_policy.h"
+#include "inference/planCache.h"
+#include "trace/tracer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <system_error>
+
+namespace
+{
+
+std::string detections_log_directory;
+
+std::string publish_prefix = "ultraface_";
+
+const cv::Scalar box_color(0, 0, 255);
+
+std::string get_source_log_path(const query& q)
+{
+    return get_detections_log_path(detections_log_directory, q.m_path, q.get_parameter("ext", "jpg"));
+}
+
+// The name of the segment ?publish=<name> creates, the clients name nothing outside the prefix
+bool get_publish_segment_name(const std::string& name, std::string& segment_name)
+{
+    if (name.size() > 64)
+    {
+        return false;
+    }
+    for (auto c : name)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && (c != '_') && (c != '-'))
+        {
+            return false;
+        }
+    }
+
+    segment_name = publish_prefix + name;
+    return true;
+}
+
+// A 0 or 1 parameter, false if absent
+bool parse_flag(const std::string& value, bool& flag)
+{
+    if (!value.empty() && (value != "0") && (value != "1"))
+    {
+        return false;
+    }
+
+    flag = (value == "1");
+    return true;
+}
+
+// A whole decimal number, false on anything else, e.g. trailing characters
+bool parse_int(const std::string& value, int& number)
+{
+    size_t parsed = 0;
+    try
+    {
+        number = std::stoi(value, &parsed);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return !value.empty() && (parsed == value.size());
+}
+
+} // anonymous namespace
+
+void frame_processor::set_detections_log_directory(const std::string& directory)
+{
+    detections_log_directory = directory;
+}
+
+void frame_processor::set_publish_prefix(const std::string& prefix)
+{
+    publish_prefix = prefix;
+}
+
+bool frame_processor::open(const query& q)
+{
+    m_frame_reader = m_routing.create_reader(q.m_path[0], q);
+    if (!m_frame_reader)
+    {
+        log(std::string("Unknown frames source: ") + q.m_path[0]);
+        return false;
+    }
+
+    if (!parse_jpeg_settings(q))
+    {
+        return false;
+    }
+
+    if (q.get_parameter("replay") == "1")
+    {
+        return open_replay(q);
+    }
+
+    auto model = q.get_parameter("model");
+    if (!m_inference_context && quality_policy::is_enabled() && model.empty())
+    {
+        auto quality = q.get_parameter("quality", "auto");
+        size_t level = 0;
+        if (quality == "auto")
+        {
+            m_adaptive = true;
+            level = quality_policy::get_level();
+        }
+        else
+        {
+            try
+            {
+                level = std::stoul(quality);
+            }
+            catch (const std::exception&)
+            {
+                level = quality_policy::get_levels_count();
+            }
+
+            if (level >= quality_policy::get_levels_count())
+            {
+                log("Unknown quality level: " + quality);
+                return false;
+            }
+        }
+
+        if (!use_quality_level(level))
+        {
+            return false;
+        }
+    }
+    else if (!m_inference_context)
+    {
+        m_inference_engine = m_model_registry.get_engine(model);
+        if (!m_inference_engine)
+        {
+            log("Unknown model: " + model);
+            return false;
+        }
+
+        m_inference_context = m_inference_engine->get_inference_context();
+    }
+
+    auto track = q.get_parameter("track");
+    if (!track.empty())
+    {
+        // Only "auto" picks the interval from the motion, an interval of 0 frames means nothing
+        TrackerParams params;
+        if (track == "auto")
+        {
+            params.mDetectionInterval = 0;
+        }
+        else if (!parse_int(track, params.mDetectionInterval) || (params.mDetectionInterval < 1))
+        {
+            log("Invalid tracking interval: " + track);
+            return false;
+        }
+        m_tracker = std::unique_ptr<DetectionTracker>(new DetectionTracker(params));
+    }
+
+    auto tiles = q.get_parameter("tiles");
+    if (!tiles.empty())
+    {
+        char separator = 0;
+        try
+        {
+            m_tiling_params.mOverlap = std::stof(q.get_parameter("tile_overlap", "0.2"));
+        }
+        catch (const std::exception&)
+        {
+            m_tiling_params.mOverlap = -1.0f;
+        }
+
+        if ((sscanf(tiles.c_str(), "%d%c%d", &m_tiling_params.mColumns, &separator, &m_tiling_params.mRows) != 3)
+            || (separator != 'x') || (m_tiling_params.mColumns < 1) || (m_tiling_params.mRows < 1)
+            || (m_tiling_params.mOverlap < 0.0f) || (m_tiling_params.mOverlap >= 1.0f))
+        {
+            log("Invalid tiling: " + tiles);
+            return false;
+        }
+        m_tiled = true;
+        m_detection_settings = ";tiles=" + tiles + ";overlap=" + std::to_string(m_tiling_params.mOverlap);
+    }
+
+    auto roi = q.get_parameter("roi");
+    if (!roi.empty())
+    {
+        try
+        {
+            m_roi_interval = std::stoi(roi);
+            m_roi_scale = std::stof(q.get_parameter("roi_scale", "2.0"));
+        }
+        catch (const std::exception&)
+        {
+            m_roi_interval = -1;
+        }
+
+        if ((m_roi_interval < 1) || (m_roi_scale < 1.0f))
+        {
+            log("Invalid region re-detection: " + roi);
+            return false;
+        }
+    }
+
+    if (q.get_parameter("cache") != "0")
+    {
+        m_detection_cache = m_model_registry.get_detection_cache();
+    }
+
+    auto gate = q.get_parameter("gate");
+    if (!gate.empty())
+    {
+        auto gate_refresh = q.get_parameter("gate_refresh", "30");
+        int threshold = 0;
+        int refresh_interval = 0;
+        if (!parse_int(gate, threshold) || !parse_int(gate_refresh, refresh_interval)
+            || (threshold < 0) || (refresh_interval < 0))
+        {
+            log("Invalid change gating: " + gate + " " + gate_refresh);
+            return false;
+        }
+        m_change_detector = std::unique_ptr<change_detector>(new change_detector(threshold, refresh_interval));
+    }
+
+    if (q.get_parameter("attributes") == "1")
+    {
+        m_face_stage = m_model_registry.get_face_stage();
+        if (!m_face_stage)
+        {
+            log("No face stage is configured for the attributes.");
+            return false;
+        }
+    }
+
+    auto publish_name = q.get_parameter("publish");
+    if (!publish_name.empty())
+    {
+        std::string segment_name;
+        if (!get_publish_segment_name(publish_name, segment_name))
+        {
+            log("Invalid shared memory name: " + publish_name);
+            return false;
+        }
+
+        try
+        {
+            m_detections_publisher = std::unique_ptr<detections_publisher>(new detections_publisher(
+                segment_name, m_published_records, m_published_max_boxes,
+                m_face_stage ? m_face_stage->get_output_size() : 0));
+            log("Publishing detections to shared memory: " + segment_name);
+        }
+        catch (const std::system_error& e)
+        {
+            log(std::string("Failed to publish detections: ") + e.what());
+            return false;
+        }
+    }
+
+    if (q.get_parameter("record") == "1")
+    {
+        if (detections_log_directory.empty())
+        {
+            log("No directory is configured for the detections logs.");
+            return false;
+        }
+
+        try
+        {
+            auto path = get_source_log_path(q);
+            m_detections_log_writer = std::unique_ptr<detections_log_writer>(
+                new detections_log_writer(path, m_published_max_boxes));
+            log("Recording detections to: " + path);
+        }
+        catch (const std::system_error& e)
+        {
+            log(std::string("Failed to record detections: ") + e.what());
+            return false;
+        }
+    }
+
+    // The output of a frame must depend on nothing but the frame, and every frame must be published
+    m_cache_outputs = (q.get_parameter("cache") != "0") && output_cache::is_enabled()
+        && !m_tracker && (m_roi_interval == 0) && !m_change_detector && !m_detections_publisher
+        && !m_detections_log_writer;
+
+    return true;
+}
+
+bool frame_processor::open_replay(const query& q)
+{
+    if (detections_log_directory.empty())
+    {
+        log("No directory is configured for the detections logs.");
+        return false;
+    }
+
+    // The detections come from the log as they are, none of the detection options apply
+    try
+    {
+        m_detections_log_reader = std::unique_ptr<detections_log_reader>(
+            new detections_log_reader(get_source_log_path(q)));
+    }
+    catch (const std::system_error& e)
+    {
+        log(std::string("Failed to replay detections: ") + e.what());
+        return false;
+    }
+
+    log("Replaying " + std::to_string(m_detections_log_reader->get_record_count()) + " logged frames.");
+    return true;
+}
+
+void frame_processor::replay_detections(std::vector<Detection>& detections)
+{
+    // The records follow the frames, a seek is only needed after skipped or missing frames
+    auto record_count = m_detections_log_reader->get_record_count();
+    if ((m_replay_record >= record_count)
+        || (m_detections_log_reader->record(m_replay_record).m_frame_index != m_frame_index))
+    {
+        m_replay_record = m_detections_log_reader->seek(m_frame_index);
+    }
+
+    if ((m_replay_record < record_count)
+        && (m_detections_log_reader->record(m_replay_record).m_frame_index == m_frame_index))
+    {
+        m_detections_log_reader->read_detections(m_replay_record++, detections);
+    }
+    else
+    {
+        detections.clear();
+    }
+}
+
+bool frame_processor::is_finished() const
+{
+    return m_frame_reader->is_finished() && m_frame_buffers.empty();
+}
+
+bool frame_processor::has_frames() const
+{
+    return !m_frame_buffers.empty();
+}
+
+std::chrono::nanoseconds frame_processor::get_frame_pause() const
+{
+    return m_frame_pause;
+}
+
+uint64_t frame_processor::get_cache_key(const std::string& identity, const std::string& suffix) const
+{
+    if (identity.empty())
+    {
+        return 0;
+    }
+
+    return hashString(identity + ";" + m_inference_engine->get_model_key() + m_detection_settings + suffix);
+}
+
+bool frame_processor::send_cached_output(const std::string& identity, uint64_t& key)
+{
+    trace_span span("cache");
+    key = get_cache_key(identity, get_jpeg_settings_key(m_jpeg_settings) + (m_compressed_overlay ? ";overlay" : ""));
+    auto output = (key != 0) ? output_cache::lookup(key) : nullptr;
+    if (!output)
+    {
+        return false;
+    }
+
+    m_frame_reader->skip_frame();
+    m_frame_buffers.push(encoded_frame{
+        std::vector<uchar>(),
+        tracer::get_current_trace_id(),
+        tracer::is_enabled() ? tracer::now_us() : -1,
+        std::move(output)});
+    ++m_frame_index;
+    ++m_cached_outputs;
+    return true;
+}
+
+bool frame_processor::parse_jpeg_settings(const query& q)
+{
+    auto quality = q.get_parameter("jpeg_quality");
+    auto subsampling = q.get_parameter("subsampling");
+    auto fast_dct = q.get_parameter("fast_dct");
+    auto optimize = q.get_parameter("optimize");
+    auto progressive = q.get_parameter("progressive");
+    if (!quality.empty())
+    {
+        // The whole value is the number
+        size_t parsed = 0;
+        try
+        {
+            m_jpeg_settings.m_quality = std::stoi(quality, &parsed);
+        }
+        catch (const std::exception&)
+        {
+        }
+        if (parsed != quality.size())
+        {
+            m_jpeg_settings.m_quality = 0;
+        }
+    }
+
+    if ((m_jpeg_settings.m_quality < 1) || (m_jpeg_settings.m_quality > 100)
+        || !(subsampling.empty() || (subsampling == "420") || (subsampling == "444"))
+        || !parse_flag(fast_dct, m_jpeg_settings.m_fast_dct)
+        || !parse_flag(optimize, m_jpeg_settings.m_optimize)
+        || !parse_flag(progressive, m_jpeg_settings.m_progressive))
+    {
+        log("Invalid JPEG settings: " + quality + " " + subsampling + " " + fast_dct + " " + optimize + " " + progressive);
+        return false;
+    }
+    m_jpeg_settings.m_subsampling = (subsampling != "444");
+
+    // A patched source keeps its own settings, so only the default ones allow it
+    m_compressed_overlay = (q.get_parameter("overlay") != "full")
+        && (get_jpeg_settings_key(m_jpeg_settings) == get_jpeg_settings_key(jpeg_settings()));
+    return true;
+}
+
+bool frame_processor::use_quality_level(size_t level)
+{
+    const auto& settings = quality_policy::get_level_settings(level);
+    auto engine = m_model_registry.get_engine(settings.m_model);
+    if (!engine)
+    {
+        log("Unknown model of the quality level: " + settings.m_model);
+        return false;
+    }
+
+    // The previous context is kept warm by the engine it was created by, for the next switch or session
+    if (m_inference_engine && m_inference_context)
+    {
+        m_inference_engine->add_prepared_context(std::move(m_inference_context));
+    }
+    m_inference_context = engine->get_inference_context();
+    m_inference_engine = engine;
+    m_frame_pause = settings.m_frame_pause;
+    m_quality_level = level;
+    return true;
+}
+
+std::chrono::nanoseconds frame_processor::process_frames(std::chrono::nanoseconds pause)
+{
+    log_verbose("Start processing frames.");
+    if (m_adaptive && (quality_policy::get_level() != m_quality_level))
+    {
+        if (!use_quality_level(quality_policy::get_level()))
+        {
+            // Not retried for every frame, the session keeps the level it has
+            log("Quality level of the session " + std::to_string(m_session_id) + " pinned to " + std::to_string(m_quality_level));
+            m_adaptive = false;
+        }
+    }
+
+    do
+    {
+        auto processing_start = std::chrono::high_resolution_clock::now();
+        {
+            trace_scope scope(tracer::make_trace_id(m_session_id, m_frame_index));
+            trace_span span("process");
+            process_frame();
+        }
+        auto processing_end = std::chrono::high_resolution_clock::now();
+        auto processing_time = processing_end - processing_start;
+        m_statistics.update_avg_processing(processing_time.count());
+        quality_policy::report_frame(processing_time);
+        pause -= processing_time;
+    } while (!m_frame_reader->is_finished() && !m_frame_reader->is_waiting()
+        && (pause.count() > m_statistics.get_avg_processing_time()));
+
+    if (m_frame_reader->is_finished())
+    {
+        // Denotes end of images list
+        log("Image list finished.");
+        if (m_tracker)
+        {
+            log("Detected " + std::to_string(m_detected_frames) + " frames, tracked "
+                + std::to_string(m_tracked_frames) + " frames.");
+        }
+        if (m_change_detector)
+        {
+            log("Inferred " + std::to_string(m_change_detector->get_inferred_count()) + " frames, skipped "
+                + std::to_string(m_change_detector->get_skipped_count()) + " static frames.");
+        }
+        if (m_cache_outputs)
+        {
+            log("Sent " + std::to_string(m_cached_outputs) + " frames from the output cache.");
+        }
+        if (m_jpeg_overlay.get_patched_count() > 0)
+        {
+            log("Patched the boxes into " + std::to_string(m_jpeg_overlay.get_patched_count())
+                + " source JPEGs, encoded " + std::to_string(m_jpeg_overlay.get_fallback_count()) + " frames in full.");
+        }
+        if (m_detections_log_writer)
+        {
+            m_detections_log_writer->commit();
+            log("Committed the recorded detections.");
+        }
+        m_frame_buffers.push(encoded_frame{std::vector<uchar>(), 0, -1});
+    }
+    else if (m_frame_buffers.empty())
+    {
+        // Nothing to write yet, the session comes back after the pause
+        return std::max<std::chrono::nanoseconds>(pause, m_poll_pause);
+    }
+
+    return pause;
+}
+
+encoded_frame frame_processor::pop_frame()
+{
+    auto frame = std::move(m_frame_buffers.front());
+    m_frame_buffers.pop();
+
+    if ((frame.m_queued_us >= 0) && tracer::is_enabled())
+    {
+        tracer::record("queue", frame.m_trace_id, frame.m_queued_us, tracer::now_us());
+    }
+
+    return frame;
+}
+
+void frame_processor::trace_write_start(uint64_t trace_id)
+{
+    m_write_trace_id = trace_id;
+    m_write_start_us = tracer::is_enabled() ? tracer::now_us() : -1;
+}
+
+void frame_processor::trace_write_end()
+{
+    if ((m_write_start_us >= 0) && tracer::is_enabled())
+    {
+        tracer::record("write", m_write_trace_id, m_write_start_us, tracer::now_us());
+    }
+    m_write_start_us = -1;
+}
+
+bool frame_processor::detect(const cv::Mat& frame, std::vector<Detection>& detections)
+{
+    if (m_tiled)
+    {
+        inference_in_flight in_flight;
+        return inferTiles(*m_inference_context, frame, getTiles(frame.size(), m_tiling_params), detections);
+    }
+
+    cv::Mat input_frame;
+    cv::Size input_size(
+        m_inference_context->get_input_width(),
+        m_inference_context->get_input_height());
+    if (frame.size() == input_size)
+    {
+        // Preprocess straight from the frame (e.g. shared memory) without a copy
+        input_frame = frame;
+    }
+    else
+    {
+        trace_span span("resize");
+        cv::resize(frame, input_frame, input_size);
+    }
+    std::vector<cv::Mat> batch;
+    batch.push_back(std::move(input_frame));
+
+    log_verbose("Running inference!");
+    inference_in_flight in_flight;
+    return m_inference_context->infer(batch, detections);
+}
+
+bool frame_processor::detect_regions(const cv::Mat& frame, std::vector<Detection>& detections)
+{
+    if (m_roi_detections.empty() || (++m_frames_since_full_pass >= m_roi_interval))
+    {
+        m_frames_since_full_pass = 0;
+        return false;
+    }
+
+    cv::Size input_size(
+        m_inference_context->get_input_width(),
+        m_inference_context->get_input_height());
+    auto regions = getDetectionRegions(frame.size(), input_size, m_roi_detections, m_roi_scale);
+
+    detections.clear();
+    {
+        inference_in_flight in_flight;
+        if (!inferTiles(*m_inference_context, frame, regions, detections))
+        {
+            return false;
+        }
+    }
+
+    // The faces left the regions, a full frame pass finds them again
+    if (detections.empty())
+    {
+        m_frames_since_full_pass = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void frame_processor::process_frame()
+{
+    cv::Mat frame;
+    std::vector<Detection> detections;
+    std::vector<Detection> cached_detections;
+
+    bool finished = false;
+    do
+    {
+        // Looked up before the read, only the cached outputs save the decode too
+        std::string identity;
+        if (m_cache_outputs || m_detection_cache)
+        {
+            identity = m_frame_reader->get_frame_identity();
+        }
+
+        uint64_t output_key = 0;
+        if (m_cache_outputs && send_cached_output(identity, output_key))
+        {
+            return;
+        }
+
+        uint64_t cache_key = 0;
+        bool cached = false;
+        if (m_detection_cache && (!m_tracker || m_tracker->is_detection_due()))
+        {
+            trace_span span("cache");
+            cache_key = get_cache_key(identity);
+            cached = (cache_key != 0) && m_detection_cache->lookup(cache_key, cached_detections);
+        }
+
+        log_verbose("Reading next frame");
+        {
+            trace_span span("read");
+            frame = m_frame_reader->read_frame();
+        }
+        if (frame.empty())
+        {
+            if (m_frame_reader->is_waiting())
+            {
+                // The session polls the source again after a pause
+                return;
+            }
+            log_verbose("Frame is empty. Skipped.");
+            continue;
+        }
+        
+        bool changed = true;
+        if (m_change_detector)
+        {
+            trace_span span("gate");
+            changed = m_change_detector->is_changed(frame);
+        }
+
+        if (!changed)
+        {
+            detections = m_last_detections;
+        }
+        else if (m_tracker && !m_tracker->is_detection_due())
+        {
+            trace_span span("track");
+            m_tracker->predict(detections);
+            ++m_tracked_frames;
+        }
+        else
+        {
+            if (cached)
+            {
+                detections = std::move(cached_detections);
+            }
+            else if (m_detections_log_reader)
+            {
+                trace_span span("replay");
+                replay_detections(detections);
+            }
+            else if (!((m_roi_interval > 0) && detect_regions(frame, detections)))
+            {
+                if (!detect(frame, detections))
+                {
+                    inference::gLogError << "Error during inference!" << std::endl;
+                    continue;
+                }
+                if (cache_key != 0)
+                {
+                    m_detection_cache->store(cache_key, detections);
+                }
+            }
+            log_verbose("Inference successfull.");
+
+            if (m_tracker)
+            {
+                m_tracker->update(detections);
+            }
+            if (m_roi_interval > 0)
+            {
+                m_roi_detections = detections;
+            }
+            ++m_detected_frames;
+        }
+
+        if (m_face_stage && changed)
+        {
+            trace_span span("face_stage");
+            if (!m_face_stage->process(frame, detections))
+            {
+                inference::gLogError << "Error during the face stage!" << std::endl;
+            }
+        }
+
+        if (m_change_detector && changed)
+        {
+            m_last_detections = detections;
+        }
+
+        if (m_detections_publisher)
+        {
+            m_detections_publisher->publish(m_frame_index, frame.cols, frame.rows, detections);
+        }
+        if (m_detections_log_writer)
+        {
+            trace_span span("record");
+            m_detections_log_writer->append(m_frame_index, detections);
+        }
+        ++m_frame_index;
+
+        std::vector<uchar> buffer;
+        const auto* source = m_compressed_overlay ? m_frame_reader->get_encoded_frame() : nullptr;
+        bool patched = false;
+        if (source && !source->empty())
+        {
+            trace_span span("overlay");
+            patched = m_jpeg_overlay.draw_boxes(*source, detections, box_color, buffer);
+        }
+
+        if (!patched)
+        {
+            log_verbose("Drawing detections.");
+            {
+                trace_span span("draw");
+                if (!detections.empty() && m_frame_reader->is_frame_shared())
+                {
+                    // The boxes go on a copy, the frame is in memory the producer reuses
+                    frame = frame.clone();
+                }
+                int width = frame.cols;
+                int height = frame.rows;
+                for (const auto& detection: detections)
+                {
+                    cv::rectangle(
+                        frame,
+                        cv::Point(detection.mBox[0] * width, detection.mBox[1] * height),
+                        cv::Point(detection.mBox[2] * width, detection.mBox[3] * height),
+                        box_color);
+                }
+            }
+
+            trace_span span("encode");
+            if (!jpeg_encoder_pool::encode(frame, m_jpeg_settings, buffer))
+            {
+                inference::gLogError << "Error during the JPEG encoding!" << std::endl;
+                continue;
+            }
+        }
+        if (output_key != 0)
+        {
+            trace_span span("cache_store");
+            output_cache::store(output_key, buffer);
+        }
+        m_frame_buffers.push(encoded_frame{
+            std::move(buffer),
+            tracer::get_current_trace_id(),
+            tracer::is_enabled() ? tracer::now_us() : -1});
+        log_verbose("Frame ready.");
+    }
+    while(frame.empty() && !m_frame_reader->is_finished());
+    
+    log_verbose("Finished processing frame.");
+}
\ No newline at end of file
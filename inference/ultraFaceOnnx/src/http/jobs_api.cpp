@@ -0,0 +1,618 @@
+#include "http/jobs_api.h"
+#include "http/lib.h"
+#include "http/quality_policy.h"
+#include "frames/files_iterator.h"
+
+#include <boost/beast/version.hpp>
+#include <boost/filesystem.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace http = boost::beast::http;
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+enum class job_state
+{
+    queued,
+    running,
+    done,
+    failed
+};
+
+const char* get_state_name(job_state state)
+{
+    switch (state)
+    {
+    case job_state::queued:
+        return "queued";
+    case job_state::running:
+        return "running";
+    case job_state::done:
+        return "done";
+    case job_state::failed:
+        return "failed";
+    }
+    return "";
+}
+
+struct job
+{
+    uint64_t m_id;
+    std::string m_source;
+    std::string m_directory;
+    std::string m_extention;
+    std::string m_model;
+    bool m_binary;
+    std::string m_results_path;
+
+    // Pins the model version for the whole job, even if it is reloaded meanwhile
+    std::shared_ptr<InferenceEngine> m_engine;
+
+    std::atomic<job_state> m_state{job_state::queued};
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_processed{0};
+    std::atomic<uint64_t> m_failed{0};
+    std::atomic<uint64_t> m_detections{0};
+
+    // Guarded by the jobs mutex
+    clock_type::time_point m_start;
+    clock_type::time_point m_end;
+    std::string m_error;
+};
+
+// Writes the frame records in the frames order, whatever order the workers finish them in
+class results_writer
+{
+public:
+    results_writer(const std::string& path, bool binary)
+        :m_file(path, binary ? std::ios::binary : std::ios::out)
+    {
+    }
+
+    bool is_open() const
+    {
+        return m_file.is_open();
+    }
+
+    void write(uint64_t index, std::string&& record)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.emplace(index, std::move(record));
+        for (auto next = m_pending.begin();
+            (next != m_pending.end()) && (next->first == m_next_index);
+            next = m_pending.erase(next), ++m_next_index)
+        {
+            m_file << next->second;
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    std::ofstream m_file;
+    std::map<uint64_t, std::string> m_pending;
+    uint64_t m_next_index = 0;
+};
+
+struct jobs_state
+{
+    // Also when the server exits without stopping the jobs, e.g. on an exception
+    ~jobs_state()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_queued.notify_all();
+        }
+
+        for (auto& runner : m_runners)
+        {
+            runner.join();
+        }
+        m_runners.clear();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    jobs_params m_params;
+    bool m_started = false;
+    std::atomic<bool> m_stopping{false};
+    uint64_t m_next_id = 1;
+    std::map<uint64_t, std::shared_ptr<job>> m_jobs;
+    std::deque<std::shared_ptr<job>> m_queue;
+    std::vector<std::thread> m_runners;
+};
+
+jobs_state& get_state()
+{
+    static jobs_state state;
+    return state;
+}
+
+std::string json_string(const std::string& value)
+{
+    std::string result = "\"";
+    for (auto c : value)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+std::string make_json_record(uint64_t index, const std::string& path, const cv::Mat& frame,
+    const std::vector<Detection>& detections)
+{
+    std::string record = "{\"frame\": " + std::to_string(index)
+        + ", \"file\": " + json_string(boost::filesystem::path(path).filename().string())
+        + ", \"width\": " + std::to_string(frame.cols)
+        + ", \"height\": " + std::to_string(frame.rows)
+        + ", \"detections\": [";
+    char buffer[128];
+    for (size_t i = 0; i < detections.size(); ++i)
+    {
+        const auto& detection = detections[i];
+        snprintf(buffer, sizeof(buffer), "%s{\"score\": %.4f, \"box\": [%.4f, %.4f, %.4f, %.4f]}",
+            i ? ", " : "", detection.mScore,
+            detection.mBox[0], detection.mBox[1], detection.mBox[2], detection.mBox[3]);
+        record += buffer;
+    }
+    return record + "]}\n";
+}
+
+std::string make_binary_record(uint64_t index, const std::vector<Detection>& detections)
+{
+    uint32_t count = detections.size();
+    std::string record(reinterpret_cast<const char*>(&index), sizeof(index));
+    record.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& detection : detections)
+    {
+        record.append(reinterpret_cast<const char*>(&detection.mScore), sizeof(detection.mScore));
+        record.append(reinterpret_cast<const char*>(detection.mBox.data()),
+            sizeof(float) * Detection::mNumCorners);
+    }
+    return record;
+}
+
+cv::Mat read_frame(const std::string& path)
+{
+    std::vector<uchar> buffer;
+    return read_file(path, buffer) ? cv::imdecode(buffer, cv::IMREAD_COLOR) : cv::Mat();
+}
+
+// Takes the next frames of the job, up to a batch of the context, until none is left,
+// so the faster workers take more frames
+void run_worker(
+    job& current,
+    const std::vector<std::string>& paths,
+    std::atomic<uint64_t>& next_index,
+    InferenceContext& context,
+    results_writer& writer)
+{
+    auto& state = get_state();
+    cv::Size input_size(context.get_input_width(), context.get_input_height());
+    auto batch_size = static_cast<uint64_t>(std::max(1, context.get_max_batch_size()));
+    std::vector<cv::Mat> frames;
+    std::vector<cv::Mat> batch;
+    std::vector<size_t> batch_frames;
+    std::vector<std::vector<Detection>> batch_detections;
+    std::vector<Detection> no_detections;
+    for (;;)
+    {
+        // The live streams come first, the level steps back up once they calm down or end,
+        // and stop_jobs wakes the paused workers
+        if (quality_policy::get_level() > 0)
+        {
+            std::unique_lock<std::mutex> lock(state.m_mutex);
+            while (!state.m_stopping && (quality_policy::get_level() > 0))
+            {
+                state.m_queued.wait_for(lock, std::chrono::milliseconds(50));
+            }
+        }
+
+        auto first = next_index.fetch_add(batch_size);
+        if (state.m_stopping || (first >= paths.size()))
+        {
+            return;
+        }
+        auto count = std::min<uint64_t>(batch_size, paths.size() - first);
+
+        frames.resize(count);
+        batch.resize(count);
+        batch_frames.clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            frames[i] = read_frame(paths[first + i]);
+            if (frames[i].empty())
+            {
+                continue;
+            }
+
+            // The slots may hold the frames of the previous batch, so they are not resized into them
+            auto& input_frame = batch[batch_frames.size()];
+            if (frames[i].size() == input_size)
+            {
+                input_frame = frames[i];
+            }
+            else
+            {
+                input_frame.release();
+                cv::resize(frames[i], input_frame, input_size);
+            }
+            batch_frames.push_back(i);
+        }
+        batch.resize(batch_frames.size());
+
+        batch_detections.clear();
+        auto inferred = !batch.empty() && context.infer_batch(batch, batch_detections)
+            && (batch_detections.size() == batch.size());
+        for (size_t i = 0, next = 0; i < count; ++i)
+        {
+            // A frame not inferred keeps its record, without detections
+            const auto* detections = &no_detections;
+            if ((next < batch_frames.size()) && (batch_frames[next] == i))
+            {
+                if (inferred)
+                {
+                    detections = &batch_detections[next];
+                }
+                ++next;
+            }
+            if (detections == &no_detections)
+            {
+                ++current.m_failed;
+            }
+
+            auto index = first + i;
+            current.m_detections += detections->size();
+            writer.write(index, current.m_binary
+                ? make_binary_record(index, *detections)
+                : make_json_record(index, paths[index], frames[i], *detections));
+            ++current.m_processed;
+        }
+    }
+}
+
+void run_job(job& current)
+{
+    auto& state = get_state();
+    std::vector<std::string> paths;
+    try
+    {
+        for (files_iterator files(current.m_directory, current.m_extention); !files.is_finished(); files.move_next())
+        {
+            paths.push_back(files.get_file_path());
+        }
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        current.m_error = e.what();
+        current.m_end = clock_type::now();
+        current.m_state = job_state::failed;
+        return;
+    }
+    current.m_frames = paths.size();
+
+    results_writer writer(current.m_results_path, current.m_binary);
+    if (!writer.is_open())
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        current.m_error = "Failed to create the results file.";
+        current.m_end = clock_type::now();
+        current.m_state = job_state::failed;
+        return;
+    }
+
+    auto workers_count = std::max(1, std::min<int>(state.m_params.m_workers, paths.size()));
+    std::vector<std::unique_ptr<InferenceContext>> contexts;
+    for (int i = 0; i < workers_count; ++i)
+    {
+        auto context = current.m_engine->get_inference_context();
+        if (!context)
+        {
+            break;
+        }
+        contexts.push_back(std::move(context));
+    }
+    if (contexts.empty())
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        current.m_error = "Failed to create an inference context.";
+        current.m_end = clock_type::now();
+        current.m_state = job_state::failed;
+        return;
+    }
+    workers_count = contexts.size();
+
+    std::atomic<uint64_t> next_index{0};
+    std::vector<std::thread> workers;
+    for (int i = 1; i < workers_count; ++i)
+    {
+        workers.emplace_back(run_worker, std::ref(current), std::cref(paths), std::ref(next_index),
+            std::ref(*contexts[i]), std::ref(writer));
+    }
+    run_worker(current, paths, next_index, *contexts[0], writer);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    // The contexts go back to the engine they were created by, for the next sessions
+    for (auto& context : contexts)
+    {
+        current.m_engine->add_prepared_context(std::move(context));
+    }
+
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    current.m_end = clock_type::now();
+    if (state.m_stopping)
+    {
+        current.m_error = "The server stopped.";
+        current.m_state = job_state::failed;
+    }
+    else
+    {
+        current.m_state = job_state::done;
+    }
+}
+
+// Called with the jobs mutex locked
+void forget_finished_jobs(jobs_state& state)
+{
+    auto is_finished = [](const std::pair<const uint64_t, std::shared_ptr<job>>& entry)
+    {
+        auto current = entry.second->m_state.load();
+        return (current == job_state::done) || (current == job_state::failed);
+    };
+
+    // The ids grow, so the map starts with the oldest jobs
+    auto finished = std::count_if(state.m_jobs.begin(), state.m_jobs.end(), is_finished);
+    for (auto entry = state.m_jobs.begin();
+        (entry != state.m_jobs.end()) && (finished > state.m_params.m_max_finished);)
+    {
+        if (is_finished(*entry))
+        {
+            entry = state.m_jobs.erase(entry);
+            --finished;
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+}
+
+void run_jobs()
+{
+    auto& state = get_state();
+    for (;;)
+    {
+        std::shared_ptr<job> next;
+        {
+            std::unique_lock<std::mutex> lock(state.m_mutex);
+            state.m_queued.wait(lock, [&state] { return state.m_stopping || !state.m_queue.empty(); });
+            if (state.m_stopping)
+            {
+                return;
+            }
+
+            next = state.m_queue.front();
+            state.m_queue.pop_front();
+            next->m_start = clock_type::now();
+            next->m_state = job_state::running;
+        }
+
+        log("Job " + std::to_string(next->m_id) + " started: " + next->m_source);
+        run_job(*next);
+        log("Job " + std::to_string(next->m_id) + " " + get_state_name(next->m_state) + ", "
+            + std::to_string(next->m_processed) + " frames.");
+
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        forget_finished_jobs(state);
+    }
+}
+
+// Called with the jobs mutex locked
+std::string get_job_json(const job& current)
+{
+    auto state = current.m_state.load();
+    auto end = (state == job_state::running) ? clock_type::now() : current.m_end;
+    auto seconds = (state == job_state::queued)
+        ? 0.0
+        : std::chrono::duration<double>(end - current.m_start).count();
+    auto processed = current.m_processed.load();
+    char fps[32];
+    snprintf(fps, sizeof(fps), "%.1f", seconds > 0 ? processed / seconds : 0.0);
+
+    auto json = "{\"id\": " + std::to_string(current.m_id)
+        + ", \"source\": " + json_string(current.m_source)
+        + ", \"model\": " + json_string(current.m_model)
+        + ", \"state\": \"" + get_state_name(state)
+        + "\", \"frames\": " + std::to_string(current.m_frames.load())
+        + ", \"processed\": " + std::to_string(processed)
+        + ", \"failed\": " + std::to_string(current.m_failed.load())
+        + ", \"detections\": " + std::to_string(current.m_detections.load())
+        + ", \"frames_per_second\": " + fps
+        + ", \"results\": " + json_string(current.m_results_path);
+    if (!current.m_error.empty())
+    {
+        json += ", \"error\": " + json_string(current.m_error);
+    }
+    return json + "}";
+}
+
+std::shared_ptr<http::response<http::string_body>> make_json_response(
+    http::status status,
+    unsigned version,
+    std::string&& body)
+{
+    auto res = std::make_shared<http::response<http::string_body>>(status, version);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "application/json");
+    res->set(http::field::cache_control, "no-cache");
+    res->body() = std::move(body);
+    res->prepare_payload();
+
+    return res;
+}
+
+std::shared_ptr<http::response<http::string_body>> make_error_response(
+    http::status status,
+    unsigned version,
+    const std::string& error)
+{
+    return make_json_response(status, version, "{\"error\": " + json_string(error) + "}");
+}
+
+std::shared_ptr<http::response<http::string_body>> submit_job(
+    ModelRegistry& registry,
+    const query& q,
+    unsigned version)
+{
+    auto& state = get_state();
+    if (q.m_path[1] != "filesystem")
+    {
+        return make_error_response(http::status::bad_request, version,
+            "Only filesystem sources can be processed offline.");
+    }
+
+    auto model = q.get_parameter("model");
+    auto engine = registry.get_engine(model);
+    if (!engine)
+    {
+        return make_error_response(http::status::bad_request, version, "Unknown model: " + model);
+    }
+
+    auto format = q.get_parameter("format", "jsonl");
+    if ((format != "jsonl") && (format != "binary"))
+    {
+        return make_error_response(http::status::bad_request, version, "Unknown results format: " + format);
+    }
+
+    auto current = std::make_shared<job>();
+    current->m_model = model.empty() ? "default" : model;
+    current->m_binary = format == "binary";
+    current->m_extention = "." + q.get_parameter("ext", "jpg");
+    current->m_engine = engine;
+
+    boost::filesystem::path directory(state.m_params.m_base_dir);
+    for (auto subdir = q.m_path.cbegin() + 1; subdir != q.m_path.cend(); ++subdir)
+    {
+        current->m_source += "/" + *subdir;
+        if (subdir != q.m_path.cbegin() + 1)
+        {
+            directory /= *subdir;
+        }
+    }
+    current->m_directory = directory.string();
+
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    if (state.m_queue.size() >= static_cast<size_t>(state.m_params.m_max_queued))
+    {
+        return make_error_response(http::status::too_many_requests, version, "Too many jobs queued.");
+    }
+
+    current->m_id = state.m_next_id++;
+    current->m_results_path = (boost::filesystem::path(state.m_params.m_results_dir)
+        / (std::to_string(current->m_id) + (current->m_binary ? ".bin" : ".jsonl"))).string();
+    state.m_jobs[current->m_id] = current;
+    state.m_queue.push_back(current);
+    state.m_queued.notify_one();
+    log("Job " + std::to_string(current->m_id) + " queued: " + current->m_source);
+
+    return make_json_response(http::status::accepted, version, get_job_json(*current));
+}
+
+} // anonymous namespace
+
+void start_jobs(const jobs_params& params)
+{
+    auto& state = get_state();
+    boost::filesystem::create_directories(params.m_results_dir);
+
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    state.m_params = params;
+    for (int i = 0; i < params.m_max_running; ++i)
+    {
+        state.m_runners.emplace_back(run_jobs);
+    }
+    state.m_started = true;
+}
+
+void stop_jobs()
+{
+    get_state().stop();
+}
+
+bool is_jobs_request(const query& q)
+{
+    return !q.m_path.empty() && (q.m_path[0] == "jobs");
+}
+
+std::shared_ptr<http::response<http::string_body>> make_jobs_response(
+    ModelRegistry& registry,
+    http::verb method,
+    const query& q,
+    unsigned version)
+{
+    auto& state = get_state();
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        if (!state.m_started || state.m_stopping)
+        {
+            return make_error_response(http::status::service_unavailable, version, "Jobs are not running.");
+        }
+    }
+
+    if ((q.m_path.size() >= 2) && (method == http::verb::post))
+    {
+        return submit_job(registry, q, version);
+    }
+
+    if ((q.m_path.size() == 1) && (method == http::verb::get))
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        std::string json = "{\"jobs\": [";
+        for (const auto& current : state.m_jobs)
+        {
+            json += (current.first != state.m_jobs.begin()->first ? ", " : "") + get_job_json(*current.second);
+        }
+        return make_json_response(http::status::ok, version, json + "]}");
+    }
+
+    if ((q.m_path.size() == 2) && (method == http::verb::get))
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        auto current = state.m_jobs.find(std::strtoull(q.m_path[1].c_str(), nullptr, 10));
+        if (current != state.m_jobs.end())
+        {
+            return make_json_response(http::status::ok, version, get_job_json(*current->second));
+        }
+    }
+
+    return make_error_response(http::status::not_found, version, "Not found.");
+}
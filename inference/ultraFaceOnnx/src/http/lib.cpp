@@ -1,21 +1,31 @@
 #include "http/lib.h"
 
-#include <iostream>
 #include <string>
 
+using inference::asyncLog::Severity;
+
 void fail(boost::system::error_code ec, char const* what)
 {
-    std::cerr << what << ": " << ec.message() << "\n";
+    if (inference::asyncLog::isEnabled(Severity::kERROR))
+    {
+        inference::asyncLog::write(Severity::kERROR, std::string(what) + ": " + ec.message());
+    }
 }
 
 void log(char const* message)
 {
-    std::cerr << message << std::endl;
+    if (inference::asyncLog::isEnabled(Severity::kINFO))
+    {
+        inference::asyncLog::write(Severity::kINFO, message, std::strlen(message));
+    }
 }
 
 void log(std::string message)
 {
-    std::cerr << message << std::endl;
+    if (inference::asyncLog::isEnabled(Severity::kINFO))
+    {
+        inference::asyncLog::write(Severity::kINFO, message);
+    }
 }
 
 std::time_t get_time()
@@ -24,4 +34,4 @@ std::time_t get_time()
 
     auto time_point = clock::now();
     return clock::to_time_t(time_point);
-}
\ No newline at end of file
+}
@@ -1,27 +1,35 @@
 #include "http/lib.h"
+#include "http/coro_session.h"
 #include "http/listener.h"
 #include "http/session.h"
-#include "inference/ultraFaceOnnx.h"
+#include "inference/modelRegistry.h"
 
 #include <boost/beast/http.hpp>
 #include <boost/asio/strand.hpp>
+#include <cerrno>
 #include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace net = boost::asio;
-using tcp = boost::asio::ip::tcp;
+using stream_protocol = boost::asio::generic::stream_protocol;
 
 listener::listener(
     boost::asio::io_context& ioc,
-    tcp::endpoint endpoint,
+    stream_protocol::endpoint endpoint,
     const std::string& base_dir,
-    UltraFaceOnnxEngine& inferenceEngine)
+    ModelRegistry& model_registry,
+    session_type type)
     :m_acceptor(ioc),
     m_socket(ioc),
     m_ioc(ioc),
     m_base_dir(base_dir),
-    m_inference_engine(inferenceEngine)
+    m_model_registry(model_registry),
+    m_session_type(type)
 {
     beast::error_code ec;
 
@@ -33,12 +41,25 @@ listener::listener(
         return;
     }
 
-    // Allow address reuse
-    m_acceptor.set_option(net::socket_base::reuse_address(true), ec);
-    if (ec)
+    if (endpoint.protocol().family() == AF_UNIX)
     {
-        fail(ec, "set_option");
-        return;
+        // A socket file left by a previous run would fail the bind
+        if (!remove_stale_socket(endpoint, ec))
+        {
+            fail(ec, "bind");
+            m_acceptor.close();
+            return;
+        }
+    }
+    else
+    {
+        // Allow address reuse
+        m_acceptor.set_option(net::socket_base::reuse_address(true), ec);
+        if (ec)
+        {
+            fail(ec, "set_option");
+            return;
+        }
     }
 
     // Bind to the server address
@@ -49,6 +70,17 @@ listener::listener(
         return;
     }
 
+    if (endpoint.protocol().family() == AF_UNIX)
+    {
+        m_socket_path = reinterpret_cast<const sockaddr_un*>(endpoint.data())->sun_path;
+        struct stat status;
+        if (lstat(m_socket_path.c_str(), &status) == 0)
+        {
+            m_socket_device = status.st_dev;
+            m_socket_inode = status.st_ino;
+        }
+    }
+
     // Start listening for connections
     m_acceptor.listen(net::socket_base::max_listen_connections, ec);
     if (ec)
@@ -58,6 +90,20 @@ listener::listener(
     }
 }
 
+listener::~listener()
+{
+    // Only the socket file this listener created, another server may have taken the path since
+    struct stat status;
+    if (!m_socket_path.empty()
+        && (lstat(m_socket_path.c_str(), &status) == 0)
+        && S_ISSOCK(status.st_mode)
+        && (status.st_dev == m_socket_device)
+        && (status.st_ino == m_socket_inode))
+    {
+        unlink(m_socket_path.c_str());
+    }
+}
+
 void listener::run()
 {
     if(!m_acceptor.is_open())
@@ -68,6 +114,40 @@ void listener::run()
     do_accept();
 }
 
+bool listener::remove_stale_socket(const stream_protocol::endpoint& endpoint, beast::error_code& ec)
+{
+    auto path = reinterpret_cast<const sockaddr_un*>(endpoint.data())->sun_path;
+    struct stat status;
+    if (lstat(path, &status) != 0)
+    {
+        return true;
+    }
+
+    // Never anything but a socket, e.g. a file the path was mistyped for
+    if (!S_ISSOCK(status.st_mode))
+    {
+        ec = beast::error_code(EEXIST, boost::system::system_category());
+        return false;
+    }
+
+    // A socket nobody listens on refuses the connection, any other answer means it is in use
+    stream_protocol::socket probe(m_ioc);
+    probe.connect(endpoint, ec);
+    if (ec != net::error::connection_refused)
+    {
+        ec = net::error::address_in_use;
+        return false;
+    }
+
+    ec = {};
+    if ((unlink(path) != 0) && (errno != ENOENT))
+    {
+        ec = beast::error_code(errno, boost::system::system_category());
+        return false;
+    }
+    return true;
+}
+
 void listener::do_accept()
 {
     log("Started to accept connections.");
@@ -89,11 +169,22 @@ void listener::on_accept(beast::error_code ec)
     else
     {
         // Create the session and run it
-        std::make_shared<session>(
-            m_ioc,
-            std::move(m_socket),
-            m_base_dir,
-            m_inference_engine.get_inference_context())->run();
+        if (m_session_type == session_type::coroutine)
+        {
+            std::make_shared<coro_session>(
+                m_ioc,
+                std::move(m_socket),
+                m_base_dir,
+                m_model_registry)->run();
+        }
+        else
+        {
+            std::make_shared<session>(
+                m_ioc,
+                std::move(m_socket),
+                m_base_dir,
+                m_model_registry)->run();
+        }
     }
 
     // Accept another connection
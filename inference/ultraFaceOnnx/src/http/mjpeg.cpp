@@ -0,0 +1,100 @@
+#include "http/mjpeg.h"
+
+#include <boost/beast/version.hpp>
+
+#include <cerrno>
+#include <sys/sendfile.h>
+
+namespace http = boost::beast::http;
+
+std::shared_ptr<http::response<http::empty_body>> make_mjpeg_header(
+    unsigned version,
+    const std::string& boundary)
+{
+    auto res = std::make_shared<http::response<http::empty_body>>(http::status::ok, version);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(
+        http::field::content_type,
+        "multipart/x-mixed-replace; boundary=" + boundary);
+    res->keep_alive();
+
+    return res;
+}
+
+std::shared_ptr<http::response<http::vector_body<unsigned char>>> make_mjpeg_frame(
+    std::vector<unsigned char>&& buffer,
+    unsigned version,
+    bool keep_alive,
+    const std::string& boundary)
+{
+    auto const size = buffer.size();
+    auto res = std::make_shared<http::response<http::vector_body<unsigned char>>>(
+        std::piecewise_construct,
+        std::make_tuple(std::move(buffer)),
+        std::make_tuple(http::status::ok, version));
+    res->set(http::field::body, "--" + boundary);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "image/jpeg");
+    res->content_length(size);
+    res->keep_alive(keep_alive);
+
+    return res;
+}
+
+std::shared_ptr<http::response<http::empty_body>> make_mjpeg_file_header(
+    size_t size,
+    unsigned version,
+    bool keep_alive,
+    const std::string& boundary)
+{
+    auto res = std::make_shared<http::response<http::empty_body>>(http::status::ok, version);
+    res->set(http::field::body, "--" + boundary);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "image/jpeg");
+    res->content_length(size);
+    res->keep_alive(keep_alive);
+
+    return res;
+}
+
+bool send_mjpeg_file(
+    boost::asio::generic::stream_protocol::socket& socket,
+    const cached_output& file,
+    size_t& offset,
+    boost::system::error_code& ec)
+{
+    socket.native_non_blocking(true, ec);
+    while (!ec && (offset < file.get_size()))
+    {
+        off_t file_offset = offset;
+        auto sent = sendfile(socket.native_handle(), file.get_fd(), &file_offset, file.get_size() - offset);
+        if (sent > 0)
+        {
+            offset = file_offset;
+        }
+        else if ((sent < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            return false;
+        }
+        else if (!((sent < 0) && (errno == EINTR)))
+        {
+            // A file truncated behind the cache ends the stream, its part cannot be completed
+            ec = (sent < 0)
+                ? boost::system::error_code(errno, boost::system::system_category())
+                : boost::system::error_code(EIO, boost::system::system_category());
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<http::response<http::empty_body>> make_mjpeg_termination(
+    unsigned version,
+    const std::string& boundary)
+{
+    auto res = std::make_shared<http::response<http::empty_body>>(http::status::ok, version);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::body, "--" + boundary + "--");
+
+    return res;
+}
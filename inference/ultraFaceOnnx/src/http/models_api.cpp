@@ -0,0 +1,97 @@
+#include "http/models_api.h"
+#include "http/lib.h"
+
+#include <boost/beast/version.hpp>
+
+#include <string>
+
+namespace http = boost::beast::http;
+
+namespace
+{
+
+std::shared_ptr<http::response<http::string_body>> make_json_response(
+    http::status status,
+    unsigned version,
+    std::string&& body)
+{
+    auto res = std::make_shared<http::response<http::string_body>>(status, version);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "application/json");
+    res->set(http::field::cache_control, "no-cache");
+    res->body() = std::move(body);
+    res->prepare_payload();
+
+    return res;
+}
+
+std::string get_models_json(ModelRegistry& registry)
+{
+    std::string json = "{\"models\": [";
+    auto models = registry.get_models();
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        const auto& model = models[i];
+        json += std::string(i ? ", " : "")
+            + "{\"name\": \"" + model.mName
+            + "\", \"onnx_file\": \"" + model.mOnnxFileName
+            + "\", \"version\": " + std::to_string(model.mVersion)
+            + ", \"reloading\": " + (model.mReloading ? "true" : "false")
+            + ", \"default\": " + (model.mDefault ? "true" : "false") + "}";
+    }
+    json += "]";
+
+    auto cache = registry.get_detection_cache();
+    if (cache)
+    {
+        auto stats = cache->get_stats();
+        auto hits = stats.mMemoryHits + stats.mDiskHits;
+        auto lookups = hits + stats.mMisses;
+        json += ", \"detection_cache\": {\"memory_hits\": " + std::to_string(stats.mMemoryHits)
+            + ", \"disk_hits\": " + std::to_string(stats.mDiskHits)
+            + ", \"misses\": " + std::to_string(stats.mMisses)
+            + ", \"hit_rate\": " + std::to_string(lookups ? static_cast<double>(hits) / lookups : 0.0)
+            + ", \"memory_entries\": " + std::to_string(stats.mMemoryEntries)
+            + ", \"disk_entries\": " + std::to_string(stats.mDiskEntries)
+            + ", \"disk_bytes\": " + std::to_string(stats.mDiskBytes) + "}";
+    }
+    return json + "}";
+}
+
+} // anonymous namespace
+
+bool is_models_request(const query& q)
+{
+    return !q.m_path.empty() && (q.m_path[0] == "models");
+}
+
+std::shared_ptr<http::response<http::string_body>> make_models_response(
+    ModelRegistry& registry,
+    http::verb method,
+    const query& q,
+    unsigned version)
+{
+    if ((q.m_path.size() == 1) && (method == http::verb::get))
+    {
+        return make_json_response(http::status::ok, version, get_models_json(registry));
+    }
+
+    if ((q.m_path.size() == 3) && (q.m_path[2] == "reload") && (method == http::verb::post))
+    {
+        const auto& name = q.m_path[1];
+        switch (registry.reload(name))
+        {
+        case ReloadResult::kSTARTED:
+            log("Reloading the model " + name);
+            return make_json_response(http::status::accepted, version,
+                "{\"model\": \"" + name + "\", \"reloading\": true}");
+        case ReloadResult::kBUSY:
+            return make_json_response(http::status::conflict, version,
+                "{\"error\": \"The model is already reloading.\"}");
+        case ReloadResult::kUNKNOWN_MODEL:
+            break;
+        }
+    }
+
+    return make_json_response(http::status::not_found, version, "{\"error\": \"Not found.\"}");
+}
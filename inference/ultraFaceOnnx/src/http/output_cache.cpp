@@ -0,0 +1,205 @@
+#include "http/output_cache.h"
+#include "http/lib.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace
+{
+
+struct cache_entry
+{
+    size_t m_size;
+    std::list<uint64_t>::iterator m_use;
+};
+
+struct cache_state
+{
+    std::mutex m_mutex;
+    output_cache_params m_params;
+    bool m_enabled = false;
+    std::list<uint64_t> m_recently_used;    // most recently used first
+    std::unordered_map<uint64_t, cache_entry> m_entries;
+    size_t m_bytes = 0;
+    uint64_t m_temporary_index = 0;
+};
+
+cache_state& get_state()
+{
+    static cache_state state;
+    return state;
+}
+
+std::string get_file_name(uint64_t key)
+{
+    char name[21];
+    snprintf(name, sizeof(name), "%016llx.jpg", static_cast<unsigned long long>(key));
+    return name;
+}
+
+std::string get_path(const cache_state& state, uint64_t key)
+{
+    return (boost::filesystem::path(state.m_params.m_directory) / get_file_name(key)).string();
+}
+
+// Takes the new entry, or uses the existing one, and removes the least recently used files beyond the bound.
+// Called with the mutex locked.
+void add_entry(cache_state& state, uint64_t key, size_t size)
+{
+    auto existing = state.m_entries.find(key);
+    if (existing != state.m_entries.end())
+    {
+        state.m_bytes -= existing->second.m_size;
+        state.m_recently_used.erase(existing->second.m_use);
+        state.m_entries.erase(existing);
+    }
+
+    state.m_recently_used.push_front(key);
+    state.m_entries[key] = cache_entry{size, state.m_recently_used.begin()};
+    state.m_bytes += size;
+
+    while ((state.m_bytes > state.m_params.m_max_bytes) && (state.m_recently_used.size() > 1))
+    {
+        auto evicted = state.m_recently_used.back();
+        state.m_recently_used.pop_back();
+        state.m_bytes -= state.m_entries[evicted].m_size;
+        state.m_entries.erase(evicted);
+        std::remove(get_path(state, evicted).c_str());
+    }
+}
+
+} // anonymous namespace
+
+cached_output::~cached_output()
+{
+    close(m_fd);
+}
+
+void output_cache::configure(const output_cache_params& params)
+{
+    if (params.m_directory.empty())
+    {
+        return;
+    }
+
+    auto& state = get_state();
+    const std::lock_guard<std::mutex> lock(state.m_mutex);
+    state.m_params = params;
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(params.m_directory, ec);
+
+    // The frames of a previous run, the oldest ones are used first
+    std::vector<std::tuple<std::time_t, uint64_t, boost::filesystem::path>> files;
+    for (boost::filesystem::directory_iterator it(params.m_directory, ec), end; !ec && (it != end); it.increment(ec))
+    {
+        const auto& path = it->path();
+        auto stem = path.stem().string();
+        char* stem_end = nullptr;
+        auto key = std::strtoull(stem.c_str(), &stem_end, 16);
+        if ((path.extension() == ".jpg") && (stem.size() == 16) && (*stem_end == 0))
+        {
+            boost::system::error_code time_ec;
+            files.emplace_back(boost::filesystem::last_write_time(path, time_ec), key, path);
+        }
+        else if (path.extension() == ".tmp")
+        {
+            // Left by an interrupted store
+            boost::filesystem::remove(path, ec);
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files)
+    {
+        boost::system::error_code size_ec;
+        auto size = boost::filesystem::file_size(std::get<2>(file), size_ec);
+        if (!size_ec)
+        {
+            add_entry(state, std::get<1>(file), size);
+        }
+    }
+
+    state.m_enabled = true;
+    log("Output cache of " + std::to_string(state.m_entries.size()) + " frames, "
+        + std::to_string(state.m_bytes >> 20) + " MB in " + params.m_directory);
+}
+
+bool output_cache::is_enabled()
+{
+    auto& state = get_state();
+    const std::lock_guard<std::mutex> lock(state.m_mutex);
+    return state.m_enabled;
+}
+
+std::shared_ptr<const cached_output> output_cache::lookup(uint64_t key)
+{
+    auto& state = get_state();
+    const std::lock_guard<std::mutex> lock(state.m_mutex);
+    auto entry = state.m_entries.find(key);
+    if (entry == state.m_entries.end())
+    {
+        return nullptr;
+    }
+
+    int fd = open(get_path(state, key).c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        // Removed behind the cache
+        state.m_bytes -= entry->second.m_size;
+        state.m_recently_used.erase(entry->second.m_use);
+        state.m_entries.erase(entry);
+        return nullptr;
+    }
+
+    state.m_recently_used.splice(state.m_recently_used.begin(), state.m_recently_used, entry->second.m_use);
+    return std::make_shared<cached_output>(fd, entry->second.m_size);
+}
+
+void output_cache::store(uint64_t key, const std::vector<unsigned char>& buffer)
+{
+    auto& state = get_state();
+    std::string path;
+    std::string temporary_path;
+    {
+        const std::lock_guard<std::mutex> lock(state.m_mutex);
+        if (!state.m_enabled || (state.m_entries.find(key) != state.m_entries.end()))
+        {
+            return;
+        }
+        path = get_path(state, key);
+        temporary_path = path + "." + std::to_string(state.m_temporary_index++) + ".tmp";
+    }
+
+    // Written outside the lock, the other sessions keep looking up
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        if (!file)
+        {
+            file.close();
+            std::remove(temporary_path.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        return;
+    }
+
+    const std::lock_guard<std::mutex> lock(state.m_mutex);
+    add_entry(state, key, buffer.size());
+}
@@ -0,0 +1,146 @@
+#include "http/quality_policy.h"
+#include "http/lib.h"
+
+#include <mutex>
+
+std::atomic<bool> quality_policy::s_enabled{false};
+std::atomic<size_t> quality_policy::s_level{0};
+std::atomic<int> quality_policy::s_in_flight{0};
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+// Weight of the newest frame in the moving average
+const double g_average_weight = 0.05;
+
+struct policy_state
+{
+    std::mutex m_mutex;
+    quality_params m_params;
+    double m_average_ms = 0.0;
+    clock_type::time_point m_overloaded_since;
+    clock_type::time_point m_calm_since;
+    clock_type::time_point m_last_change;   // the last frame reported or level stepped
+    bool m_overloaded = false;
+    bool m_calm = false;
+};
+
+policy_state& get_state()
+{
+    static policy_state state;
+    return state;
+}
+
+} // anonymous namespace
+
+void quality_policy::configure(const quality_params& params)
+{
+    auto& state = get_state();
+    {
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        state.m_params = params;
+        state.m_average_ms = 0.0;
+        state.m_overloaded = false;
+        state.m_calm = false;
+        state.m_last_change = clock_type::now();
+    }
+    s_level = 0;
+    s_enabled = !params.m_levels.empty();
+}
+
+size_t quality_policy::get_levels_count()
+{
+    return get_state().m_params.m_levels.size();
+}
+
+const quality_level& quality_policy::get_level_settings(size_t level)
+{
+    return get_state().m_params.m_levels.at(level);
+}
+
+void quality_policy::report_frame(std::chrono::nanoseconds processing_time)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    auto& state = get_state();
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    const auto& params = state.m_params;
+    auto now = clock_type::now();
+    state.m_last_change = now;
+    auto sample_ms = std::chrono::duration<double, std::milli>(processing_time).count();
+    state.m_average_ms = state.m_average_ms > 0.0
+        ? state.m_average_ms + g_average_weight * (sample_ms - state.m_average_ms)
+        : sample_ms;
+    auto in_flight = s_in_flight.load(std::memory_order_relaxed);
+
+    auto overloaded = (state.m_average_ms > params.m_latency_slo_ms) || (in_flight > params.m_max_in_flight);
+    auto calm = (state.m_average_ms < params.m_latency_slo_ms * params.m_recover_ratio)
+        && (in_flight <= params.m_max_in_flight / 2);
+
+    if (!overloaded)
+    {
+        state.m_overloaded = false;
+    }
+    else if (!state.m_overloaded)
+    {
+        state.m_overloaded = true;
+        state.m_overloaded_since = now;
+    }
+
+    if (!calm)
+    {
+        state.m_calm = false;
+    }
+    else if (!state.m_calm)
+    {
+        state.m_calm = true;
+        state.m_calm_since = now;
+    }
+
+    auto level = s_level.load(std::memory_order_relaxed);
+    if (state.m_overloaded && (now - state.m_overloaded_since >= params.m_degrade_after)
+        && (level + 1 < params.m_levels.size()))
+    {
+        // The load of the new level is measured from scratch
+        s_level = ++level;
+        state.m_overloaded_since = now;
+        log("Overloaded, " + std::to_string(state.m_average_ms) + " ms per frame, quality level "
+            + std::to_string(level));
+    }
+    else if (state.m_calm && (now - state.m_calm_since >= params.m_recover_after) && (level > 0))
+    {
+        s_level = --level;
+        state.m_calm_since = now;
+        log("Load recovered, " + std::to_string(state.m_average_ms) + " ms per frame, quality level "
+            + std::to_string(level));
+    }
+}
+
+size_t quality_policy::recover_idle(size_t level)
+{
+    auto& state = get_state();
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    const auto& params = state.m_params;
+    auto now = clock_type::now();
+    level = s_level.load(std::memory_order_relaxed);
+    if ((level == 0) || (now - state.m_last_change < params.m_recover_after)
+        || (s_in_flight.load(std::memory_order_relaxed) > params.m_max_in_flight / 2))
+    {
+        return level;
+    }
+
+    // No stream measures the load anymore, the next ones start from scratch
+    s_level = --level;
+    state.m_last_change = now;
+    state.m_average_ms = 0.0;
+    state.m_overloaded = false;
+    state.m_calm = false;
+    log("No frames for " + std::to_string(params.m_recover_after.count()) + " ms, quality level "
+        + std::to_string(level));
+    return level;
+}
@@ -51,8 +51,21 @@ query::query(const std::string& query_string)
         auto sep_pos = query_string.find(key_value_delimeter, start);
         m_parameters.emplace_back(
             query_string.substr(start, sep_pos - start),
-            query_string.substr(sep_pos + 1, end - sep_pos));
+            query_string.substr(sep_pos + 1, end - sep_pos - 1));
 
         start = end + 1;
     }
+}
+
+std::string query::get_parameter(const std::string& name, const std::string& default_value) const
+{
+    for (const auto& pair: m_parameters)
+    {
+        if (pair.first == name)
+        {
+            return pair.second;
+        }
+    }
+
+    return default_value;
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "http/readiness.h"
+
+#include <boost/beast/version.hpp>
+
+#include <atomic>
+#include <string>
+
+namespace http = boost::beast::http;
+
+namespace
+{
+
+std::atomic<long> g_warm_up_ms{0};
+std::atomic<int> g_prepared_contexts{0};
+
+} // anonymous namespace
+
+void set_ready(std::chrono::milliseconds warm_up_duration, int prepared_contexts)
+{
+    g_warm_up_ms = warm_up_duration.count();
+    g_prepared_contexts = prepared_contexts;
+}
+
+bool is_ready_request(const query& q)
+{
+    return (q.m_path.size() == 1) && (q.m_path[0] == "ready");
+}
+
+std::shared_ptr<http::response<http::string_body>> make_ready_response(
+    unsigned version)
+{
+    auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, version);
+    res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res->set(http::field::content_type, "application/json");
+    res->set(http::field::cache_control, "no-cache");
+    res->body() = std::string("{\"ready\": true")
+        + ", \"warm_up_ms\": " + std::to_string(g_warm_up_ms.load())
+        + ", \"prepared_contexts\": " + std::to_string(g_prepared_contexts.load()) + "}";
+    res->prepare_payload();
+
+    return res;
+}
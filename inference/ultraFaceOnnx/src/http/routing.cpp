@@ -1,6 +1,8 @@
 #include "http/routing.h"
+#include "http/lib.h"
 
 #include <boost/filesystem.hpp>
+#include <system_error>
 
 routing::routing(std::map<std::string, std::string> params)
     :m_params(params)
@@ -13,19 +15,29 @@ routing::routing(std::map<std::string, std::string> params)
             path /= *subdir;
         }
 
-        std::string extention = ".jpg";
-        for(const auto& pair: q.m_parameters)
-        {
-            if (pair.first == "ext")
-            {
-                extention = "." + pair.second;
-                break;
-            }
-        }
+        std::string extention = "." + q.get_parameter("ext", "jpg");
 
         return std::unique_ptr<frame_reader>(
             new filesystem_frame_reader(path.string(), extention));
     };
+
+    m_routes["shm"] = [](const query& q)
+    {
+        if (q.m_path.size() < 2)
+        {
+            return std::unique_ptr<frame_reader>(nullptr);
+        }
+
+        try
+        {
+            return std::unique_ptr<frame_reader>(new shm_frame_reader(q.m_path[1]));
+        }
+        catch (const std::system_error& e)
+        {
+            log(std::string("Failed to open shared memory frames: ") + e.what());
+            return std::unique_ptr<frame_reader>(nullptr);
+        }
+    };
 }
 
 std::unique_ptr<frame_reader> routing::create_reader(const std::string& type, const query& q)
@@ -1,19 +1,24 @@
+#include "logger.h"
 #include "http/session.h"
+#include "http/debug_trace.h"
 #include "http/lib.h"
+#include "http/mjpeg.h"
+#include "http/jobs_api.h"
+#include "http/models_api.h"
 #include "http/query.h"
+#include "http/readiness.h"
 
 #include <functional> 
 #include <boost/asio.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/beast/http/write.hpp>
 #include <boost/regex.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <sstream>
 
 
 namespace beast = boost::beast;
 namespace http = beast::http;
-using tcp = boost::asio::ip::tcp;
+using stream_protocol = boost::asio::generic::stream_protocol;
 
 void session::run()
 {
@@ -67,24 +72,41 @@ void session::on_read(
         return;
     }
 
-    m_frame_reader = m_routing.create_reader(q.m_path[0], q);
-    if (!m_frame_reader)
+    if (is_debug_trace_request(q))
+    {
+        do_trace(q);
+        return;
+    }
+
+    if (is_ready_request(q))
+    {
+        m_string_res = make_ready_response(m_req.version());
+        write_string_response();
+        return;
+    }
+
+    if (is_models_request(q))
+    {
+        m_string_res = make_models_response(m_model_registry, m_req.method(), q, m_req.version());
+        write_string_response();
+        return;
+    }
+
+    if (is_jobs_request(q))
+    {
+        m_string_res = make_jobs_response(m_model_registry, m_req.method(), q, m_req.version());
+        write_string_response();
+        return;
+    }
+
+    if (!m_frame_processor.open(q))
     {
-        log(std::string("Unknown frames source: ") + q.m_path[0]);
         return;
     }
 
     inference::gLogInfo << "Start streaming the GPU inference results." << std::endl;
 
-    // The lifetime of the response has to extend
-    // for the duration of the async operation so
-    // we use a shared_ptr to manage it.
-    m_header_res = std::make_shared<http::response<http::empty_body>>(http::status::ok, m_req.version());
-    m_header_res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
-    m_header_res->set(
-        http::field::content_type,
-        "multipart/x-mixed-replace; boundary=" + m_frame_boundary);
-    m_header_res->keep_alive();
+    m_header_res = make_mjpeg_header(m_req.version(), m_frame_boundary);
 
     log("Writing M-JPEG header.");
     http::async_write(
@@ -105,21 +127,23 @@ void session::on_write(
 {    
     boost::ignore_unused(bytes_transferred);
 
+    m_frame_processor.trace_write_end();
+
     if(ec)
     {
         return fail(ec, "write");
     }
 
-    if (m_frame_reader->is_finished() && m_frame_buffers.empty())
+    if (m_frame_processor.is_finished())
     {
         log("Closing");
         do_close();
         return;
     }
 
-    if (!m_frame_buffers.empty())
+    if (m_frame_processor.has_frames())
     {
-        m_timer.expires_after(m_frame_pause);
+        m_timer.expires_after(m_frame_processor.get_frame_pause());
         m_timer.async_wait(
             boost::asio::bind_executor(
                 m_strand,
@@ -131,25 +155,7 @@ void session::on_write(
         return;
     }
 
-    auto pause = m_frame_pause;
-    log("Start processing frames.");
-    do
-    {
-        auto processing_start = std::chrono::high_resolution_clock::now();
-        process_frame();
-        auto processing_end = std::chrono::high_resolution_clock::now();
-        auto processing_time = processing_end - processing_start;
-        m_statistics.update_avg_processing(processing_time.count());
-        pause -= processing_time;
-    } while (!m_frame_reader->is_finished()
-        && (pause.count() > m_statistics.get_avg_processing_time()));
-
-    if (m_frame_reader->is_finished())
-    {
-        // Denotes end of images list
-        log("Image list finished.");
-        m_frame_buffers.push(std::vector<uchar>());
-    }
+    auto pause = m_frame_processor.process_frames(m_frame_processor.get_frame_pause());
 
     m_timer.expires_after(pause);
     m_timer.async_wait(
@@ -163,18 +169,47 @@ void session::on_write(
 
 void session::on_timer(const boost::system::error_code& error)
 {
-    auto buffer = std::move(m_frame_buffers.front());
-    m_frame_buffers.pop();
-    auto const size = buffer.size();
+    if (!m_frame_processor.has_frames())
+    {
+        // The source had no frame yet, it is polled again instead of waited on
+        m_timer.expires_after(m_frame_processor.process_frames(m_frame_processor.get_frame_pause()));
+        m_timer.async_wait(
+            boost::asio::bind_executor(
+                m_strand,
+                std::bind(
+                    &session::on_timer,
+                    shared_from_this(),
+                    std::placeholders::_1)));
+        return;
+    }
+
+    auto frame = m_frame_processor.pop_frame();
 
-    if (size == 0)
+    if (frame.m_file)
+    {
+        log_verbose("Writing cached response.");
+        m_file = std::move(frame.m_file);
+        m_file_offset = 0;
+        m_header_res = make_mjpeg_file_header(
+            m_file->get_size(), m_req.version(), m_req.keep_alive(), m_frame_boundary);
+        m_frame_processor.trace_write_start(frame.m_trace_id);
+
+        http::async_write(
+            m_socket,
+            *m_header_res,
+            boost::asio::bind_executor(
+                m_strand,
+                std::bind(
+                    &session::on_file_writable,
+                    shared_from_this(),
+                    std::placeholders::_1)));
+    }
+    else if (frame.m_buffer.empty())
     {
         // Writing termination boundary
         log("Writing termination boundary.");
 
-        m_header_res = std::make_shared<http::response<http::empty_body>>(http::status::ok, m_req.version());
-        m_header_res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
-        m_header_res->set(http::field::body, "--" + m_frame_boundary + "--");
+        m_header_res = make_mjpeg_termination(m_req.version(), m_frame_boundary);
 
         http::async_write(
             m_socket,
@@ -189,16 +224,9 @@ void session::on_timer(const boost::system::error_code& error)
     }
     else
     {
-        log("Writing response.");
-        m_res = std::make_shared<http::response<http::vector_body<unsigned char>>>(
-        std::piecewise_construct,
-        std::make_tuple(std::move(buffer)),
-        std::make_tuple(http::status::ok, m_req.version()));
-        m_res->set(http::field::body, "--" + m_frame_boundary);
-        m_res->set(http::field::server, BOOST_BEAST_VERSION_STRING);
-        m_res->set(http::field::content_type, "image/jpeg");
-        m_res->content_length(size);
-        m_res->keep_alive(m_req.keep_alive());
+        log_verbose("Writing response.");
+        m_res = make_mjpeg_frame(std::move(frame.m_buffer), m_req.version(), m_req.keep_alive(), m_frame_boundary);
+        m_frame_processor.trace_write_start(frame.m_trace_id);
 
             // Write the response
         http::async_write(
@@ -214,70 +242,86 @@ void session::on_timer(const boost::system::error_code& error)
     }
 }
 
-void session::do_close()
+void session::on_file_writable(boost::system::error_code ec)
 {
-    // Send a TCP shutdown
-    boost::system::error_code ec;
-    m_socket.shutdown(tcp::socket::shutdown_send, ec);
-    m_socket.close();
+    if (!ec && !send_mjpeg_file(m_socket, *m_file, m_file_offset, ec))
+    {
+        m_socket.async_wait(
+            stream_protocol::socket::wait_write,
+            boost::asio::bind_executor(
+                m_strand,
+                std::bind(
+                    &session::on_file_writable,
+                    shared_from_this(),
+                    std::placeholders::_1)));
+        return;
+    }
 
-    // At this point the connection is closed gracefully
+    m_file.reset();
+    on_write(ec, m_file_offset);
+}
+
+void session::do_trace(const query& q)
+{
+    if (!tracer::start_capture())
+    {
+        m_string_res = make_trace_busy_response(m_req.version());
+        write_string_response();
+        return;
+    }
+
+    log("Capturing a trace.");
+    m_timer.expires_after(get_trace_duration(q));
+    m_timer.async_wait(
+        boost::asio::bind_executor(
+            m_strand,
+            std::bind(
+                &session::on_trace_timer,
+                shared_from_this(),
+                std::placeholders::_1)));
+}
+
+void session::on_trace_timer(const boost::system::error_code& error)
+{
+    // The capture has to end even if the wait failed
+    m_string_res = make_trace_response(m_req.version(), tracer::stop_capture());
+    write_string_response();
+}
+
+void session::write_string_response()
+{
+    http::async_write(
+        m_socket,
+        *m_string_res,
+        boost::asio::bind_executor(
+            m_strand,
+            std::bind(
+                &session::on_string_write,
+                shared_from_this(),
+                std::placeholders::_1,
+                std::placeholders::_2)));
 }
 
-void session::process_frame()
+void session::on_string_write(
+    boost::system::error_code ec,
+    std::size_t bytes_transferred)
 {
-    cv::Mat frame;
-    cv::Mat input_frame;
-    std::vector<cv::Mat> batch;
-    std::vector<Detection> detections;
+    boost::ignore_unused(bytes_transferred);
 
-    bool finished = false;
-    do
+    if(ec)
     {
-        log("Reading next frame");
-        frame = m_frame_reader->read_frame();
-        if (frame.empty())
-        {
-            log("Frame is empty. Skipped.");
-            continue;
-        }
-        
-        cv::resize(
-            frame,
-            input_frame,
-            cv::Size(
-                m_inference_context->get_input_width(),
-                m_inference_context->get_input_height()));
-        batch.clear();
-        batch.push_back(std::move(input_frame));
-
-        inference::gLogInfo << "Running inference!" << std::endl;
-        if (!m_inference_context->infer(batch, detections))
-        {
-            inference::gLogInfo << "Error during inference!" << std::endl;
-            continue;
-        }
-        inference::gLogInfo << "Inference successfull." << std::endl;
-
-        inference::gLogInfo << "Drawing detections." << std::endl;
-        int width = frame.cols;
-        int height = frame.rows;
-        for (const auto& detection: detections)
-        {
-            cv::rectangle(
-                frame,
-                cv::Point(detection.mBox[0] * width, detection.mBox[1] * height),
-                cv::Point(detection.mBox[2] * width, detection.mBox[3] * height),
-                cv::Scalar(0, 0, 255));
-        }
-
-        std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 95};
-        std::vector<uchar> buffer;
-        cv::imencode(".jpg", frame, buffer, std::vector<int> {cv::IMWRITE_JPEG_QUALITY, 95});
-        m_frame_buffers.push(std::move(buffer));
-        inference::gLogInfo << "Frame ready." << std::endl;
+        return fail(ec, "write");
     }
-    while(frame.empty() && !m_frame_reader->is_finished());
-    
-    log("Finished processing frame.");
-}
\ No newline at end of file
+
+    do_close();
+}
+
+void session::do_close()
+{
+    // Send a shutdown
+    boost::system::error_code ec;
+    m_socket.shutdown(stream_protocol::socket::shutdown_send, ec);
+    m_socket.close();
+
+    // At this point the connection is closed gracefully
+}
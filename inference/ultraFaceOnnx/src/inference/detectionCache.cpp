@@ -0,0 +1,262 @@
+#include "logger.h"
+#include "inference/detectionCache.h"
+#include "inference/planCache.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char kMagic[8] = {'U', 'F', 'D', 'C', 'A', 'C', '0', '2'};
+
+struct LogHeader
+{
+    char mMagic[8];
+    uint64_t mSize;             //!< Bytes of the complete records and this header
+};
+
+//!
+//! \brief A record of the log, followed by mCount scores and boxes, padded to 8 bytes
+//!
+struct RecordHeader
+{
+    uint64_t mKey;
+    uint32_t mCount;
+    uint32_t mChecksum;         //!< Of the key, the count and the detections, a torn record is dropped on open
+};
+
+const size_t kDetectionSize = sizeof(float) * (1 + Detection::mNumCorners);
+
+size_t getRecordSize(size_t count)
+{
+    return (sizeof(RecordHeader) + count * kDetectionSize + 7) / 8 * 8;
+}
+
+uint32_t getChecksum(uint64_t key, uint32_t count, const unsigned char* data)
+{
+    std::string bytes(reinterpret_cast<const char*>(&key), sizeof(key));
+    bytes.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    bytes.append(reinterpret_cast<const char*>(data), count * kDetectionSize);
+    return static_cast<uint32_t>(hashString(bytes));
+}
+
+} // anonymous namespace
+
+DetectionCache::DetectionCache(const DetectionCacheParams& params)
+    : mParams(params)
+{
+    if (!mParams.mDirectory.empty())
+    {
+        openLog();
+    }
+}
+
+DetectionCache::~DetectionCache()
+{
+    if (mLog)
+    {
+        munmap(mLog, mParams.mMaxLogSize);
+    }
+    if (mFd >= 0)
+    {
+        close(mFd);
+    }
+}
+
+bool DetectionCache::lookup(uint64_t key, std::vector<Detection>& detections)
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    auto cached = mMemoryIndex.find(key);
+    if (cached != mMemoryIndex.end())
+    {
+        mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed, cached->second);
+        detections = cached->second->second;
+        ++mMemoryHits;
+        return true;
+    }
+
+    auto logged = mDiskIndex.find(key);
+    if (logged != mDiskIndex.end())
+    {
+        readRecord(logged->second, detections);
+        remember(key, detections);
+        ++mDiskHits;
+        return true;
+    }
+
+    ++mMisses;
+    return false;
+}
+
+void DetectionCache::store(uint64_t key, const std::vector<Detection>& detections)
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    remember(key, detections);
+    if (mLog && (mDiskIndex.find(key) == mDiskIndex.end()))
+    {
+        appendRecord(key, detections);
+    }
+}
+
+DetectionCacheStats DetectionCache::get_stats()
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return DetectionCacheStats{mMemoryHits, mDiskHits, mMisses, mMemoryIndex.size(), mDiskIndex.size(),
+        mLog ? reinterpret_cast<const LogHeader*>(mLog)->mSize : 0};
+}
+
+void DetectionCache::openLog()
+{
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(mParams.mDirectory, ec);
+    auto path = (boost::filesystem::path(mParams.mDirectory) / "detections.log").string();
+
+    // Without the log the cache keeps its in-memory tier only
+    auto fail = [this, &path](const char* message)
+    {
+        inference::gLogWarning << message << path << std::endl;
+        if (mFd >= 0)
+        {
+            close(mFd);
+            mFd = -1;
+        }
+    };
+
+    mFd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat status;
+    if ((mFd < 0) || (fstat(mFd, &status) != 0))
+    {
+        fail("Cannot open the detection cache log: ");
+        return;
+    }
+
+    // The records of two processes would overwrite each other
+    if (flock(mFd, LOCK_EX | LOCK_NB) != 0)
+    {
+        fail("The detection cache log is used by another process: ");
+        return;
+    }
+
+    // A log of another size is not reused. The blocks are reserved up front,
+    // a write to a hole of the mapping on a full disk would raise SIGBUS.
+    auto size = static_cast<size_t>(status.st_size);
+    if (((size != mParams.mMaxLogSize) && (ftruncate(mFd, 0) != 0))
+        || (posix_fallocate(mFd, 0, mParams.mMaxLogSize) != 0))
+    {
+        fail("Cannot reserve the detection cache log: ");
+        return;
+    }
+
+    void* mapping = mmap(nullptr, mParams.mMaxLogSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        fail("Cannot map the detection cache log: ");
+        return;
+    }
+    mLog = static_cast<unsigned char*>(mapping);
+
+    auto header = reinterpret_cast<LogHeader*>(mLog);
+    if ((std::memcmp(header->mMagic, kMagic, sizeof(kMagic)) != 0)
+        || (header->mSize < sizeof(LogHeader)) || (header->mSize > mParams.mMaxLogSize))
+    {
+        std::memcpy(header->mMagic, kMagic, sizeof(kMagic));
+        header->mSize = sizeof(LogHeader);
+    }
+
+    // The index is rebuilt from the records, the log ends at the first incomplete one
+    size_t offset = sizeof(LogHeader);
+    while (offset + sizeof(RecordHeader) <= header->mSize)
+    {
+        auto record = reinterpret_cast<const RecordHeader*>(mLog + offset);
+        auto recordSize = getRecordSize(record->mCount);
+        if ((offset + recordSize > header->mSize)
+            || (getChecksum(record->mKey, record->mCount, mLog + offset + sizeof(RecordHeader))
+                != record->mChecksum))
+        {
+            break;
+        }
+        mDiskIndex[record->mKey] = offset;
+        offset += recordSize;
+    }
+    header->mSize = offset;
+
+    inference::gLogInfo << "Indexed " << mDiskIndex.size() << " cached frames in " << path << std::endl;
+}
+
+void DetectionCache::readRecord(size_t offset, std::vector<Detection>& detections) const
+{
+    auto record = reinterpret_cast<const RecordHeader*>(mLog + offset);
+    auto values = reinterpret_cast<const float*>(mLog + offset + sizeof(RecordHeader));
+    detections.clear();
+    detections.reserve(record->mCount);
+    for (uint32_t i = 0; i < record->mCount; ++i, values += 1 + Detection::mNumCorners)
+    {
+        detections.emplace_back(values[0], std::array<float, Detection::mNumCorners>{{
+            values[1], values[2], values[3], values[4]}});
+    }
+}
+
+void DetectionCache::appendRecord(uint64_t key, const std::vector<Detection>& detections)
+{
+    auto header = reinterpret_cast<LogHeader*>(mLog);
+    auto recordSize = getRecordSize(detections.size());
+    if (sizeof(LogHeader) + recordSize > mParams.mMaxLogSize)
+    {
+        return;
+    }
+
+    if (header->mSize + recordSize > mParams.mMaxLogSize)
+    {
+        inference::gLogInfo << "The detection cache log is full, starting it over" << std::endl;
+        header->mSize = sizeof(LogHeader);
+        mDiskIndex.clear();
+    }
+
+    auto offset = header->mSize;
+    auto values = reinterpret_cast<float*>(mLog + offset + sizeof(RecordHeader));
+    for (const auto& detection : detections)
+    {
+        *values++ = detection.mScore;
+        values = std::copy(detection.mBox.cbegin(), detection.mBox.cend(), values);
+    }
+
+    auto count = static_cast<uint32_t>(detections.size());
+    RecordHeader record{key, count, getChecksum(key, count, mLog + offset + sizeof(RecordHeader))};
+    std::memcpy(mLog + offset, &record, sizeof(record));
+
+    // The record counts once it is complete
+    header->mSize = offset + recordSize;
+    mDiskIndex[key] = offset;
+}
+
+void DetectionCache::remember(uint64_t key, const std::vector<Detection>& detections)
+{
+    if (mParams.mMemoryEntries == 0)
+    {
+        return;
+    }
+
+    auto cached = mMemoryIndex.find(key);
+    if (cached != mMemoryIndex.end())
+    {
+        mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed, cached->second);
+        cached->second->second = detections;
+        return;
+    }
+
+    if (mMemoryIndex.size() >= mParams.mMemoryEntries)
+    {
+        mMemoryIndex.erase(mRecentlyUsed.back().first);
+        mRecentlyUsed.pop_back();
+    }
+    mRecentlyUsed.emplace_front(key, detections);
+    mMemoryIndex[key] = mRecentlyUsed.begin();
+}
@@ -0,0 +1,192 @@
+#include "inference/detectionTracker.h"
+#include "inference/hostProcessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace
+{
+
+std::array<float, 4> getState(const Detection& detection)
+{
+    const auto& box = detection.mBox;
+    return {(box[0] + box[2]) / 2, (box[1] + box[3]) / 2, box[2] - box[0], box[3] - box[1]};
+}
+
+} // anonymous namespace
+
+DetectionTracker::DetectionTracker(const TrackerParams& params)
+    : mParams(params)
+    , mInterval(params.mDetectionInterval > 0 ? params.mDetectionInterval : 1)
+{
+}
+
+bool DetectionTracker::is_detection_due() const
+{
+    return mLost || (mFramesSinceDetection + 1 >= mInterval);
+}
+
+void DetectionTracker::update(std::vector<Detection>& detections)
+{
+    advance();
+    const float elapsedFrames = mFramesSinceDetection + 1;
+
+    // Greedy association, the best overlaps first
+    std::vector<std::tuple<float, size_t, size_t>> pairs;
+    for (size_t t = 0; t < mTracks.size(); ++t)
+    {
+        auto predicted = makeDetection(mTracks[t]);
+        for (size_t d = 0; d < detections.size(); ++d)
+        {
+            auto iou = getIou(predicted, detections[d]);
+            if (iou >= mParams.mIouThreshold)
+            {
+                pairs.emplace_back(iou, t, d);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(),
+        [](const std::tuple<float, size_t, size_t>& left, const std::tuple<float, size_t, size_t>& right)
+        {
+            return std::get<0>(left) > std::get<0>(right);
+        });
+
+    std::vector<bool> trackMatched(mTracks.size(), false);
+    std::vector<bool> detectionMatched(detections.size(), false);
+    for (const auto& pair : pairs)
+    {
+        auto t = std::get<1>(pair);
+        auto d = std::get<2>(pair);
+        if (trackMatched[t] || detectionMatched[d])
+        {
+            continue;
+        }
+        trackMatched[t] = true;
+        detectionMatched[d] = true;
+
+        auto& track = mTracks[t];
+        auto measured = getState(detections[d]);
+        for (size_t i = 0; i < track.mState.size(); ++i)
+        {
+            auto residual = measured[i] - track.mState[i];
+            track.mState[i] += mParams.mPositionGain * residual;
+            track.mVelocity[i] += mParams.mVelocityGain * residual / elapsedFrames;
+        }
+        track.mScore = detections[d].mScore;
+        track.mConfidence = 1.0f;
+        track.mMisses = 0;
+        detections[d].mTrackId = track.mId;
+    }
+
+    for (size_t t = 0; t < mTracks.size(); ++t)
+    {
+        if (!trackMatched[t])
+        {
+            ++mTracks[t].mMisses;
+            mTracks[t].mVelocity.fill(0.0f);
+        }
+    }
+    mTracks.erase(std::remove_if(mTracks.begin(), mTracks.end(),
+        [this](const Track& track) { return track.mMisses > mParams.mMaxMisses; }), mTracks.end());
+
+    for (size_t d = 0; d < detections.size(); ++d)
+    {
+        if (!detectionMatched[d])
+        {
+            detections[d].mTrackId = mNextId;
+            mTracks.push_back(Track{mNextId++, detections[d].mScore, 1.0f, 0, getState(detections[d]), {}});
+        }
+    }
+
+    mFramesSinceDetection = 0;
+    mLost = false;
+    updateInterval();
+}
+
+void DetectionTracker::predict(std::vector<Detection>& detections)
+{
+    advance();
+    ++mFramesSinceDetection;
+
+    detections.clear();
+    for (auto& track : mTracks)
+    {
+        if (track.mMisses > 0)
+        {
+            continue;
+        }
+
+        track.mConfidence *= mParams.mConfidenceDecay;
+        const auto& state = track.mState;
+        bool inFrame = (state[0] > 0.0f) && (state[0] < 1.0f) && (state[1] > 0.0f) && (state[1] < 1.0f)
+            && (state[2] > 0.0f) && (state[3] > 0.0f);
+        if (!inFrame || (track.mConfidence < mParams.mMinConfidence))
+        {
+            mLost = true;
+        }
+        if (inFrame)
+        {
+            detections.push_back(makeDetection(track));
+        }
+    }
+
+    std::sort(detections.begin(), detections.end(), ScoreDescendingCompare());
+}
+
+int DetectionTracker::get_detection_interval() const
+{
+    return mInterval;
+}
+
+void DetectionTracker::advance()
+{
+    for (auto& track : mTracks)
+    {
+        for (size_t i = 0; i < track.mState.size(); ++i)
+        {
+            track.mState[i] += track.mVelocity[i];
+        }
+    }
+}
+
+//!
+//! \brief Picks the interval the fastest track drifts the allowed part of its size in
+//!
+void DetectionTracker::updateInterval()
+{
+    if (mParams.mDetectionInterval > 0)
+    {
+        return;
+    }
+
+    float motion = 0.0f;
+    for (const auto& track : mTracks)
+    {
+        if (track.mMisses > 0)
+        {
+            continue;
+        }
+
+        auto size = std::max(std::max(track.mState[2], track.mState[3]), 1e-3f);
+        auto speed = std::max(
+            std::hypot(track.mVelocity[0], track.mVelocity[1]),
+            std::max(std::abs(track.mVelocity[2]), std::abs(track.mVelocity[3])));
+        motion = std::max(motion, speed / size);
+    }
+
+    auto interval = motion > 0.0f ? mParams.mMaxDrift / motion : mParams.mMaxDetectionInterval;
+    mInterval = std::max(1, std::min(mParams.mMaxDetectionInterval, static_cast<int>(interval)));
+}
+
+Detection DetectionTracker::makeDetection(const Track& track) const
+{
+    const auto& state = track.mState;
+    Detection detection(track.mScore, {
+        std::max(0.0f, state[0] - state[2] / 2),
+        std::max(0.0f, state[1] - state[3] / 2),
+        std::min(1.0f, state[0] + state[2] / 2),
+        std::min(1.0f, state[1] + state[3] / 2)});
+    detection.mTrackId = track.mId;
+    return detection;
+}
@@ -0,0 +1,150 @@
+#include "logger.h"
+#include "inference/faceStage.h"
+#include "inference/trtFaceStage.h"
+#include "trace/tracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+//!
+//! \brief Five landmarks at fixed places of the box after a simulated latency, for load testing without a GPU
+//!
+class MockFaceStageContext : public FaceStageContext
+{
+public:
+    bool infer(const std::vector<FaceCrop>& crops, std::vector<std::vector<float>>& outputs) override
+    {
+        trace_span span("face_infer");
+        std::this_thread::sleep_for(std::chrono::microseconds(500 + 100 * crops.size()));
+
+        // Eyes, nose and mouth corners relative to the box
+        static const float landmarks[] = {0.3f, 0.35f, 0.7f, 0.35f, 0.5f, 0.55f, 0.35f, 0.75f, 0.65f, 0.75f};
+        outputs.resize(crops.size());
+        for (size_t i = 0; i < crops.size(); ++i)
+        {
+            const auto& box = crops[i].mBox;
+            outputs[i].resize(10);
+            for (int p = 0; p < 10; p += 2)
+            {
+                outputs[i][p] = box[0] + landmarks[p] * (box[2] - box[0]);
+                outputs[i][p + 1] = box[1] + landmarks[p + 1] * (box[3] - box[1]);
+            }
+        }
+        return true;
+    }
+};
+
+class MockFaceStageEngine : public FaceStageEngine
+{
+public:
+    bool build() override
+    {
+        return true;
+    }
+
+    std::unique_ptr<FaceStageContext> create_context() override
+    {
+        return std::unique_ptr<FaceStageContext>(new MockFaceStageContext());
+    }
+
+    int get_max_batch_size() const override
+    {
+        return 32;
+    }
+
+    int get_output_size() const override
+    {
+        return 10;
+    }
+};
+
+} // anonymous namespace
+
+void preprocessFaceCrops(
+    const std::vector<FaceCrop>& crops,
+    int inputWidth,
+    int inputHeight,
+    const FaceStageParams& params,
+    float* hostDataBuffer)
+{
+    const auto& pixelMean = params.mPreprocessingMeans;
+    const auto pixelNorm = params.mPreprocessingNorm;
+    const int volChl = inputWidth * inputHeight;
+    std::vector<int> left(inputWidth);
+    std::vector<int> right(inputWidth);
+    std::vector<float> rightWeight(inputWidth);
+
+    for (size_t i = 0; i < crops.size(); ++i)
+    {
+        const auto& frame = *crops[i].mFrame;
+        const auto& box = crops[i].mBox;
+
+        // The enlarged box in pixels, with the aspect ratio of the input
+        auto centerX = (box[0] + box[2]) / 2 * frame.cols;
+        auto centerY = (box[1] + box[3]) / 2 * frame.rows;
+        auto cropHeight = std::max((box[3] - box[1]) * frame.rows,
+            (box[2] - box[0]) * frame.cols * inputHeight / inputWidth) * params.mCropScale;
+        auto cropWidth = cropHeight * inputWidth / inputHeight;
+        auto scaleX = cropWidth / inputWidth;
+        auto scaleY = cropHeight / inputHeight;
+        auto originX = centerX - cropWidth / 2;
+        auto originY = centerY - cropHeight / 2;
+
+        // The columns are the same for every row of the crop
+        for (int x = 0; x < inputWidth; ++x)
+        {
+            auto sourceX = std::min(std::max(originX + (x + 0.5f) * scaleX - 0.5f, 0.0f), frame.cols - 1.0f);
+            left[x] = static_cast<int>(sourceX);
+            right[x] = std::min(left[x] + 1, frame.cols - 1);
+            rightWeight[x] = sourceX - left[x];
+        }
+
+        float* crop = hostDataBuffer + i * 3 * volChl;
+        for (int y = 0; y < inputHeight; ++y)
+        {
+            auto sourceY = std::min(std::max(originY + (y + 0.5f) * scaleY - 0.5f, 0.0f), frame.rows - 1.0f);
+            auto top = static_cast<int>(sourceY);
+            auto bottom = std::min(top + 1, frame.rows - 1);
+            auto bottomWeight = sourceY - top;
+            const auto* topRow = frame.ptr<cv::Vec3b>(top);
+            const auto* bottomRow = frame.ptr<cv::Vec3b>(bottom);
+
+            for (int x = 0; x < inputWidth; ++x)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    auto upper = topRow[left[x]][c] + rightWeight[x] * (topRow[right[x]][c] - topRow[left[x]][c]);
+                    auto lower = bottomRow[left[x]][c]
+                        + rightWeight[x] * (bottomRow[right[x]][c] - bottomRow[left[x]][c]);
+                    auto value = upper + bottomWeight * (lower - upper);
+                    crop[c * volChl + y * inputWidth + x] = (value - pixelMean[c]) / pixelNorm;
+                }
+            }
+        }
+    }
+}
+
+std::unique_ptr<FaceStageEngine> createFaceStageEngine(
+    const std::string& backend,
+    const FaceStageParams& params,
+    const std::vector<std::string>& dataDirs,
+    bool fp16)
+{
+    if (backend == "mock")
+    {
+        inference::gLogInfo << "Building a mock face stage" << std::endl;
+        return std::unique_ptr<FaceStageEngine>(new MockFaceStageEngine());
+    }
+    else if (backend == "tensorrt")
+    {
+        inference::gLogInfo << "Building the face stage " << params.mOnnxFileName << std::endl;
+        return std::unique_ptr<FaceStageEngine>(new TrtFaceStageEngine(params, dataDirs, fp16));
+    }
+
+    throw std::invalid_argument("Unknown inference backend: " + backend);
+}
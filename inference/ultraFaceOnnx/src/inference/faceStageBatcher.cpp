@@ -0,0 +1,176 @@
+#include "logger.h"
+#include "inference/faceStageBatcher.h"
+#include "trace/tracer.h"
+
+#include <algorithm>
+
+FaceStageBatcher::FaceStageBatcher(std::unique_ptr<FaceStageEngine> engine, const FaceStageParams& params)
+    : mEngine(std::move(engine))
+    , mParams(params)
+{
+}
+
+FaceStageBatcher::~FaceStageBatcher()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mQueueChanged.notify_all();
+
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+bool FaceStageBatcher::start()
+{
+    if (!mEngine->build())
+    {
+        inference::gLogError << "Failed to build the face stage " << mParams.mOnnxFileName << std::endl;
+        return false;
+    }
+
+    mMaxBatchSize = static_cast<size_t>(std::max(mEngine->get_max_batch_size(), 1));
+    for (int i = 0; i < std::max(mParams.mContexts, 1); ++i)
+    {
+        auto context = mEngine->create_context();
+        if (!context)
+        {
+            inference::gLogError << "Failed to create a face stage context" << std::endl;
+            return false;
+        }
+        mContexts.push_back(std::move(context));
+    }
+
+    for (auto& context : mContexts)
+    {
+        mThreads.emplace_back(&FaceStageBatcher::run, this, std::ref(*context));
+    }
+
+    inference::gLogInfo << "Started " << mContexts.size() << " face stage contexts with batches of up to "
+        << mMaxBatchSize << " crops and " << get_output_size() << " outputs per crop." << std::endl;
+    return true;
+}
+
+bool FaceStageBatcher::process(const cv::Mat& frame, std::vector<Detection>& detections)
+{
+    if (detections.empty())
+    {
+        return true;
+    }
+
+    // A request fits in one batch, the crops of a frame with more faces are split
+    std::vector<Request> requests((detections.size() + mMaxBatchSize - 1) / mMaxBatchSize);
+    auto queuedAt = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < detections.size(); ++i)
+    {
+        auto& request = requests[i / mMaxBatchSize];
+        request.mCrops.push_back(FaceCrop{&frame, detections[i].mBox});
+        request.mQueuedAt = queuedAt;
+        request.mDone = false;
+        request.mSucceeded = false;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (auto& request : requests)
+    {
+        mQueue.push_back(&request);
+        mQueuedCrops += request.mCrops.size();
+    }
+    mQueueChanged.notify_all();
+
+    mRequestsDone.wait(lock, [&requests]()
+    {
+        return std::all_of(requests.cbegin(), requests.cend(), [](const Request& request)
+        {
+            return request.mDone;
+        });
+    });
+    lock.unlock();
+
+    for (size_t i = 0; i < detections.size(); ++i)
+    {
+        auto& request = requests[i / mMaxBatchSize];
+        if (!request.mSucceeded)
+        {
+            return false;
+        }
+        detections[i].mAttributes = std::move(request.mOutputs[i % mMaxBatchSize]);
+    }
+    return true;
+}
+
+int FaceStageBatcher::get_output_size() const
+{
+    return mEngine->get_output_size();
+}
+
+void FaceStageBatcher::run(FaceStageContext& context)
+{
+    std::vector<Request*> batch;
+    std::vector<FaceCrop> crops;
+    std::vector<std::vector<float>> outputs;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mQueueChanged.wait(lock, [this]()
+        {
+            return mStopping || !mQueue.empty();
+        });
+        if (mQueue.empty())
+        {
+            break;
+        }
+
+        // Waits for the crops of other sessions until the batch is full or the oldest crop is due
+        auto deadline = mQueue.front()->mQueuedAt + mParams.mMaxDelay;
+        mQueueChanged.wait_until(lock, deadline, [this]()
+        {
+            return mStopping || mQueue.empty() || (mQueuedCrops >= mMaxBatchSize);
+        });
+        if (mQueue.empty())
+        {
+            // Another context took them
+            continue;
+        }
+
+        batch.clear();
+        crops.clear();
+        while (!mQueue.empty() && (crops.size() + mQueue.front()->mCrops.size() <= mMaxBatchSize))
+        {
+            auto request = mQueue.front();
+            mQueue.pop_front();
+            mQueuedCrops -= request->mCrops.size();
+            crops.insert(crops.end(), request->mCrops.cbegin(), request->mCrops.cend());
+            batch.push_back(request);
+        }
+        lock.unlock();
+
+        bool succeeded;
+        {
+            trace_span span("face_stage_batch");
+            succeeded = context.infer(crops, outputs);
+        }
+        size_t first = 0;
+        for (auto request : batch)
+        {
+            request->mSucceeded = succeeded;
+            if (succeeded)
+            {
+                request->mOutputs.assign(std::make_move_iterator(outputs.begin() + first),
+                    std::make_move_iterator(outputs.begin() + first + request->mCrops.size()));
+            }
+            first += request->mCrops.size();
+        }
+
+        lock.lock();
+        for (auto request : batch)
+        {
+            request->mDone = true;
+        }
+        mRequestsDone.notify_all();
+    }
+}
@@ -0,0 +1,106 @@
+#include "inference/hostProcessing.h"
+
+void preprocessBatch(
+    const std::vector<cv::Mat>& batch,
+    const UltraFaceInferenceParams& params,
+    float* hostDataBuffer)
+{
+    const int batchSize = batch.size();
+    const int inputC = params.mInputDims.d[1];
+    const int inputH = params.mInputDims.d[2];
+    const int inputW = params.mInputDims.d[3];
+    const std::array<float, 3>& pixelMean = params.mPreprocessingMeans;
+    float pixelNorm = params.mPreprocessingNorm;
+
+    for (int i = 0, volImg = inputC * inputH * inputW; i < batchSize; ++i)
+    {
+        for (int c = 0; c < inputC; ++c)
+        {
+            // The color image to input should be in BGR order
+            for (unsigned j = 0, volChl = inputH * inputW; j < volChl; ++j)
+            {
+                auto y = j / inputW;
+                auto x = j % inputW;
+                hostDataBuffer[i * volImg + c * volChl + j]
+                    = (float(batch[i].at<cv::Vec3b>(y, x).val[c]) - pixelMean[c]) / pixelNorm;
+            }
+        }
+    }
+}
+
+void parseDetections(
+    const float* scores,
+    const float* boxes,
+    const UltraFaceInferenceParams& params,
+    std::vector<Detection>& detections)
+{
+    std::multiset<Detection, ScoreDescendingCompare> allDetections;
+
+    for (int i = 0; i < params.mDetectionsCount; ++i)
+    {
+        auto faceScoreOffset = i * params.mNumClasses + params.mDetectionClassIndex;
+        auto faceScore = *(scores + faceScoreOffset);
+
+        if (faceScore > params.mDetectionThreshold)
+        {
+            std::array<float, Detection::mNumCorners> box;
+            for (int c = 0; c < box.size(); c++)
+            {
+                box[c] = boxes[i * box.size() + c];
+            }
+
+            allDetections.emplace(faceScore, std::move(box));
+        }
+    }
+
+    nms(allDetections, detections, 0.5f);
+}
+
+float getIntersectionArea(const Detection& first, const Detection& second)
+{
+    auto intersection_left = first.mBox[0] > second.mBox[0] ? first.mBox[0] : second.mBox[0];
+    auto intersection_right = first.mBox[2] < second.mBox[2] ? first.mBox[2] : second.mBox[2];
+    auto w = intersection_right - intersection_left;
+    auto intersection_top = first.mBox[1] > second.mBox[1] ? first.mBox[1] : second.mBox[1];
+    auto intersection_bottom = first.mBox[3] < second.mBox[3] ? first.mBox[3] : second.mBox[3];
+    auto h = intersection_bottom - intersection_top;
+
+    // Both sides are negative for boxes apart diagonally
+    return (w > 0 && h > 0) ? w * h : 0.0f;
+}
+
+float getIou(const Detection& first, const Detection& second)
+{
+    auto intersection_area = getIntersectionArea(first, second);
+    auto union_area = first.get_box_area() + second.get_box_area() - intersection_area;
+    return intersection_area / union_area;
+}
+
+void nms(
+    std::multiset<Detection, ScoreDescendingCompare>& allDetections,
+    std::vector<Detection>& resultDetections,
+    float iouThreshold)
+{
+    while (!allDetections.empty())
+    {
+        auto proposal_it = allDetections.begin();
+        auto proposal = *proposal_it;
+        allDetections.erase(proposal_it);
+
+        bool discard = false;
+        for (const auto& other: allDetections)
+        {
+            auto iou = getIou(proposal, other);
+            if (iou > iouThreshold)
+            {
+                discard = true;
+                break;
+            }
+        }
+
+        if (!discard)
+        {
+            resultDetections.push_back(proposal);
+        }
+    }
+}
@@ -0,0 +1,316 @@
+#include "logger.h"
+#include "inference/inferenceConfig.h"
+#include "inference/mockInferenceEngine.h"
+#include "inference/ultraFaceOnnx.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+//!
+//! \brief Parses "fixed <ms>", "lognormal <median ms> <sigma>" or "trace <file>"
+//!
+void parseMockLatency(const std::string& value, MockInferenceParams& params)
+{
+    std::istringstream values(value);
+    std::string distribution;
+    values >> distribution;
+    if (distribution == "fixed")
+    {
+        params.mLatencyDistribution = MockLatencyDistribution::kFIXED;
+        values >> params.mLatencyMs;
+    }
+    else if (distribution == "lognormal")
+    {
+        params.mLatencyDistribution = MockLatencyDistribution::kLOGNORMAL;
+        values >> params.mLatencyMs >> params.mLatencySigma;
+    }
+    else if (distribution == "trace")
+    {
+        params.mLatencyDistribution = MockLatencyDistribution::kTRACE;
+        values >> params.mLatencyTraceFile;
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown mock latency distribution: " + value);
+    }
+
+    if (values.fail())
+    {
+        throw std::invalid_argument("Wrong mock latency: " + value);
+    }
+}
+
+//!
+//! \brief Parses "random <mean count>" or "replay <file>"
+//!
+void parseMockDetections(const std::string& value, MockInferenceParams& params)
+{
+    std::istringstream values(value);
+    std::string source;
+    values >> source;
+    if (source == "random")
+    {
+        params.mDetectionsFile.clear();
+        values >> params.mDetectionsMean;
+    }
+    else if (source == "replay")
+    {
+        values >> params.mDetectionsFile;
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown mock detections source: " + value);
+    }
+
+    if (values.fail())
+    {
+        throw std::invalid_argument("Wrong mock detections: " + value);
+    }
+}
+
+} // anonymous namespace
+
+bool readInferenceConfig(const std::string& name, const std::string& value, InferenceConfig& config)
+{
+    const char separator = ' ';
+    auto& params = config.mParams;
+    auto& mockParams = config.mMockParams;
+    if (name == "INFERENCE_BACKEND")
+    {
+        config.mBackend = value;
+        inference::gLogInfo << name << ": " << config.mBackend << std::endl;
+    }
+    else if (name == "MOCK_INPUT_SIZE")
+    {
+        std::istringstream values(value);
+        values >> mockParams.mInputWidth >> mockParams.mInputHeight;
+        inference::gLogInfo << name << ": " << mockParams.mInputWidth << " " << mockParams.mInputHeight << std::endl;
+    }
+    else if (name == "MOCK_LATENCY")
+    {
+        parseMockLatency(value, mockParams);
+        inference::gLogInfo << name << ": " << value << std::endl;
+    }
+    else if (name == "MOCK_BATCH_SCALING")
+    {
+        mockParams.mBatchScaling = std::stof(value);
+        inference::gLogInfo << name << ": " << mockParams.mBatchScaling << std::endl;
+    }
+    else if (name == "MOCK_MAX_BATCH_SIZE")
+    {
+        mockParams.mMaxBatchSize = std::stoi(value);
+        inference::gLogInfo << name << ": " << mockParams.mMaxBatchSize << std::endl;
+    }
+    else if (name == "MOCK_DETECTIONS")
+    {
+        parseMockDetections(value, mockParams);
+        inference::gLogInfo << name << ": " << value << std::endl;
+    }
+    else if (name == "MOCK_SEED")
+    {
+        mockParams.mSeed = std::stoul(value);
+        inference::gLogInfo << name << ": " << mockParams.mSeed << std::endl;
+    }
+    else if (name == "WARMUP_CONTEXTS")
+    {
+        config.mWarmUp.mContexts = std::stoi(value);
+        inference::gLogInfo << name << ": " << config.mWarmUp.mContexts << std::endl;
+    }
+    else if (name == "WARMUP_ITERATIONS")
+    {
+        config.mWarmUp.mIterations = std::stoi(value);
+        inference::gLogInfo << name << ": " << config.mWarmUp.mIterations << std::endl;
+    }
+    else if (name == "WARMUP_BATCH_SIZES")
+    {
+        std::istringstream values(value);
+        config.mWarmUp.mBatchSizes.clear();
+        for (int batchSize; values >> batchSize; )
+        {
+            config.mWarmUp.mBatchSizes.push_back(batchSize);
+        }
+        inference::gLogInfo << name << ": " << value << std::endl;
+    }
+    else if (name == "DATA_DIR")
+    {
+        params->dataDirs.push_back(value);
+        inference::gLogInfo << name << ": " << params->dataDirs[0] << std::endl;
+    }
+    else if (name == "ONNX_FILE_NAME")
+    {
+        params->onnxFileName = value;
+        inference::gLogInfo << name << ": " << params->onnxFileName << std::endl;
+    }
+    else if (name == "MODEL")
+    {
+        std::istringstream values(value);
+        ModelConfig model;
+        values >> model.mName >> model.mOnnxFileName;
+        if (values.fail())
+        {
+            throw std::invalid_argument("Wrong model, expected \"<name> <onnx file>\": " + value);
+        }
+        config.mModels.push_back(model);
+        inference::gLogInfo << name << ": " << model.mName << " " << model.mOnnxFileName << std::endl;
+    }
+    else if (name == "ENGINE_CACHE_DIR")
+    {
+        params->mEngineCacheDir = value;
+        inference::gLogInfo << name << ": " << params->mEngineCacheDir << std::endl;
+    }
+    else if (name == "INPUT_TENSORS")
+    {
+        params->inputTensorNames.push_back(value);
+        inference::gLogInfo << name << ": " << params->inputTensorNames[0] << std::endl;
+    }
+    else if (name == "OUTPUT_TENSORS")
+    {
+        inference::gLogInfo << name << ": ";
+        std::string::size_type start = 0;
+        for (
+            auto stop = value.find_first_of(separator);
+            stop != std::string::npos;
+            stop = value.find_first_of(separator, start))
+        {
+            params->outputTensorNames.push_back(value.substr(start, stop - start));
+            start = stop + 1;
+            inference::gLogInfo << params->outputTensorNames.back() << " ";
+        }
+        params->outputTensorNames.push_back(value.substr(start, value.size() - start));
+        inference::gLogInfo << params->outputTensorNames.back() << std::endl;
+    }
+    else if (name == "PREPROCESSING_MEANS")
+    {
+        inference::gLogInfo << name << ": ";
+        std::string::size_type start = 0;
+        auto channel = 0;
+        for (
+            auto stop = value.find_first_of(separator);
+            stop != std::string::npos;
+            stop = value.find_first_of(separator, start))
+        {
+            auto mean = std::stof(value.substr(start, stop - start));
+            params->mPreprocessingMeans[channel++] = mean;
+            start = stop + 1;
+            inference::gLogInfo << mean << " ";
+        }
+        auto mean = std::stof(value.substr(start, value.size() - start));
+        params->mPreprocessingMeans[channel] = mean;
+        inference::gLogInfo << mean << std::endl;
+    }
+    else if (name == "PREPROCESSING_NORM")
+    {
+        params->mPreprocessingNorm = std::stof(value);
+        inference::gLogInfo << name << ": " << params->mPreprocessingNorm << std::endl;
+    }
+    else if (name == "DETECTION_THRESHOLD")
+    {
+        params->mDetectionThreshold = std::stof(value);
+        inference::gLogInfo << name << ": " << params->mDetectionThreshold << std::endl;
+    }
+    else if (name == "NUM_CLASSES")
+    {
+        params->mNumClasses = std::stoi(value);
+        inference::gLogInfo << name << ": " << params->mNumClasses << std::endl;
+    }
+    else if (name == "DETECTION_CLASS")
+    {
+        params->mDetectionClassIndex = std::stoi(value);
+        inference::gLogInfo << name << ": " << params->mDetectionClassIndex << std::endl;
+    }
+    else if (name == "DETECTION_CACHE_ENTRIES")
+    {
+        config.mDetectionCache.mMemoryEntries = std::stoul(value);
+        inference::gLogInfo << name << ": " << config.mDetectionCache.mMemoryEntries << std::endl;
+    }
+    else if (name == "DETECTION_CACHE_DIR")
+    {
+        config.mDetectionCache.mDirectory = value;
+        inference::gLogInfo << name << ": " << config.mDetectionCache.mDirectory << std::endl;
+    }
+    else if (name == "DETECTION_CACHE_MAX_MB")
+    {
+        config.mDetectionCache.mMaxLogSize = std::stoul(value) << 20;
+        inference::gLogInfo << name << ": " << value << std::endl;
+    }
+    else if (name == "FACE_STAGE_ONNX")
+    {
+        config.mFaceStage.mOnnxFileName = value;
+        inference::gLogInfo << name << ": " << config.mFaceStage.mOnnxFileName << std::endl;
+    }
+    else if (name == "FACE_STAGE_INPUT")
+    {
+        config.mFaceStage.mInputTensorName = value;
+        inference::gLogInfo << name << ": " << config.mFaceStage.mInputTensorName << std::endl;
+    }
+    else if (name == "FACE_STAGE_OUTPUT")
+    {
+        config.mFaceStage.mOutputTensorName = value;
+        inference::gLogInfo << name << ": " << config.mFaceStage.mOutputTensorName << std::endl;
+    }
+    else if (name == "FACE_STAGE_CROP_SCALE")
+    {
+        config.mFaceStage.mCropScale = std::stof(value);
+        inference::gLogInfo << name << ": " << config.mFaceStage.mCropScale << std::endl;
+    }
+    else if (name == "FACE_STAGE_CONTEXTS")
+    {
+        config.mFaceStage.mContexts = std::stoi(value);
+        inference::gLogInfo << name << ": " << config.mFaceStage.mContexts << std::endl;
+    }
+    else if (name == "FACE_STAGE_MAX_DELAY_US")
+    {
+        config.mFaceStage.mMaxDelay = std::chrono::microseconds(std::stoi(value));
+        inference::gLogInfo << name << ": " << config.mFaceStage.mMaxDelay.count() << std::endl;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool readInferenceConfigFile(const std::string& fileName, InferenceConfig& config)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        inference::gLogError << "Cannot open the config: " << fileName << std::endl;
+        return false;
+    }
+
+    for (std::string line; std::getline(file, line); )
+    {
+        auto spaceIndex = line.find_first_of(' ');
+        if (spaceIndex == std::string::npos)
+        {
+            continue;
+        }
+
+        readInferenceConfig(line.substr(0, spaceIndex), line.substr(spaceIndex + 1), config);
+    }
+
+    return true;
+}
+
+std::unique_ptr<InferenceEngine> createInferenceEngine(const InferenceConfig& config)
+{
+    if (config.mBackend == "mock")
+    {
+        // Synthetic detections and latencies, for load testing without a GPU
+        inference::gLogInfo << "Building a mock inference engine" << std::endl;
+        return std::unique_ptr<InferenceEngine>(new MockInferenceEngine(config.mMockParams));
+    }
+    else if (config.mBackend == "tensorrt")
+    {
+        inference::gLogInfo << "Building and running a GPU inference engine for ultraFace Onnx" << std::endl;
+        return std::unique_ptr<InferenceEngine>(new UltraFaceOnnxEngine(config.mParams));
+    }
+
+    throw std::invalid_argument("Unknown inference backend: " + config.mBackend);
+}
@@ -0,0 +1,22 @@
+#include "inference/inferenceEngine.h"
+
+std::unique_ptr<InferenceContext> InferenceEngine::get_inference_context()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mPreparedMutex);
+        if (!mPreparedContexts.empty())
+        {
+            auto context = std::move(mPreparedContexts.back());
+            mPreparedContexts.pop_back();
+            return context;
+        }
+    }
+
+    return create_inference_context();
+}
+
+void InferenceEngine::add_prepared_context(std::unique_ptr<InferenceContext>&& context)
+{
+    const std::lock_guard<std::mutex> lock(mPreparedMutex);
+    mPreparedContexts.push_back(std::move(context));
+}
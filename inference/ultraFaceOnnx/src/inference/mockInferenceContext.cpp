@@ -0,0 +1,143 @@
+#include "inference/mockInferenceContext.h"
+#include "trace/tracer.h"
+
+#include <cmath>
+#include <thread>
+
+MockInferenceContext::MockInferenceContext(std::shared_ptr<const MockInferenceData> data, unsigned seed)
+    : mData(data)
+    , mRandom(seed)
+{
+}
+
+bool MockInferenceContext::infer(const std::vector<cv::Mat>& batch, std::vector<Detection>& detections)
+{
+    trace_span span("infer");
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        addDetections(detections);
+    }
+
+    std::this_thread::sleep_until(start + getLatency(batch.size()));
+
+    return true;
+}
+
+bool MockInferenceContext::infer_batch(
+    const std::vector<cv::Mat>& batch,
+    std::vector<std::vector<Detection>>& detections)
+{
+    if (batch.size() > static_cast<size_t>(mData->mParams.mMaxBatchSize))
+    {
+        return false;
+    }
+
+    trace_span span("infer");
+    auto start = std::chrono::steady_clock::now();
+
+    detections.resize(batch.size());
+    for (auto& frameDetections : detections)
+    {
+        frameDetections.clear();
+        addDetections(frameDetections);
+    }
+
+    std::this_thread::sleep_until(start + getLatency(batch.size()));
+
+    return true;
+}
+
+int MockInferenceContext::get_max_batch_size() const
+{
+    return mData->mParams.mMaxBatchSize;
+}
+
+int MockInferenceContext::get_input_height() const
+{
+    return mData->mParams.mInputHeight;
+}
+
+int MockInferenceContext::get_input_width() const
+{
+    return mData->mParams.mInputWidth;
+}
+
+//!
+//! \brief Draws the latency of a batch, the batch cost curve is linear in the batch size
+//!
+std::chrono::microseconds MockInferenceContext::getLatency(size_t batchSize)
+{
+    const auto& params = mData->mParams;
+    auto scale = 1.0f + (batchSize - 1.0f) * params.mBatchScaling;
+    float latencyMs = params.mLatencyMs;
+
+    switch (params.mLatencyDistribution)
+    {
+    case MockLatencyDistribution::kFIXED:
+        latencyMs *= scale;
+        break;
+    case MockLatencyDistribution::kLOGNORMAL:
+    {
+        std::lognormal_distribution<float> distribution(std::log(params.mLatencyMs), params.mLatencySigma);
+        latencyMs = distribution(mRandom) * scale;
+        break;
+    }
+    case MockLatencyDistribution::kTRACE:
+    {
+        // Latencies measured at the batch size are replayed as they are,
+        // otherwise the single frame ones are scaled
+        auto samples = mData->mLatencyTrace.find(batchSize);
+        if (samples == mData->mLatencyTrace.end())
+        {
+            samples = mData->mLatencyTrace.find(1);
+        }
+        else
+        {
+            scale = 1.0f;
+        }
+
+        if (samples != mData->mLatencyTrace.end())
+        {
+            auto& position = mTracePositions[samples->first];
+            latencyMs = samples->second[position] * scale;
+            position = (position + 1) % samples->second.size();
+        }
+        else
+        {
+            latencyMs *= scale;
+        }
+        break;
+    }
+    }
+
+    return std::chrono::microseconds(static_cast<long>(latencyMs * 1000));
+}
+
+void MockInferenceContext::addDetections(std::vector<Detection>& detections)
+{
+    if (!mData->mReplayedDetections.empty())
+    {
+        const auto& frame = mData->mReplayedDetections[mReplayPosition];
+        detections.insert(detections.end(), frame.begin(), frame.end());
+        mReplayPosition = (mReplayPosition + 1) % mData->mReplayedDetections.size();
+        return;
+    }
+
+    if (mData->mParams.mDetectionsMean <= 0.0f)
+    {
+        return;
+    }
+
+    std::poisson_distribution<int> count(mData->mParams.mDetectionsMean);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (auto i = count(mRandom); i > 0; --i)
+    {
+        auto size = 0.05f + 0.2f * unit(mRandom);
+        auto left = (1.0f - size) * unit(mRandom);
+        auto top = (1.0f - size) * unit(mRandom);
+        auto score = 0.9f + 0.1f * unit(mRandom);
+        detections.emplace_back(score, std::array<float, Detection::mNumCorners>{{left, top, left + size, top + size}});
+    }
+}
@@ -0,0 +1,131 @@
+#include "logger.h"
+#include "inference/mockInferenceEngine.h"
+#include "inference/planCache.h"
+
+#include <fstream>
+#include <sstream>
+
+bool MockInferenceEngine::build()
+{
+    auto data = std::make_shared<MockInferenceData>();
+    data->mParams = mParams;
+
+    if ((mParams.mLatencyDistribution == MockLatencyDistribution::kTRACE)
+        && !readLatencyTrace(mParams.mLatencyTraceFile, *data))
+    {
+        return false;
+    }
+
+    if (!mParams.mDetectionsFile.empty())
+    {
+        if (!readDetections(mParams.mDetectionsFile, data->mReplayedDetections))
+        {
+            return false;
+        }
+        if (data->mReplayedDetections.empty())
+        {
+            inference::gLogError << "No frames in the replayed detections: " << mParams.mDetectionsFile << std::endl;
+            return false;
+        }
+    }
+
+    mData = data;
+
+    // The replayed detections by their content, so an edited file is another model
+    std::ostringstream modelKey;
+    modelKey << "mock;input=" << mParams.mInputWidth << "x" << mParams.mInputHeight << ";detections=";
+    if (mParams.mDetectionsFile.empty())
+    {
+        modelKey << mParams.mDetectionsMean << ";seed=" << mParams.mSeed;
+    }
+    else
+    {
+        modelKey << std::hex << hashFile(mParams.mDetectionsFile);
+    }
+    mModelKey = modelKey.str();
+    return true;
+}
+
+const std::string& MockInferenceEngine::get_model_key() const
+{
+    return mModelKey;
+}
+
+std::unique_ptr<InferenceContext> MockInferenceEngine::create_inference_context()
+{
+    // Sessions draw different, but reproducible, random sequences
+    return std::unique_ptr<InferenceContext>(new MockInferenceContext(mData, mParams.mSeed + mContextCount++));
+}
+
+//!
+//! \brief Reads a latency per line, optionally preceded by the batch size
+//!
+bool MockInferenceEngine::readLatencyTrace(const std::string& fileName, MockInferenceData& data)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        inference::gLogError << "Cannot open the latency trace: " << fileName << std::endl;
+        return false;
+    }
+
+    for (std::string line; std::getline(file, line); )
+    {
+        std::istringstream values(line);
+        std::vector<float> numbers;
+        for (float number; values >> number; )
+        {
+            numbers.push_back(number);
+        }
+
+        if (numbers.size() == 1)
+        {
+            data.mLatencyTrace[1].push_back(numbers[0]);
+        }
+        else if (numbers.size() == 2)
+        {
+            data.mLatencyTrace[static_cast<int>(numbers[0])].push_back(numbers[1]);
+        }
+    }
+
+    if (data.mLatencyTrace.empty())
+    {
+        inference::gLogError << "No latencies in the trace: " << fileName << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+//!
+//! \brief Reads the detections of a frame per line, an empty line is a frame without detections
+//!
+bool MockInferenceEngine::readDetections(const std::string& fileName, std::vector<std::vector<Detection>>& detections)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        inference::gLogError << "Cannot open the detections: " << fileName << std::endl;
+        return false;
+    }
+
+    for (std::string line; std::getline(file, line); )
+    {
+        if (!line.empty() && (line[0] == '#'))
+        {
+            continue;
+        }
+
+        std::istringstream values(line);
+        std::vector<Detection> frame;
+        float score;
+        std::array<float, Detection::mNumCorners> box;
+        while (values >> score >> box[0] >> box[1] >> box[2] >> box[3])
+        {
+            frame.emplace_back(score, std::move(box));
+        }
+        detections.push_back(std::move(frame));
+    }
+
+    return true;
+}
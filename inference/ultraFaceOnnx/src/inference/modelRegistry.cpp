@@ -0,0 +1,189 @@
+#include "logger.h"
+#include "inference/modelRegistry.h"
+
+ModelRegistry::ModelRegistry(const InferenceConfig& config)
+    : mConfig(config)
+{
+    if (mConfig.mModels.empty())
+    {
+        mConfig.mModels.push_back(ModelConfig{"default", mConfig.mParams->onnxFileName});
+    }
+
+    for (const auto& model : mConfig.mModels)
+    {
+        mModels.push_back(Model{model, nullptr, 0, false, std::thread()});
+    }
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    for (auto& model : mModels)
+    {
+        if (model.mReloadThread.joinable())
+        {
+            model.mReloadThread.join();
+        }
+    }
+}
+
+bool ModelRegistry::build(WarmUpReport& report)
+{
+    for (auto& model : mModels)
+    {
+        WarmUpReport modelReport;
+        auto engine = buildEngine(model.mConfig, modelReport);
+        if (!engine)
+        {
+            return false;
+        }
+
+        model.mEngine = engine;
+        model.mVersion = 1;
+        report.mDuration += modelReport.mDuration;
+        report.mContexts += modelReport.mContexts;
+        report.mFailedInferences += modelReport.mFailedInferences;
+    }
+
+    if (!mConfig.mFaceStage.mOnnxFileName.empty())
+    {
+        mFaceStage = std::unique_ptr<FaceStageBatcher>(new FaceStageBatcher(
+            createFaceStageEngine(mConfig.mBackend, mConfig.mFaceStage, mConfig.mParams->dataDirs,
+                mConfig.mParams->fp16),
+            mConfig.mFaceStage));
+        if (!mFaceStage->start())
+        {
+            return false;
+        }
+    }
+
+    const auto& cacheParams = mConfig.mDetectionCache;
+    if ((cacheParams.mMemoryEntries > 0) || !cacheParams.mDirectory.empty())
+    {
+        mDetectionCache = std::unique_ptr<DetectionCache>(new DetectionCache(cacheParams));
+    }
+
+    return true;
+}
+
+std::shared_ptr<InferenceEngine> ModelRegistry::get_engine(const std::string& name)
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    auto model = name.empty() ? &mModels.front() : findModel(name);
+    return model ? model->mEngine : nullptr;
+}
+
+ReloadResult ModelRegistry::reload(const std::string& name)
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    auto model = findModel(name);
+    if (!model)
+    {
+        return ReloadResult::kUNKNOWN_MODEL;
+    }
+
+    if (model->mReloading)
+    {
+        return ReloadResult::kBUSY;
+    }
+
+    // The previous reload is over, at most it is releasing the engine it replaced
+    if (model->mReloadThread.joinable())
+    {
+        model->mReloadThread.join();
+    }
+
+    model->mReloading = true;
+    model->mReloadThread = std::thread(&ModelRegistry::reloadModel, this, model->mConfig);
+    return ReloadResult::kSTARTED;
+}
+
+std::vector<ModelStatus> ModelRegistry::get_models()
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<ModelStatus> models;
+    for (const auto& model : mModels)
+    {
+        models.push_back(ModelStatus{model.mConfig.mName, model.mConfig.mOnnxFileName,
+            model.mVersion, model.mReloading, &model == &mModels.front()});
+    }
+    return models;
+}
+
+FaceStageBatcher* ModelRegistry::get_face_stage()
+{
+    return mFaceStage.get();
+}
+
+DetectionCache* ModelRegistry::get_detection_cache()
+{
+    return mDetectionCache.get();
+}
+
+//!
+//! \brief Every model gets its own params, the engine fills in the dims of its network
+//!
+std::shared_ptr<InferenceEngine> ModelRegistry::buildEngine(const ModelConfig& model, WarmUpReport& report) const
+{
+    auto config = mConfig;
+    config.mParams = std::make_shared<UltraFaceInferenceParams>(*mConfig.mParams);
+    config.mParams->onnxFileName = model.mOnnxFileName;
+
+    inference::gLogInfo << "Building the model " << model.mName << ": " << model.mOnnxFileName << std::endl;
+    std::shared_ptr<InferenceEngine> engine = createInferenceEngine(config);
+    if (!engine->build())
+    {
+        inference::gLogError << "Failed to build the model " << model.mName << std::endl;
+        return nullptr;
+    }
+
+    report = warmUp(*engine, mConfig.mWarmUp);
+    inference::gLogInfo << "Warmed up " << report.mContexts << " contexts of the model " << model.mName
+        << " in " << report.mDuration.count() << " ms." << std::endl;
+    return engine;
+}
+
+void ModelRegistry::reloadModel(const ModelConfig& config)
+{
+    WarmUpReport report;
+    std::shared_ptr<InferenceEngine> engine;
+    try
+    {
+        engine = buildEngine(config, report);
+    }
+    catch (const std::exception& e)
+    {
+        inference::gLogError << "Failed to reload the model " << config.mName << ": " << e.what() << std::endl;
+    }
+
+    std::shared_ptr<InferenceEngine> previous;
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        auto model = findModel(config.mName);
+        model->mReloading = false;
+        if (!engine)
+        {
+            // The previous version keeps serving
+            return;
+        }
+
+        previous = std::move(model->mEngine);
+        model->mEngine = engine;
+        ++model->mVersion;
+        inference::gLogInfo << "Reloaded the model " << config.mName << ", version " << model->mVersion << std::endl;
+    }
+
+    // Released outside the lock, the running sessions keep the previous engine alive
+    previous.reset();
+}
+
+ModelRegistry::Model* ModelRegistry::findModel(const std::string& name)
+{
+    for (auto& model : mModels)
+    {
+        if (model.mConfig.mName == name)
+        {
+            return &model;
+        }
+    }
+    return nullptr;
+}
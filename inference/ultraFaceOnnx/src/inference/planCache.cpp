@@ -0,0 +1,182 @@
+#include "logger.h"
+#include "inference/planCache.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+const char kMagic[8] = {'U', 'F', 'P', 'L', 'A', 'N', '0', '1'};
+const uint64_t kFnvOffset = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t hashBytes(uint64_t hash, const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+//!
+//! \brief Header of a cache file, followed by the key and the plan
+//!
+struct PlanHeader
+{
+    char mMagic[8];
+    uint64_t mKeySize;
+    uint64_t mPlanSize;
+};
+
+// The plan starts aligned, as if it was allocated
+size_t getPlanOffset(size_t keySize)
+{
+    const size_t alignment = 64;
+    return (sizeof(PlanHeader) + keySize + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+MappedPlan::MappedPlan(void* mapping, size_t mappingSize, size_t planOffset)
+    : mMapping(mapping)
+    , mMappingSize(mappingSize)
+    , mPlanOffset(planOffset)
+{
+}
+
+MappedPlan::~MappedPlan()
+{
+    munmap(mMapping, mMappingSize);
+}
+
+const void* MappedPlan::data() const
+{
+    return static_cast<const char*>(mMapping) + mPlanOffset;
+}
+
+size_t MappedPlan::size() const
+{
+    return mMappingSize - mPlanOffset;
+}
+
+PlanCache::PlanCache(const std::string& directory)
+    : mDirectory(directory)
+{
+}
+
+std::unique_ptr<MappedPlan> PlanCache::load(const std::string& name, const std::string& key) const
+{
+    auto path = getPath(name, key);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat status;
+    if ((fstat(fd, &status) != 0) || (static_cast<size_t>(status.st_size) < sizeof(PlanHeader)))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // The plan is read straight from the page cache, without a copy into the heap
+    size_t mappingSize = status.st_size;
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    PlanHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    auto keyOffset = sizeof(PlanHeader);
+    if ((std::memcmp(header.mMagic, kMagic, sizeof(kMagic)) != 0)
+        || (header.mKeySize != key.size())
+        || (getPlanOffset(header.mKeySize) + header.mPlanSize != mappingSize)
+        || (std::memcmp(static_cast<const char*>(mapping) + keyOffset, key.data(), key.size()) != 0))
+    {
+        munmap(mapping, mappingSize);
+        inference::gLogWarning << "Stale or corrupted plan in the cache: " << path << std::endl;
+        return nullptr;
+    }
+
+    return std::unique_ptr<MappedPlan>(new MappedPlan(mapping, mappingSize, getPlanOffset(header.mKeySize)));
+}
+
+bool PlanCache::store(const std::string& name, const std::string& key, const void* data, size_t size) const
+{
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(mDirectory, ec);
+
+    auto path = getPath(name, key);
+    auto temporaryPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        PlanHeader header;
+        std::memcpy(header.mMagic, kMagic, sizeof(kMagic));
+        header.mKeySize = key.size();
+        header.mPlanSize = size;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(key.data(), key.size());
+        std::vector<char> padding(getPlanOffset(key.size()) - sizeof(header) - key.size(), 0);
+        file.write(padding.data(), padding.size());
+        file.write(static_cast<const char*>(data), size);
+        if (!file)
+        {
+            inference::gLogWarning << "Failed to write the plan cache: " << temporaryPath << std::endl;
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+std::string PlanCache::getPath(const std::string& name, const std::string& key) const
+{
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashString(key)));
+    return (boost::filesystem::path(mDirectory) / (name + "-" + hash + ".plan")).string();
+}
+
+uint64_t hashFile(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        return 0;
+    }
+
+    auto hash = kFnvOffset;
+    std::vector<char> buffer(1 << 16);
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        hash = hashBytes(hash, buffer.data(), file.gcount());
+    }
+    return hash;
+}
+
+uint64_t hashString(const std::string& value)
+{
+    return hashBytes(kFnvOffset, value.data(), value.size());
+}
@@ -0,0 +1,141 @@
+#include "inference/tiling.h"
+#include "inference/hostProcessing.h"
+#include "trace/tracer.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <set>
+
+namespace
+{
+
+//!
+//! \brief Offsets of the tiles along one side, the last one ends at the frame border
+//!
+std::vector<int> getOffsets(int frameLength, int count, float overlap, int& tileLength)
+{
+    // count tiles of the length, each one overlapping the previous one
+    tileLength = static_cast<int>(frameLength / (1.0f + (count - 1) * (1.0f - overlap)) + 0.5f);
+    tileLength = std::min(std::max(tileLength, 1), frameLength);
+
+    std::vector<int> offsets;
+    for (int i = 0; i < count; ++i)
+    {
+        auto offset = (count > 1) ? i * (frameLength - tileLength) / (count - 1) : 0;
+        offsets.push_back(offset);
+    }
+    return offsets;
+}
+
+} // anonymous namespace
+
+std::vector<cv::Rect> getTiles(const cv::Size& frameSize, const TilingParams& params)
+{
+    int tileWidth;
+    int tileHeight;
+    auto columns = getOffsets(frameSize.width, params.mColumns, params.mOverlap, tileWidth);
+    auto rows = getOffsets(frameSize.height, params.mRows, params.mOverlap, tileHeight);
+
+    std::vector<cv::Rect> tiles;
+    if (params.mFullFrame)
+    {
+        tiles.emplace_back(0, 0, frameSize.width, frameSize.height);
+    }
+    for (auto top : rows)
+    {
+        for (auto left : columns)
+        {
+            tiles.emplace_back(left, top, tileWidth, tileHeight);
+        }
+    }
+    return tiles;
+}
+
+std::vector<cv::Rect> getDetectionRegions(
+    const cv::Size& frameSize,
+    const cv::Size& inputSize,
+    const std::vector<Detection>& detections,
+    float scale)
+{
+    auto aspectRatio = static_cast<float>(inputSize.width) / inputSize.height;
+    std::vector<cv::Rect> regions;
+    for (const auto& detection : detections)
+    {
+        const auto& box = detection.mBox;
+        auto width = (box[2] - box[0]) * frameSize.width * scale;
+        auto height = (box[3] - box[1]) * frameSize.height * scale;
+        width = std::max(std::max(width, height * aspectRatio), static_cast<float>(inputSize.width));
+        height = width / aspectRatio;
+
+        cv::Rect region(
+            static_cast<int>((box[0] + box[2]) / 2 * frameSize.width - width / 2),
+            static_cast<int>((box[1] + box[3]) / 2 * frameSize.height - height / 2),
+            std::min(static_cast<int>(width), frameSize.width),
+            std::min(static_cast<int>(height), frameSize.height));
+        region.x = std::min(std::max(region.x, 0), frameSize.width - region.width);
+        region.y = std::min(std::max(region.y, 0), frameSize.height - region.height);
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+bool inferTiles(
+    InferenceContext& context,
+    const cv::Mat& frame,
+    const std::vector<cv::Rect>& tiles,
+    std::vector<Detection>& detections)
+{
+    cv::Size inputSize(context.get_input_width(), context.get_input_height());
+    auto maxBatchSize = static_cast<size_t>(std::max(context.get_max_batch_size(), 1));
+    std::multiset<Detection, ScoreDescendingCompare> allDetections;
+    std::vector<cv::Mat> batch;
+    std::vector<std::vector<Detection>> batchDetections;
+
+    for (size_t first = 0; first < tiles.size(); first += maxBatchSize)
+    {
+        auto last = std::min(tiles.size(), first + maxBatchSize);
+        batch.resize(last - first);
+        {
+            trace_span span("resize");
+            for (size_t i = first; i < last; ++i)
+            {
+                cv::Mat view(frame, tiles[i]);
+                if (view.size() == inputSize)
+                {
+                    batch[i - first] = view;
+                }
+                else
+                {
+                    // The slot may still be a view of the frame from the previous chunk,
+                    // resizing into it would write over the frame
+                    batch[i - first].release();
+                    cv::resize(view, batch[i - first], inputSize);
+                }
+            }
+        }
+
+        if (!context.infer_batch(batch, batchDetections))
+        {
+            return false;
+        }
+
+        for (size_t i = first; i < last; ++i)
+        {
+            const auto& tile = tiles[i];
+            for (const auto& detection : batchDetections[i - first])
+            {
+                const auto& box = detection.mBox;
+                allDetections.emplace(detection.mScore, std::array<float, Detection::mNumCorners>{{
+                    (tile.x + box[0] * tile.width) / frame.cols,
+                    (tile.y + box[1] * tile.height) / frame.rows,
+                    (tile.x + box[2] * tile.width) / frame.cols,
+                    (tile.y + box[3] * tile.height) / frame.rows}});
+            }
+        }
+    }
+
+    trace_span span("nms");
+    nms(allDetections, detections, 0.5f);
+    return true;
+}
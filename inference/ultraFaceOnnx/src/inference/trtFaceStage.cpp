@@ -0,0 +1,134 @@
+#include "logging.h"
+#include "inference/bindingInfo.h"
+#include "inference/trtFaceStage.h"
+#include "trace/tracer.h"
+
+#include "NvOnnxParser.h"
+
+bool TrtFaceStageContext::infer(const std::vector<FaceCrop>& crops, std::vector<std::vector<float>>& outputs)
+{
+    if (crops.size() > static_cast<size_t>(mInputDims.d[0]))
+    {
+        return false;
+    }
+
+    {
+        trace_span span("face_preprocess");
+        float* hostDataBuffer = mBufferManager->getHostBuffer<float>(mParams.mInputTensorName);
+        preprocessFaceCrops(crops, mInputDims.d[3], mInputDims.d[2], mParams, hostDataBuffer);
+    }
+
+    {
+        trace_span span("face_infer");
+        mBufferManager->copyInputToDevice();
+        if (!mExecutionContext->executeV2(mBufferManager->getDeviceBindings().data()))
+        {
+            return false;
+        }
+        mBufferManager->copyOutputToHost();
+    }
+
+    // The outputs of the crops follow each other
+    const float* output = mBufferManager->getHostBuffer<float>(mParams.mOutputTensorName);
+    outputs.resize(crops.size());
+    for (size_t i = 0; i < crops.size(); ++i)
+    {
+        outputs[i].assign(output + i * mOutputSize, output + (i + 1) * mOutputSize);
+    }
+
+    return true;
+}
+
+bool TrtFaceStageEngine::build()
+{
+    auto builder
+        = InferenceUniquePtr<nvinfer1::IBuilder>(nvinfer1::createInferBuilder(inference::gLogger.getTRTLogger()));
+    if (!builder)
+    {
+        return false;
+    }
+
+    const auto explicitBatch = 1U << static_cast<uint32_t>(NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
+    auto network = InferenceUniquePtr<nvinfer1::INetworkDefinition>(builder->createNetworkV2(explicitBatch));
+    auto config = InferenceUniquePtr<nvinfer1::IBuilderConfig>(builder->createBuilderConfig());
+    if (!network || !config)
+    {
+        return false;
+    }
+
+    auto parser = InferenceUniquePtr<nvonnxparser::IParser>(
+        nvonnxparser::createParser(*network, inference::gLogger.getTRTLogger()));
+    if (!parser
+        || !parser->parseFromFile(locateFile(mParams.mOnnxFileName, mDataDirs).c_str(),
+            static_cast<int>(inference::gLogger.getReportableSeverity())))
+    {
+        return false;
+    }
+
+    config->setMaxWorkspaceSize(16_MiB);
+    if (mFp16)
+    {
+        config->setFlag(BuilderFlag::kFP16);
+    }
+
+    mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
+        builder->buildEngineWithConfig(*network, *config), inferenceCommon::InferDeleter());
+    if (!mEngine)
+    {
+        return false;
+    }
+
+    auto inputIndex = mEngine->getBindingIndex(mParams.mInputTensorName.c_str());
+    auto outputIndex = mEngine->getBindingIndex(mParams.mOutputTensorName.c_str());
+    if ((inputIndex < 0) || (outputIndex < 0))
+    {
+        inference::gLogError << "The face stage model has no " << mParams.mInputTensorName
+            << " input or " << mParams.mOutputTensorName << " output." << std::endl;
+        return false;
+    }
+
+    mInputDims = mEngine->getBindingDimensions(inputIndex);
+    if ((mInputDims.nbDims != 4) || (mInputDims.d[1] != 3))
+    {
+        inference::gLogError << "The face stage model input is not a batch of color images." << std::endl;
+        return false;
+    }
+    mOutputSize = inferenceCommon::volume(mEngine->getBindingDimensions(outputIndex)) / mInputDims.d[0];
+
+    mBindings = std::make_shared<std::vector<BindingInfo>>();
+    for (auto i = 0; i < mEngine->getNbBindings(); i++)
+    {
+        mBindings->emplace_back(
+            mEngine->getBindingDataType(i),
+            mEngine->getBindingDimensions(i),
+            mEngine->getBindingVectorizedDim(i),
+            mEngine->getBindingComponentsPerElement(i),
+            mEngine->getBindingName(i),
+            mEngine->bindingIsInput(i));
+    }
+
+    return true;
+}
+
+std::unique_ptr<FaceStageContext> TrtFaceStageEngine::create_context()
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    auto context = mEngine->createExecutionContext();
+    if (!context)
+    {
+        return nullptr;
+    }
+
+    return std::unique_ptr<FaceStageContext>(
+        new TrtFaceStageContext(context, mBindings, mParams, mInputDims, mOutputSize));
+}
+
+int TrtFaceStageEngine::get_max_batch_size() const
+{
+    return mInputDims.d[0];
+}
+
+int TrtFaceStageEngine::get_output_size() const
+{
+    return mOutputSize;
+}
@@ -0,0 +1,120 @@
+#include "inference/trtInferenceContext.h"
+#include "inference/hostProcessing.h"
+#include "trace/tracer.h"
+
+bool TrtInferenceContext::infer(
+    const std::vector<cv::Mat>& batch,
+    std::vector<Detection>& detections)
+{
+    if (!execute(batch))
+    {
+        return false;
+    }
+
+    // Verify results
+    trace_span span("nms");
+    return parseOutput(0, detections);
+}
+
+bool TrtInferenceContext::infer_batch(
+    const std::vector<cv::Mat>& batch,
+    std::vector<std::vector<Detection>>& detections)
+{
+    if (!execute(batch))
+    {
+        return false;
+    }
+
+    trace_span span("nms");
+    detections.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        detections[i].clear();
+        if (!parseOutput(i, detections[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TrtInferenceContext::execute(const std::vector<cv::Mat>& batch)
+{
+    // Read the input data into the managed buffers
+    {
+        trace_span span("preprocess");
+        if (!preprocessInput(batch))
+        {
+            return false;
+        }
+    }
+
+    {
+        trace_span span("infer");
+
+        // Memcpy from host input buffers to device input buffers
+        mBufferManager->copyInputToDevice();
+
+        bool status = mExecutionContext->executeV2(mBufferManager->getDeviceBindings().data());
+        if (!status)
+        {
+            return false;
+        }
+
+        // Memcpy from device output buffers to host output buffers
+        mBufferManager->copyOutputToHost();
+    }
+
+    return true;
+}
+
+//!
+//! \brief Reads the input and stores the result in a managed buffer
+//!
+bool TrtInferenceContext::preprocessInput(const std::vector<cv::Mat>& batch)
+{
+    // The input buffer holds the batch size of the network
+    if (batch.size() > static_cast<size_t>(mParams->mInputDims.d[0]))
+    {
+        return false;
+    }
+
+    float* hostDataBuffer = mBufferManager->getHostBuffer<float>(mParams->inputTensorNames[0]);
+    preprocessBatch(batch, *mParams, hostDataBuffer);
+
+    return true;
+}
+
+//!
+//! \brief Detects objects and verify result
+//!
+//! \return whether the output matches expectations
+//!
+bool TrtInferenceContext::parseOutput(int batchIndex, std::vector<Detection>& detections)
+{
+    // The outputs of the frames follow each other
+    const float* scores = mBufferManager->getHostBuffer<float>("scores")
+        + batchIndex * mParams->mDetectionsCount * mParams->mNumClasses;
+    const float* boxes = mBufferManager->getHostBuffer<float>("boxes")
+        + batchIndex * mParams->mDetectionsCount * Detection::mNumCorners;
+
+    parseDetections(scores, boxes, *mParams, detections);
+
+    return true;
+}
+
+int TrtInferenceContext::get_max_batch_size() const
+{
+    return mParams->mInputDims.d[0];
+}
+
+int TrtInferenceContext::get_input_height() const
+{
+    return mParams->mInputDims.d[2];
+}
+
+int TrtInferenceContext::get_input_width() const
+{
+    return mParams->mInputDims.d[3];
+}
\ No newline at end of file
@@ -1,12 +1,21 @@
 #include "logging.h"
 #include "inference/bindingInfo.h"
+#include "inference/planCache.h"
 #include "inference/ultraFaceOnnx.h"
 
+#include <boost/filesystem.hpp>
+#include <cuda_runtime_api.h>
+
+#include <cstdio>
+#include <sstream>
+
 //!
 //! \brief Creates the network, configures the builder and creates the network engine
 //!
 //! \details This function creates the Onnx MNIST network by parsing the Onnx model and builds
-//!          the engine that will be used to run MNIST (mEngine)
+//!          the engine that will be used to run MNIST (mEngine). With ENGINE_CACHE_DIR set
+//!          the engine is deserialized from a plan cached by a previous start, if one
+//!          matches the model, the build flags and the runtime, and cached after a build.
 //!
 //! \return Returns true if the engine was created successfully and false otherwise
 //!
@@ -45,6 +54,22 @@ bool UltraFaceOnnxEngine::build()
         return false;
     }
 
+    assert(network->getNbInputs() == 1);
+    assert(network->getNbOutputs() == 4);
+
+    // Parsing is fast, building is what the cache saves
+    std::unique_ptr<PlanCache> cache;
+    std::string cacheKey;
+    if (!mParams->mEngineCacheDir.empty())
+    {
+        cache.reset(new PlanCache(mParams->mEngineCacheDir));
+        cacheKey = getCacheKey(network->getInput(0)->getDimensions());
+        if (loadEngine(*cache, cacheKey))
+        {
+            return initializeEngine();
+        }
+    }
+
     mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
         builder->buildEngineWithConfig(*network, *config), inferenceCommon::InferDeleter());
     if (!mEngine)
@@ -52,11 +77,27 @@ bool UltraFaceOnnxEngine::build()
         return false;
     }
 
-    assert(network->getNbInputs() == 1);
-    assert(mInputDims.nbDims == 4);
-    assert(network->getNbOutputs() == 4);
+    if (cache)
+    {
+        storeEngine(*cache, cacheKey);
+    }
+
+    return initializeEngine();
+}
+
+//!
+//! \brief Reads the input dims and the bindings of the built or deserialized engine
+//!
+bool UltraFaceOnnxEngine::initializeEngine()
+{
+    auto inputIndex = mEngine->getBindingIndex(mParams->inputTensorNames[0].c_str());
+    if (inputIndex < 0)
+    {
+        return false;
+    }
 
-    mParams->mInputDims = network->getInput(0)->getDimensions();
+    mParams->mInputDims = mEngine->getBindingDimensions(inputIndex);
+    assert(mParams->mInputDims.nbDims == 4);
     auto outputIndex = mEngine->getBindingIndex(mParams->outputTensorNames[0].c_str());
     auto scoresDims = mEngine->getBindingDimensions(outputIndex);
     mParams->mDetectionsCount = scoresDims.d[1];
@@ -78,10 +119,105 @@ bool UltraFaceOnnxEngine::build()
         );
     }
 
+    // The detections depend on the postprocessing too
+    std::ostringstream modelKey;
+    modelKey << getCacheKey(mParams->mInputDims)
+        << ";class=" << mParams->mDetectionClassIndex
+        << ";threshold=" << mParams->mDetectionThreshold;
+    mModelKey = modelKey.str();
+
     return true;
 }
 
-std::unique_ptr<InferenceContext> UltraFaceOnnxEngine::get_inference_context()
+const std::string& UltraFaceOnnxEngine::get_model_key() const
+{
+    return mModelKey;
+}
+
+//!
+//! \brief Describes everything the plan depends on, a plan is only valid on the same setup
+//!
+std::string UltraFaceOnnxEngine::getCacheKey(const nvinfer1::Dims& inputDims) const
+{
+    auto modelFile = locateFile(mParams->onnxFileName, mParams->dataDirs);
+    char modelHash[17];
+    snprintf(modelHash, sizeof(modelHash), "%016llx", static_cast<unsigned long long>(hashFile(modelFile)));
+
+    std::ostringstream key;
+    key << "model=" << modelHash
+        << ";fp16=" << mParams->fp16
+        << ";int8=" << mParams->int8
+        << ";dla=" << mParams->dlaCore
+        << ";input=";
+    for (auto i = 0; i < inputDims.nbDims; ++i)
+    {
+        key << (i ? "x" : "") << inputDims.d[i];
+    }
+    key << ";tensorrt=" << getInferLibVersion();
+
+    // Plans are specific to the GPU model as well
+    int device = 0;
+    int cudaVersion = 0;
+    cudaDeviceProp properties;
+    if ((cudaGetDevice(&device) == cudaSuccess) && (cudaGetDeviceProperties(&properties, device) == cudaSuccess))
+    {
+        key << ";device=" << properties.name << ";sm=" << properties.major << "." << properties.minor;
+    }
+    if (cudaRuntimeGetVersion(&cudaVersion) == cudaSuccess)
+    {
+        key << ";cuda=" << cudaVersion;
+    }
+
+    return key.str();
+}
+
+bool UltraFaceOnnxEngine::loadEngine(const PlanCache& cache, const std::string& key)
+{
+    auto name = boost::filesystem::path(mParams->onnxFileName).stem().string();
+    auto plan = cache.load(name, key);
+    if (!plan)
+    {
+        inference::gLogInfo << "No cached engine plan, building the engine." << std::endl;
+        return false;
+    }
+
+    if (!mRuntime)
+    {
+        mRuntime = InferenceUniquePtr<nvinfer1::IRuntime>(
+            nvinfer1::createInferRuntime(inference::gLogger.getTRTLogger()));
+    }
+
+    if (mRuntime)
+    {
+        mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
+            mRuntime->deserializeCudaEngine(plan->data(), plan->size(), nullptr), inferenceCommon::InferDeleter());
+    }
+    if (!mEngine)
+    {
+        inference::gLogWarning << "Failed to deserialize the cached engine plan, building the engine." << std::endl;
+        return false;
+    }
+
+    inference::gLogInfo << "Loaded the engine plan from the cache." << std::endl;
+    return true;
+}
+
+void UltraFaceOnnxEngine::storeEngine(const PlanCache& cache, const std::string& key)
+{
+    auto plan = InferenceUniquePtr<nvinfer1::IHostMemory>(mEngine->serialize());
+    if (!plan)
+    {
+        return;
+    }
+
+    auto name = boost::filesystem::path(mParams->onnxFileName).stem().string();
+    if (cache.store(name, key, plan->data(), plan->size()))
+    {
+        inference::gLogInfo << "Stored the engine plan in the cache." << std::endl;
+    }
+}
+
+std::unique_ptr<InferenceContext> UltraFaceOnnxEngine::create_inference_context()
 {
     {
         const std::lock_guard<std::mutex> lock(mMutex);
@@ -91,7 +227,7 @@ std::unique_ptr<InferenceContext> UltraFaceOnnxEngine::get_inference_context()
             throw logic_error("Failed to create execution context!");
         }
 
-        return std::unique_ptr<InferenceContext>(new InferenceContext(context, mBindings, mParams));
+        return std::unique_ptr<InferenceContext>(new TrtInferenceContext(context, mBindings, mParams));
     }
 }
 
@@ -0,0 +1,58 @@
+#include "logger.h"
+#include "inference/warmUp.h"
+#include "frames/jpeg_encoder.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+WarmUpReport warmUp(InferenceEngine& engine, const WarmUpParams& params)
+{
+    WarmUpReport report;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::unique_ptr<InferenceContext>> contexts;
+    for (auto i = 0; i < params.mContexts; ++i)
+    {
+        contexts.push_back(engine.get_inference_context());
+    }
+
+    std::vector<Detection> detections;
+    for (auto& context : contexts)
+    {
+        cv::Mat frame = cv::Mat::zeros(context->get_input_height(), context->get_input_width(), CV_8UC3);
+        for (auto batchSize : params.mBatchSizes)
+        {
+            std::vector<cv::Mat> batch(batchSize, frame);
+            for (auto i = 0; i < params.mIterations; ++i)
+            {
+                detections.clear();
+                if (!context->infer(batch, detections))
+                {
+                    ++report.mFailedInferences;
+                }
+            }
+        }
+    }
+
+    if (!contexts.empty())
+    {
+        // The codecs initialize on the first use, the encoder is the one of the streams
+        cv::Mat frame = cv::Mat::zeros(contexts[0]->get_input_height(), contexts[0]->get_input_width(), CV_8UC3);
+        std::vector<uchar> buffer;
+        jpeg_encoder_pool::encode(frame, jpeg_settings(), buffer);
+        cv::imdecode(buffer, cv::IMREAD_COLOR);
+    }
+
+    report.mContexts = contexts.size();
+    for (auto& context : contexts)
+    {
+        engine.add_prepared_context(std::move(context));
+    }
+
+    report.mDuration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    if (report.mFailedInferences)
+    {
+        inference::gLogWarning << report.mFailedInferences << " warm-up inferences failed" << std::endl;
+    }
+
+    return report;
+}
@@ -1,8 +1,16 @@
+#include "asyncLog.h"
 #include "logger.h"
 #include "inference/detection.h"
+#include "inference/inferenceConfig.h"
+#include "inference/modelRegistry.h"
 #include "inference/ultraFaceInferenceParams.h"
-#include "inference/ultraFaceOnnx.h"
+#include "frames/jpeg_encoder.h"
+#include "http/frame_processor.h"
+#include "http/jobs_api.h"
 #include "http/listener.h"
+#include "http/output_cache.h"
+#include "http/quality_policy.h"
+#include "http/readiness.h"
 
 #include "NvInfer.h"
 #include <cuda_runtime_api.h>
@@ -12,6 +20,7 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/config.hpp>
 #include <boost/program_options.hpp>
 #include <cmath>
@@ -32,6 +41,7 @@ namespace beast = boost::beast;         // from <boost/beast.hpp>
 namespace http = beast::http;           // from <boost/beast/http.hpp>
 namespace net = boost::asio;            // from <boost/asio.hpp>
 using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+using local = boost::asio::local::stream_protocol;
 
 namespace po = boost::program_options;
 
@@ -63,12 +73,56 @@ void write_response(
     http::write(stream, sr, ec);
 }
 
+session_type parse_session_type(const std::string& value)
+{
+    if (value == "coroutine")
+    {
+        return session_type::coroutine;
+    }
+    else if (value == "callback")
+    {
+        return session_type::callback;
+    }
+
+    throw std::invalid_argument("Unknown session type: " + value);
+}
+
+inference::Logger::Severity parse_log_level(const std::string& value)
+{
+    if (value == "verbose")
+    {
+        return inference::Logger::Severity::kVERBOSE;
+    }
+    else if (value == "info")
+    {
+        return inference::Logger::Severity::kINFO;
+    }
+    else if (value == "warning")
+    {
+        return inference::Logger::Severity::kWARNING;
+    }
+    else if (value == "error")
+    {
+        return inference::Logger::Severity::kERROR;
+    }
+
+    throw std::invalid_argument("Unknown log level: " + value);
+}
+
 void read_config(
     net::ip::address& address,
     unsigned short& port,
+    std::string& unix_socket,
     std::string& working_dir,
     int& threads,
-    std::shared_ptr<UltraFaceInferenceParams>& params)
+    session_type& sessions,
+    InferenceConfig& inference_config,
+    quality_params& quality,
+    jobs_params& jobs,
+    output_cache_params& output_cache,
+    std::string& detections_log_dir,
+    std::string& shm_publish_prefix,
+    jpeg_encoder_params& jpeg_encoder)
 {
     inference::gLogInfo << "Reading configuration." << std::endl;
 
@@ -79,6 +133,11 @@ void read_config(
         auto space_indx = line.find_first_of(separator);
         auto name = line.substr(0, space_indx);
         auto value = line.substr(space_indx + 1, line.size());
+        if (readInferenceConfig(name, value, inference_config))
+        {
+            continue;
+        }
+
         inference::gLogInfo << name << ": ";
         if(name == "ADDRESS")
         {
@@ -92,6 +151,12 @@ void read_config(
             inference::gLogInfo << port << std::endl;
             continue;
         }
+        else if(name == "UNIX_SOCKET")
+        {
+            unix_socket = std::move(value);
+            inference::gLogInfo << unix_socket << std::endl;
+            continue;
+        }
         else if(name == "WORKING_DIR")
         {
             working_dir = std::move(value);
@@ -104,81 +169,108 @@ void read_config(
             inference::gLogInfo << threads << std::endl;
             continue;
         }
-        else if(name == "DATA_DIR")
+        else if(name == "LOG_LEVEL")
         {
-            params->dataDirs.push_back(std::move(value));
-            inference::gLogInfo << params->dataDirs[0] << std::endl;
+            inference::setReportableSeverity(parse_log_level(value));
+            inference::gLogInfo << value << std::endl;
             continue;
         }
-        else if(name == "ONNX_FILE_NAME")
+        else if(name == "SESSION_TYPE")
         {
-            params->onnxFileName = std::move(value);
-            inference::gLogInfo << params->onnxFileName << std::endl;
+            sessions = parse_session_type(value);
+            inference::gLogInfo << value << std::endl;
             continue;
         }
-        else if(name == "INPUT_TENSORS")
+        else if(name == "QUALITY_LEVEL")
         {
-            params->inputTensorNames.push_back(std::move(value));
-            inference::gLogInfo << params->inputTensorNames[0] << std::endl;
+            // <model> <fps>, the levels go from the best one down
+            std::istringstream stream(value);
+            std::string model;
+            double fps = 0;
+            if (!(stream >> model >> fps) || (fps <= 0))
+            {
+                throw std::invalid_argument("Invalid quality level: " + value);
+            }
+            quality.m_levels.push_back({model, std::chrono::nanoseconds(static_cast<int64_t>(1e9 / fps))});
+            inference::gLogInfo << value << std::endl;
             continue;
         }
-        else if(name == "OUTPUT_TENSORS")
+        else if(name == "QUALITY_LATENCY_SLO_MS")
         {
-            string::size_type start = 0;
-            for(
-                auto stop = value.find_first_of(separator);
-                stop != string::npos;
-                stop = value.find_first_of(separator, start))
-            {
-                params->outputTensorNames.push_back(value.substr(start, stop - start));
-                start = stop + 1;
-                inference::gLogInfo << params->outputTensorNames.back() << " ";
-            }
-            params->outputTensorNames.push_back(value.substr(start, value.size() - start));
-            inference::gLogInfo << params->outputTensorNames.back() << std::endl;
+            quality.m_latency_slo_ms = stod(value);
+            inference::gLogInfo << quality.m_latency_slo_ms << std::endl;
             continue;
         }
-        else if(name == "PREPROCESSING_MEANS")
+        else if(name == "QUALITY_MAX_IN_FLIGHT")
         {
-            string::size_type start = 0;
-            auto channel = 0;
-            for(
-                auto stop = value.find_first_of(separator);
-                stop != string::npos;
-                stop = value.find_first_of(separator, start))
-            {
-                auto mean = stof(value.substr(start, stop - start));
-                params->mPreprocessingMeans[channel++] = mean;
-                start = stop + 1;
-                inference::gLogInfo << mean << " ";
-            }
-            auto mean = stof(value.substr(start, value.size() - start));
-            params->mPreprocessingMeans[channel] = mean;
-            inference::gLogInfo << mean << std::endl;
+            quality.m_max_in_flight = stoi(value);
+            inference::gLogInfo << quality.m_max_in_flight << std::endl;
+            continue;
+        }
+        else if(name == "JOBS_DIR")
+        {
+            jobs.m_results_dir = std::move(value);
+            inference::gLogInfo << jobs.m_results_dir << std::endl;
             continue;
         }
-        else if(name == "PREPROCESSING_NORM")
+        else if(name == "JOBS_MAX_RUNNING")
         {
-            params->mPreprocessingNorm = stof(value);
-            inference::gLogInfo << params->mPreprocessingNorm << std::endl;
+            jobs.m_max_running = stoi(value);
+            inference::gLogInfo << jobs.m_max_running << std::endl;
             continue;
         }
-        else if(name == "DETECTION_THRESHOLD")
+        else if(name == "JOBS_WORKERS")
         {
-            params->mDetectionThreshold = stof(value);
-            inference::gLogInfo << params->mDetectionThreshold << std::endl;
+            jobs.m_workers = stoi(value);
+            inference::gLogInfo << jobs.m_workers << std::endl;
             continue;
         }
-        else if(name == "NUM_CLASSES")
+        else if(name == "JOBS_MAX_QUEUED")
         {
-            params->mNumClasses = stoi(value);
-            inference::gLogInfo << params->mNumClasses << std::endl;
+            jobs.m_max_queued = stoi(value);
+            inference::gLogInfo << jobs.m_max_queued << std::endl;
             continue;
         }
-        else if(name == "DETECTION_CLASS")
+        else if(name == "JOBS_MAX_FINISHED")
         {
-            params->mDetectionClassIndex = stoi(value);
-            inference::gLogInfo << params->mDetectionClassIndex << std::endl;
+            jobs.m_max_finished = stoi(value);
+            inference::gLogInfo << jobs.m_max_finished << std::endl;
+            continue;
+        }
+        else if(name == "OUTPUT_CACHE_DIR")
+        {
+            output_cache.m_directory = std::move(value);
+            inference::gLogInfo << output_cache.m_directory << std::endl;
+            continue;
+        }
+        else if(name == "OUTPUT_CACHE_MAX_MB")
+        {
+            output_cache.m_max_bytes = static_cast<size_t>(stoul(value)) << 20;
+            inference::gLogInfo << value << std::endl;
+            continue;
+        }
+        else if(name == "DETECTIONS_LOG_DIR")
+        {
+            detections_log_dir = std::move(value);
+            inference::gLogInfo << detections_log_dir << std::endl;
+            continue;
+        }
+        else if(name == "SHM_PUBLISH_PREFIX")
+        {
+            shm_publish_prefix = std::move(value);
+            inference::gLogInfo << shm_publish_prefix << std::endl;
+            continue;
+        }
+        else if(name == "JPEG_ENCODER_THREADS")
+        {
+            jpeg_encoder.m_threads = stoi(value);
+            inference::gLogInfo << jpeg_encoder.m_threads << std::endl;
+            continue;
+        }
+        else if(name == "JPEG_PARALLEL_MIN_PIXELS")
+        {
+            jpeg_encoder.m_parallel_min_pixels = stoul(value);
+            inference::gLogInfo << jpeg_encoder.m_parallel_min_pixels << std::endl;
             continue;
         }
     }
@@ -189,8 +281,10 @@ void parseArgs(
     char** argv,
     net::ip::address& address,
     unsigned short& port,
+    std::string& unix_socket,
     std::string& working_dir,
     int& threads,
+    session_type& sessions,
     inferenceCommon::Args& args)
 {
     using namespace std;
@@ -203,12 +297,18 @@ void parseArgs(
         ("port,p",
          po::value<unsigned short>(),
          "Port number to accept connections.")
+        ("unix_socket,u",
+         po::value<string>(),
+         "Unix domain socket path to accept local connections.")
         ("working_dir,w",
          po::value<string>()->default_value(working_dir),
          "Working directory of the application.")
         ("threads,t",
          po::value<int>(),
          "Number of threads.")
+        ("session_type,s",
+         po::value<string>(),
+         "Session implementation: callback or coroutine.")
         ("dlaCores,d",
          po::value<int32_t>(),
          "Use DLA Cores.")
@@ -237,6 +337,12 @@ void parseArgs(
         inference::gLogInfo << "Port: " << port << std::endl;
     }
 
+    if (vm.count("unix_socket"))
+    {
+        unix_socket = vm["unix_socket"].as<string>();
+        inference::gLogInfo << "Unix socket: " << unix_socket << std::endl;
+    }
+
     if (vm.count("working_dir"))
     {
         working_dir = vm["working_dir"].as<string>();
@@ -249,6 +355,12 @@ void parseArgs(
         inference::gLogInfo << "Num threads: " << threads << std::endl;
     }
 
+    if (vm.count("session_type"))
+    {
+        sessions = parse_session_type(vm["session_type"].as<string>());
+        inference::gLogInfo << "Session type: " << vm["session_type"].as<string>() << std::endl;
+    }
+
     if (vm.count("threads"))
     {
         args.useDLACore = vm["dlaCores"].as<int32_t>();
@@ -263,30 +375,37 @@ int main(int argc, char** argv)
 {
     net::ip::address address;
     unsigned short port;
+    std::string unix_socket;
     std::string working_dir;
     int threads;
-    std::shared_ptr<UltraFaceInferenceParams> inferenceParams;
+    session_type sessions = session_type::callback;
+    InferenceConfig inferenceConfig;
+    quality_params quality;
+    jobs_params jobs;
+    output_cache_params outputCache;
+    std::string detectionsLogDir;
+    std::string shmPublishPrefix = "ultraface_";
+    jpeg_encoder_params jpegEncoder;
     inferenceCommon::Args args;
 
     try
     {
         auto inferenceTest = inference::gLogger.defineTest(gInferenceName, 0, {});
         inference::gLogger.reportTestStart(inferenceTest);
-        inferenceParams = std::make_shared<UltraFaceInferenceParams>();
-
-        read_config(address, port, working_dir, threads, inferenceParams);
+        read_config(
+            address, port, unix_socket, working_dir, threads, sessions, inferenceConfig, quality, jobs, outputCache,
+            detectionsLogDir, shmPublishPrefix, jpegEncoder);
      
         if (argc > 1)
         {
-            parseArgs(argc, argv, address, port, working_dir, threads, args);
-            fillInferenceParams(inferenceParams, args);
+            parseArgs(argc, argv, address, port, unix_socket, working_dir, threads, sessions, args);
+            fillInferenceParams(inferenceConfig.mParams, args);
         }
 
-        UltraFaceOnnxEngine inferenceEngine(inferenceParams);
-
-        inference::gLogInfo << "Building and running a GPU inference engine for ultraFace Onnx" << std::endl;
-
-        if (!inferenceEngine.build())
+        // Builds and warms up every model, the listeners start after it, so no session waits on it
+        ModelRegistry modelRegistry(inferenceConfig);
+        WarmUpReport warmUpReport;
+        if (!modelRegistry.build(warmUpReport))
         {
             inference::gLogger.reportFail(inferenceTest);
             return EXIT_FAILURE;
@@ -294,6 +413,23 @@ int main(int argc, char** argv)
 
         inference::gLogInfo << "The GPU inference engine is build." << std::endl;
 
+        for (const auto& level : quality.m_levels)
+        {
+            if (!modelRegistry.get_engine(level.m_model))
+            {
+                throw std::invalid_argument("Unknown model of the quality level: " + level.m_model);
+            }
+        }
+        quality_policy::configure(quality);
+        output_cache::configure(outputCache);
+        frame_processor::set_detections_log_directory(detectionsLogDir);
+        frame_processor::set_publish_prefix(shmPublishPrefix);
+        jpeg_encoder_pool::configure(jpegEncoder);
+
+        jobs.m_base_dir = working_dir;
+        start_jobs(jobs);
+        set_ready(warmUpReport.mDuration, warmUpReport.mContexts);
+
             // The io_context is required for all I/O
         net::io_context ioc{threads};
 
@@ -302,7 +438,19 @@ int main(int argc, char** argv)
             ioc,
             tcp::endpoint{address, port},
             working_dir,
-            inferenceEngine)->run();
+            modelRegistry,
+            sessions)->run();
+
+        if (!unix_socket.empty())
+        {
+            // Co-located clients can skip the TCP stack
+            std::make_shared<listener>(
+                ioc,
+                local::endpoint{unix_socket},
+                working_dir,
+                modelRegistry,
+                sessions)->run();
+        }
 
         // Run the I/O service on the requested number of threads
         std::vector<std::thread> v;
@@ -315,10 +463,16 @@ int main(int argc, char** argv)
             });
         ioc.run();
 
+        stop_jobs();
+        jpeg_encoder_pool::stop();
+        inference::asyncLog::flush();
         return EXIT_SUCCESS;
     }
     catch (const std::exception& e)
     {
+        // A listener may fail after the jobs started
+        stop_jobs();
+        inference::asyncLog::flush();
         std::cerr << "Error: " << e.what() << std::endl;
         return EXIT_FAILURE;
     }
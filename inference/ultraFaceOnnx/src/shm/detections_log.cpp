@@ -0,0 +1,292 @@
+#include "shm/detections_log.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace
+{
+
+size_t get_record_size(uint32_t max_boxes)
+{
+    return sizeof(detections_log_record) + max_boxes * sizeof(detections_record_box);
+}
+
+void write_all(int fd, const void* data, size_t size, const std::string& path)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    while (size > 0)
+    {
+        auto written = write(fd, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Failed to write the detections log: " + path);
+        }
+        bytes += written;
+        size -= written;
+    }
+}
+
+// Maps the whole file, an empty or missing one maps to nothing
+const unsigned char* map_file(const std::string& path, size_t& size)
+{
+    size = 0;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if ((fstat(fd, &status) == 0) && (status.st_size > 0))
+    {
+        mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    size = status.st_size;
+    return static_cast<const unsigned char*>(mapping);
+}
+
+} // anonymous namespace
+
+std::string get_detections_log_path(
+    const std::string& directory,
+    const std::vector<std::string>& source_path,
+    const std::string& extention)
+{
+    // Every character but the letters, the digits and '-' is escaped as '_' and its hex code,
+    // the separating '.' among them, so two sources never share a log
+    std::string name;
+    auto append = [&name](const std::string& part)
+    {
+        const char digits[] = "0123456789abcdef";
+        for (auto c : part)
+        {
+            auto byte = static_cast<unsigned char>(c);
+            if (std::isalnum(byte) || (c == '-'))
+            {
+                name += c;
+            }
+            else
+            {
+                name += '_';
+                name += digits[byte >> 4];
+                name += digits[byte & 0xF];
+            }
+        }
+        name += '.';
+    };
+    for (const auto& part : source_path)
+    {
+        append(part);
+    }
+    append(extention);
+
+    return (boost::filesystem::path(directory) / (name + "dlog")).string();
+}
+
+detections_log_writer::detections_log_writer(const std::string& path, uint32_t max_boxes)
+    :m_path(path),
+    m_max_boxes(max_boxes),
+    m_record(get_record_size(max_boxes))
+{
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path(), ec);
+
+    // Written aside and renamed at the end, a replay keeps reading the log it mapped.
+    // Every writer has files of its own, the last stream committed makes the log.
+    std::vector<char> temp_path(m_path.begin(), m_path.end());
+    const char suffix[] = ".XXXXXX";
+    temp_path.insert(temp_path.end(), suffix, suffix + sizeof(suffix));
+    m_fd = mkstemp(temp_path.data());
+    if (m_fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "Cannot create the detections log: " + path);
+    }
+    m_temp_path = temp_path.data();
+
+    m_index_fd = open((m_temp_path + ".idx").c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if ((m_index_fd < 0) || (fchmod(m_fd, 0644) != 0))
+    {
+        auto error = errno;
+        if (m_index_fd >= 0)
+        {
+            close(m_index_fd);
+            unlink((m_temp_path + ".idx").c_str());
+        }
+        close(m_fd);
+        unlink(m_temp_path.c_str());
+        throw std::system_error(error, std::generic_category(), "Cannot create the detections log: " + m_temp_path);
+    }
+
+    detections_log_header header{};
+    header.m_magic = DETECTIONS_LOG_MAGIC;
+    header.m_version = DETECTIONS_LOG_VERSION;
+    header.m_max_boxes = max_boxes;
+    header.m_record_size = m_record.size();
+    write_all(m_fd, &header, sizeof(header), m_path);
+}
+
+detections_log_writer::~detections_log_writer()
+{
+    // A partial recording never replaces the log
+    if (!m_committed)
+    {
+        unlink((m_temp_path + ".idx").c_str());
+        unlink(m_temp_path.c_str());
+    }
+    close(m_index_fd);
+    close(m_fd);
+}
+
+void detections_log_writer::commit()
+{
+    if (m_committed)
+    {
+        return;
+    }
+
+    // The index goes first, a seek copes with an index newer than its log
+    rename((m_temp_path + ".idx").c_str(), (m_path + ".idx").c_str());
+    rename(m_temp_path.c_str(), m_path.c_str());
+    m_committed = true;
+}
+
+void detections_log_writer::append(uint64_t frame_index, const std::vector<Detection>& detections)
+{
+    auto timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Detections come out of nms sorted by score
+    std::fill(m_record.begin(), m_record.end(), 0);
+    auto& record = *reinterpret_cast<detections_log_record*>(m_record.data());
+    record.m_frame_index = frame_index;
+    record.m_timestamp_ns = timestamp_ns;
+    record.m_box_count = std::min<size_t>(detections.size(), m_max_boxes);
+
+    auto boxes = reinterpret_cast<detections_record_box*>(m_record.data() + sizeof(detections_log_record));
+    for (uint32_t i = 0; i < record.m_box_count; ++i)
+    {
+        boxes[i].m_score = detections[i].mScore;
+        std::copy(detections[i].mBox.cbegin(), detections[i].mBox.cend(), boxes[i].m_box);
+        boxes[i].m_track_id = detections[i].mTrackId;
+    }
+    write_all(m_fd, m_record.data(), m_record.size(), m_path);
+
+    // The index entry follows its record, so it never points past the log
+    if (m_record_count % DETECTIONS_LOG_INDEX_INTERVAL == 0)
+    {
+        detections_log_index_entry entry{frame_index, timestamp_ns};
+        write_all(m_index_fd, &entry, sizeof(entry), m_path);
+    }
+    ++m_record_count;
+}
+
+detections_log_reader::detections_log_reader(const std::string& path)
+{
+    m_log = map_file(path, m_log_size);
+    if (!m_log)
+    {
+        throw std::system_error(ENOENT, std::generic_category(), "No detections log: " + path);
+    }
+
+    const auto& header = *reinterpret_cast<const detections_log_header*>(m_log);
+    if ((m_log_size < sizeof(detections_log_header))
+        || (header.m_magic != DETECTIONS_LOG_MAGIC)
+        || (header.m_version != DETECTIONS_LOG_VERSION)
+        || (header.m_record_size != get_record_size(header.m_max_boxes)))
+    {
+        munmap(const_cast<unsigned char*>(m_log), m_log_size);
+        throw std::system_error(EINVAL, std::generic_category(), "Not a detections log: " + path);
+    }
+    m_record_size = header.m_record_size;
+    m_record_count = (m_log_size - sizeof(detections_log_header)) / m_record_size;
+
+    // Without the index a seek scans from the start
+    size_t index_bytes = 0;
+    m_index = reinterpret_cast<const detections_log_index_entry*>(map_file(path + ".idx", index_bytes));
+    if (m_index)
+    {
+        m_index_size = std::min<uint64_t>(index_bytes / sizeof(detections_log_index_entry),
+            (m_record_count + DETECTIONS_LOG_INDEX_INTERVAL - 1) / DETECTIONS_LOG_INDEX_INTERVAL);
+        m_index_bytes = index_bytes;
+    }
+}
+
+detections_log_reader::~detections_log_reader()
+{
+    if (m_index)
+    {
+        munmap(const_cast<detections_log_index_entry*>(m_index), m_index_bytes);
+    }
+    munmap(const_cast<unsigned char*>(m_log), m_log_size);
+}
+
+uint64_t detections_log_reader::get_record_count() const
+{
+    return m_record_count;
+}
+
+const detections_log_record& detections_log_reader::record(uint64_t record_number) const
+{
+    return *reinterpret_cast<const detections_log_record*>(
+        m_log + sizeof(detections_log_header) + record_number * m_record_size);
+}
+
+uint64_t detections_log_reader::seek(uint64_t frame_index) const
+{
+    // The last indexed record not after the frame, then at most an interval of records
+    auto entry = std::upper_bound(m_index, m_index + m_index_size, frame_index,
+        [](uint64_t index, const detections_log_index_entry& e)
+        {
+            return index < e.m_frame_index;
+        });
+    uint64_t record_number = (entry == m_index) ? 0 : (entry - m_index - 1) * DETECTIONS_LOG_INDEX_INTERVAL;
+    if ((record_number < m_record_count) && (record(record_number).m_frame_index > frame_index))
+    {
+        record_number = 0;
+    }
+
+    while ((record_number < m_record_count) && (record(record_number).m_frame_index < frame_index))
+    {
+        ++record_number;
+    }
+    return record_number;
+}
+
+void detections_log_reader::read_detections(uint64_t record_number, std::vector<Detection>& detections) const
+{
+    const auto& header = *reinterpret_cast<const detections_log_header*>(m_log);
+    const auto& log_record = record(record_number);
+    auto boxes = reinterpret_cast<const detections_record_box*>(
+        reinterpret_cast<const unsigned char*>(&log_record) + sizeof(detections_log_record));
+
+    detections.clear();
+    auto box_count = std::min(log_record.m_box_count, header.m_max_boxes);
+    for (uint32_t i = 0; i < box_count; ++i)
+    {
+        std::array<float, Detection::mNumCorners> box;
+        std::copy(boxes[i].m_box, boxes[i].m_box + Detection::mNumCorners, box.begin());
+        detections.emplace_back(boxes[i].m_score, std::move(box));
+        detections.back().mTrackId = boxes[i].m_track_id;
+    }
+}
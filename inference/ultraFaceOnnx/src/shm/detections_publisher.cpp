@@ -0,0 +1,59 @@
+#include "shm/detections_publisher.h"
+
+#include <algorithm>
+#include <chrono>
+
+detections_publisher::~detections_publisher()
+{
+    m_ring.unlink();
+}
+
+void detections_publisher::publish(
+    uint64_t frame_index,
+    int frame_width,
+    int frame_height,
+    const std::vector<Detection>& detections)
+{
+    auto& header = m_ring.header();
+    auto sequence = header.m_head.load(std::memory_order_relaxed);
+    auto& record = m_ring.record_header(sequence);
+
+    record.m_lock.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Detections come out of nms sorted by score
+    auto box_count = std::min<size_t>(detections.size(), m_ring.get_max_boxes());
+    auto boxes = m_ring.record_boxes(sequence);
+    for (size_t i = 0; i < box_count; ++i)
+    {
+        boxes[i].m_score = detections[i].mScore;
+        std::copy(detections[i].mBox.cbegin(), detections[i].mBox.cend(), boxes[i].m_box);
+        boxes[i].m_track_id = detections[i].mTrackId;
+    }
+
+    // All the boxes of a frame come out of the same stage, with the same count of attributes
+    size_t attribute_count = 0;
+    if ((box_count > 0) && (m_ring.get_max_attributes() > 0))
+    {
+        attribute_count = std::min<size_t>(detections[0].mAttributes.size(), m_ring.get_max_attributes());
+        auto attributes = m_ring.record_attributes(sequence);
+        for (size_t i = 0; i < box_count; ++i)
+        {
+            const auto& values = detections[i].mAttributes;
+            std::copy_n(values.cbegin(), std::min(values.size(), attribute_count),
+                attributes + i * m_ring.get_max_attributes());
+        }
+    }
+
+    record.m_sequence = sequence;
+    record.m_timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    record.m_frame_index = frame_index;
+    record.m_frame_width = frame_width;
+    record.m_frame_height = frame_height;
+    record.m_box_count = box_count;
+    record.m_attribute_count = attribute_count;
+
+    record.m_lock.store(2 * sequence + 2, std::memory_order_release);
+    header.m_head.store(sequence + 1, std::memory_order_release);
+}
@@ -0,0 +1,134 @@
+#include "shm/detections_ring.h"
+
+#include <cerrno>
+#include <new>
+#include <system_error>
+
+detections_ring detections_ring::create(
+    const std::string& name,
+    uint32_t record_count,
+    uint32_t max_boxes,
+    uint32_t max_attributes)
+{
+    if (record_count == 0)
+    {
+        throw std::system_error(EINVAL, std::generic_category(), "A detections ring needs records: " + name);
+    }
+
+    auto record_size = get_record_size(max_boxes, max_attributes);
+    auto segment = shm_segment::create(name, sizeof(detections_ring_header) + static_cast<size_t>(record_count) * record_size);
+
+    auto header = new (segment.data()) detections_ring_header();
+    header->m_record_count = record_count;
+    header->m_max_boxes = max_boxes;
+    header->m_record_size = record_size;
+    header->m_max_attributes = max_attributes;
+    header->m_head.store(0, std::memory_order_relaxed);
+    header->m_version = DETECTIONS_RING_VERSION;
+
+    detections_ring ring(std::move(segment), record_count, max_boxes, max_attributes);
+    for (uint64_t i = 0; i < record_count; ++i)
+    {
+        new (&ring.record_header(i)) detections_record_header();
+        ring.record_header(i).m_lock.store(0, std::memory_order_relaxed);
+    }
+
+    // Readers check the magic before anything else
+    std::atomic_thread_fence(std::memory_order_release);
+    header->m_magic = DETECTIONS_RING_MAGIC;
+
+    return ring;
+}
+
+detections_ring detections_ring::open(const std::string& name)
+{
+    auto segment = shm_segment::open(name);
+    if (segment.size() < sizeof(detections_ring_header))
+    {
+        throw std::system_error(EINVAL, std::generic_category(), "Not a detections ring: " + name);
+    }
+
+    const auto header = reinterpret_cast<const detections_ring_header*>(segment.data());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto record_count = header->m_record_count;
+    auto max_boxes = header->m_max_boxes;
+    auto max_attributes = header->m_max_attributes;
+    size_t record_size = header->m_record_size;
+
+    // Bounded by the segment first, so the sizes computed from them cannot overflow
+    auto available = segment.size() - sizeof(detections_ring_header);
+    if ((header->m_magic != DETECTIONS_RING_MAGIC)
+        || (header->m_version != DETECTIONS_RING_VERSION)
+        || (record_count == 0)
+        || (max_boxes > available / sizeof(detections_record_box))
+        || ((max_boxes > 0) && (max_attributes > available / sizeof(float) / max_boxes))
+        || (record_size != get_record_size(max_boxes, max_attributes))
+        || (record_count > available / record_size))
+    {
+        throw std::system_error(EINVAL, std::generic_category(), "Not a detections ring: " + name);
+    }
+
+    return detections_ring(std::move(segment), record_count, max_boxes, max_attributes);
+}
+
+detections_ring::detections_ring(
+    shm_segment&& segment,
+    uint32_t record_count,
+    uint32_t max_boxes,
+    uint32_t max_attributes)
+    :m_segment(std::move(segment)),
+    m_record_count(record_count),
+    m_max_boxes(max_boxes),
+    m_max_attributes(max_attributes),
+    m_record_size(get_record_size(max_boxes, max_attributes))
+{
+}
+
+detections_ring_header& detections_ring::header() const
+{
+    return *reinterpret_cast<detections_ring_header*>(m_segment.data());
+}
+
+detections_record_header& detections_ring::record_header(uint64_t sequence) const
+{
+    auto offset = sizeof(detections_ring_header) + (sequence % m_record_count) * m_record_size;
+    return *reinterpret_cast<detections_record_header*>(m_segment.data() + offset);
+}
+
+detections_record_box* detections_ring::record_boxes(uint64_t sequence) const
+{
+    return reinterpret_cast<detections_record_box*>(
+        reinterpret_cast<unsigned char*>(&record_header(sequence)) + sizeof(detections_record_header));
+}
+
+float* detections_ring::record_attributes(uint64_t sequence) const
+{
+    return reinterpret_cast<float*>(record_boxes(sequence) + m_max_boxes);
+}
+
+uint32_t detections_ring::get_record_count() const
+{
+    return m_record_count;
+}
+
+uint32_t detections_ring::get_max_boxes() const
+{
+    return m_max_boxes;
+}
+
+uint32_t detections_ring::get_max_attributes() const
+{
+    return m_max_attributes;
+}
+
+void detections_ring::unlink()
+{
+    m_segment.unlink();
+}
+
+size_t detections_ring::get_record_size(uint32_t max_boxes, uint32_t max_attributes)
+{
+    auto size = sizeof(detections_record_header) + max_boxes * sizeof(detections_record_box)
+        + static_cast<size_t>(max_boxes) * max_attributes * sizeof(float);
+    return (size + DETECTIONS_RING_ALIGNMENT - 1) / DETECTIONS_RING_ALIGNMENT * DETECTIONS_RING_ALIGNMENT;
+}
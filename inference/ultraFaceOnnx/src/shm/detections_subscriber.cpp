@@ -0,0 +1,79 @@
+#include "shm/detections_subscriber.h"
+
+bool detections_subscriber::poll(detections_frame& frame)
+{
+    const auto& header = m_ring.header();
+    auto head = header.m_head.load(std::memory_order_acquire);
+    while (m_next_sequence < head)
+    {
+        // Keep a margin of one record the writer may be busy with
+        auto oldest = head > m_ring.get_record_count() ? head - m_ring.get_record_count() + 1 : 0;
+        if (m_next_sequence < oldest)
+        {
+            m_lost_count += oldest - m_next_sequence;
+            m_next_sequence = oldest;
+        }
+
+        if (read_record(m_next_sequence, frame))
+        {
+            ++m_next_sequence;
+            return true;
+        }
+
+        // Overwritten while copying, retry from the new head
+        head = header.m_head.load(std::memory_order_acquire);
+    }
+
+    return false;
+}
+
+bool detections_subscriber::poll_latest(detections_frame& frame)
+{
+    auto head = m_ring.header().m_head.load(std::memory_order_acquire);
+    if (head > m_next_sequence + 1)
+    {
+        m_lost_count += head - m_next_sequence - 1;
+        m_next_sequence = head - 1;
+    }
+
+    return poll(frame);
+}
+
+uint64_t detections_subscriber::get_lost_count() const
+{
+    return m_lost_count;
+}
+
+bool detections_subscriber::read_record(uint64_t sequence, detections_frame& frame)
+{
+    const auto& record = m_ring.record_header(sequence);
+    const auto expected_lock = 2 * sequence + 2;
+    if (record.m_lock.load(std::memory_order_acquire) != expected_lock)
+    {
+        return false;
+    }
+
+    frame.m_sequence = record.m_sequence;
+    frame.m_timestamp_ns = record.m_timestamp_ns;
+    frame.m_frame_index = record.m_frame_index;
+    frame.m_frame_width = record.m_frame_width;
+    frame.m_frame_height = record.m_frame_height;
+
+    auto box_count = std::min(record.m_box_count, m_ring.get_max_boxes());
+    auto attribute_count = std::min(record.m_attribute_count, m_ring.get_max_attributes());
+    const auto boxes = m_ring.record_boxes(sequence);
+    const auto attributes = m_ring.record_attributes(sequence);
+    frame.m_detections.clear();
+    for (uint32_t i = 0; i < box_count; ++i)
+    {
+        std::array<float, Detection::mNumCorners> box;
+        std::copy(boxes[i].m_box, boxes[i].m_box + Detection::mNumCorners, box.begin());
+        frame.m_detections.emplace_back(boxes[i].m_score, std::move(box));
+        frame.m_detections.back().mTrackId = boxes[i].m_track_id;
+        const auto values = attributes + i * m_ring.get_max_attributes();
+        frame.m_detections.back().mAttributes.assign(values, values + attribute_count);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return record.m_lock.load(std::memory_order_relaxed) == expected_lock;
+}
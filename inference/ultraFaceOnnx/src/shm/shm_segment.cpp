@@ -0,0 +1,118 @@
+#include "shm/shm_segment.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace
+{
+
+std::string get_segment_name(const std::string& name)
+{
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+}
+
+shm_segment shm_segment::create(const std::string& name, size_t size)
+{
+    auto segment_name = get_segment_name(name);
+    int fd = shm_open(segment_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    if (fd == -1)
+    {
+        throw std::system_error(errno, std::generic_category(), "shm_open " + segment_name);
+    }
+
+    if (ftruncate(fd, size) == -1)
+    {
+        auto error = errno;
+        close(fd);
+        shm_unlink(segment_name.c_str());
+        throw std::system_error(error, std::generic_category(), "ftruncate " + segment_name);
+    }
+
+    return shm_segment(segment_name, fd, size, true);
+}
+
+shm_segment shm_segment::open(const std::string& name)
+{
+    auto segment_name = get_segment_name(name);
+    int fd = shm_open(segment_name.c_str(), O_RDWR, 0);
+    if (fd == -1)
+    {
+        throw std::system_error(errno, std::generic_category(), "shm_open " + segment_name);
+    }
+
+    struct stat segment_stat;
+    if (fstat(fd, &segment_stat) == -1)
+    {
+        auto error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat " + segment_name);
+    }
+
+    return shm_segment(segment_name, fd, segment_stat.st_size, false);
+}
+
+shm_segment::shm_segment(const std::string& name, int fd, size_t size, bool created)
+    :m_name(name),
+    m_address(nullptr),
+    m_size(size),
+    m_created(created)
+{
+    auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto error = errno;
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        if (m_created)
+        {
+            shm_unlink(m_name.c_str());
+        }
+        throw std::system_error(error, std::generic_category(), "mmap " + m_name);
+    }
+
+    m_address = static_cast<unsigned char*>(address);
+}
+
+shm_segment::shm_segment(shm_segment&& other)
+    :m_name(std::move(other.m_name)),
+    m_address(other.m_address),
+    m_size(other.m_size),
+    m_created(other.m_created)
+{
+    other.m_address = nullptr;
+    other.m_size = 0;
+    other.m_created = false;
+}
+
+shm_segment::~shm_segment()
+{
+    if (m_address)
+    {
+        munmap(m_address, m_size);
+    }
+}
+
+unsigned char* shm_segment::data() const
+{
+    return m_address;
+}
+
+size_t shm_segment::size() const
+{
+    return m_size;
+}
+
+void shm_segment::unlink()
+{
+    // Never the segment of another process that happens to have the name
+    if (m_created)
+    {
+        shm_unlink(m_name.c_str());
+        m_created = false;
+    }
+}
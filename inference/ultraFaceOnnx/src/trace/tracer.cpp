@@ -0,0 +1,180 @@
+#include "trace/tracer.h"
+
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+std::atomic<bool> tracer::s_enabled{false};
+thread_local uint64_t tracer::s_current_trace_id = 0;
+
+namespace
+{
+
+const size_t TRACE_BUFFER_CAPACITY = 1 << 15;
+
+struct trace_event
+{
+    const char* m_name;
+    uint64_t m_trace_id;
+    int64_t m_start_us;
+    int64_t m_end_us;
+};
+
+// Written only by its thread. The collector reads the events published
+// by m_count, and only after the capture is disabled.
+struct thread_buffer
+{
+    explicit thread_buffer(uint32_t thread_index)
+        :m_events(new trace_event[TRACE_BUFFER_CAPACITY]),
+        m_thread_index(thread_index)
+    {
+    }
+
+    std::unique_ptr<trace_event[]> m_events;
+    std::atomic<size_t> m_count{0};
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<uint64_t> m_dropped{0};
+    uint32_t m_thread_index;
+    bool m_in_use = true;   // guarded by the buffers mutex
+};
+
+std::mutex g_buffers_mutex;
+std::vector<std::unique_ptr<thread_buffer>> g_buffers;
+std::atomic<uint64_t> g_generation{0};
+std::atomic<bool> g_capturing{false};
+std::atomic<uint32_t> g_session_count{0};
+int64_t g_capture_start_us = 0;
+
+// The buffers of the threads that ended go to the next new threads, so short-lived threads cost no memory
+thread_buffer& register_thread()
+{
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+    for (auto& buffer : g_buffers)
+    {
+        if (!buffer->m_in_use)
+        {
+            buffer->m_in_use = true;
+            return *buffer;
+        }
+    }
+
+    g_buffers.emplace_back(new thread_buffer(g_buffers.size()));
+    return *g_buffers.back();
+}
+
+// Gives the buffer back when its thread ends, its spans stay for the capture
+struct thread_buffer_owner
+{
+    thread_buffer_owner()
+        :m_buffer(register_thread())
+    {
+    }
+
+    ~thread_buffer_owner()
+    {
+        std::lock_guard<std::mutex> lock(g_buffers_mutex);
+        m_buffer.m_in_use = false;
+    }
+
+    thread_buffer& m_buffer;
+};
+
+thread_buffer& get_thread_buffer()
+{
+    thread_local thread_buffer_owner owner;
+    return owner.m_buffer;
+}
+
+} // anonymous namespace
+
+uint32_t tracer::next_session_id()
+{
+    return ++g_session_count;
+}
+
+void tracer::record(const char* name, uint64_t trace_id, int64_t start_us, int64_t end_us)
+{
+    auto& buffer = get_thread_buffer();
+
+    // The first span of a capture drops the previous capture's spans
+    auto generation = g_generation.load(std::memory_order_acquire);
+    if (buffer.m_generation.load(std::memory_order_relaxed) != generation)
+    {
+        buffer.m_count.store(0, std::memory_order_relaxed);
+        buffer.m_dropped.store(0, std::memory_order_relaxed);
+        buffer.m_generation.store(generation, std::memory_order_release);
+    }
+
+    auto count = buffer.m_count.load(std::memory_order_relaxed);
+    if (count >= TRACE_BUFFER_CAPACITY)
+    {
+        buffer.m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer.m_events[count] = trace_event{name, trace_id, start_us, end_us};
+    buffer.m_count.store(count + 1, std::memory_order_release);
+}
+
+bool tracer::start_capture()
+{
+    bool capturing = false;
+    if (!g_capturing.compare_exchange_strong(capturing, true))
+    {
+        return false;
+    }
+
+    g_capture_start_us = now_us();
+    g_generation.fetch_add(1, std::memory_order_release);
+    s_enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+std::string tracer::stop_capture()
+{
+    s_enabled.store(false, std::memory_order_relaxed);
+    auto generation = g_generation.load(std::memory_order_acquire);
+    auto pid = getpid();
+
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_buffers_mutex);
+        for (const auto& buffer : g_buffers)
+        {
+            if (buffer->m_generation.load(std::memory_order_acquire) != generation)
+            {
+                continue;
+            }
+
+            json << (first ? "" : ",")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                << ",\"tid\":" << buffer->m_thread_index
+                << ",\"args\":{\"name\":\"thread " << buffer->m_thread_index << "\"}}";
+            first = false;
+
+            auto count = buffer->m_count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto& event = buffer->m_events[i];
+                json << ",{\"name\":\"" << event.m_name
+                    << "\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":" << event.m_start_us - g_capture_start_us
+                    << ",\"dur\":" << event.m_end_us - event.m_start_us
+                    << ",\"pid\":" << pid
+                    << ",\"tid\":" << buffer->m_thread_index
+                    << ",\"args\":{\"trace_id\":" << event.m_trace_id
+                    << ",\"session\":" << (event.m_trace_id >> 32)
+                    << ",\"frame\":" << (event.m_trace_id & 0xffffffff) << "}}";
+            }
+            dropped += buffer->m_dropped.load(std::memory_order_relaxed);
+        }
+    }
+    json << "],\"otherData\":{\"dropped_spans\":" << dropped << "}}";
+
+    g_capturing.store(false);
+    return json.str();
+}
@@ -0,0 +1,644 @@
+#include <boost/asio/connect.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace po = boost::program_options;
+using stream_protocol = boost::asio::generic::stream_protocol;
+using tcp = boost::asio::ip::tcp;
+using local = boost::asio::local::stream_protocol;
+using clock_type = std::chrono::steady_clock;
+
+// Opens concurrent M-JPEG streams against the server and measures what the
+// clients see: time to first frame, frames inter-arrival, delivered fps and
+// bytes per second. The request mix is either N copies of one target or
+// replayed from a JSONL file, one stream per line:
+//
+//   {"target": "/filesystem/images?ext=jpg", "start_ms": 0, "frames": 100, "repeat": 4}
+//
+// Only target is required. start_ms delays the stream from the start of the run,
+// frames limits the number of frames read (0 reads until the end of the stream)
+// and repeat opens that many identical streams.
+
+struct stream_spec
+{
+    std::string m_target;
+    std::chrono::milliseconds m_start;
+    long m_max_frames;
+};
+
+struct stream_result
+{
+    std::string m_target;
+    bool m_connected = false;
+    bool m_completed = false;
+    std::string m_error;
+    double m_time_to_first_frame_ms = -1.0;
+    double m_duration_s = 0.0;
+    long m_frames = 0;
+    uint64_t m_bytes = 0;
+    std::vector<double> m_inter_arrival_ms;
+};
+
+class stream_client : public std::enable_shared_from_this<stream_client>
+{
+public:
+    stream_client(
+        boost::asio::io_context& ioc,
+        const stream_protocol::endpoint& endpoint,
+        const std::string& host,
+        const stream_spec& spec,
+        clock_type::time_point run_start,
+        clock_type::time_point deadline,
+        std::atomic<size_t>& remaining,
+        stream_result& result)
+        :m_ioc(ioc),
+        m_socket(ioc),
+        m_timer(ioc),
+        m_endpoint(endpoint),
+        m_spec(spec),
+        m_run_start(run_start),
+        m_deadline(deadline),
+        m_remaining(remaining),
+        m_result(result)
+    {
+        m_result.m_target = spec.m_target;
+        m_req.version(11);
+        m_req.method(http::verb::get);
+        m_req.target(spec.m_target);
+        m_req.set(http::field::host, host);
+        m_req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    }
+
+    void run()
+    {
+        m_timer.expires_at(m_run_start + m_spec.m_start);
+        m_timer.async_wait(std::bind(
+            &stream_client::on_start,
+            shared_from_this(),
+            std::placeholders::_1));
+    }
+
+private:
+    void on_start(boost::system::error_code ec)
+    {
+        if (ec)
+        {
+            return finish(ec, "timer");
+        }
+
+        m_request_start = clock_type::now();
+        m_socket.async_connect(m_endpoint, std::bind(
+            &stream_client::on_connect,
+            shared_from_this(),
+            std::placeholders::_1));
+    }
+
+    void on_connect(boost::system::error_code ec)
+    {
+        if (ec)
+        {
+            return finish(ec, "connect");
+        }
+
+        m_result.m_connected = true;
+        http::async_write(m_socket, m_req, std::bind(
+            &stream_client::on_write,
+            shared_from_this(),
+            std::placeholders::_1,
+            std::placeholders::_2));
+    }
+
+    void on_write(boost::system::error_code ec, std::size_t bytes_transferred)
+    {
+        boost::ignore_unused(bytes_transferred);
+
+        if (ec)
+        {
+            return finish(ec, "write");
+        }
+
+        // The stream header has no content length, only its header is read
+        m_header_parser.emplace();
+        http::async_read_header(m_socket, m_buffer, *m_header_parser, std::bind(
+            &stream_client::on_stream_header,
+            shared_from_this(),
+            std::placeholders::_1,
+            std::placeholders::_2));
+    }
+
+    void on_stream_header(boost::system::error_code ec, std::size_t bytes_transferred)
+    {
+        if (ec)
+        {
+            return finish(ec, "read header");
+        }
+
+        m_result.m_bytes += bytes_transferred;
+        if (m_header_parser->get().result() != http::status::ok)
+        {
+            return finish({}, "unexpected status");
+        }
+
+        do_read_frame();
+    }
+
+    void do_read_frame()
+    {
+        // Every frame of the stream is a separate response
+        m_frame_parser.emplace();
+        m_frame_parser->body_limit(std::numeric_limits<std::uint64_t>::max());
+        http::async_read_header(m_socket, m_buffer, *m_frame_parser, std::bind(
+            &stream_client::on_frame_header,
+            shared_from_this(),
+            std::placeholders::_1,
+            std::placeholders::_2));
+    }
+
+    void on_frame_header(boost::system::error_code ec, std::size_t bytes_transferred)
+    {
+        if (ec)
+        {
+            return finish(ec, "read frame header");
+        }
+
+        m_result.m_bytes += bytes_transferred;
+        auto boundary = m_frame_parser->get()[http::field::body];
+        if (!m_frame_parser->content_length()
+            || ((boundary.size() > 2) && (boundary.substr(boundary.size() - 2) == "--")))
+        {
+            // Termination boundary
+            m_result.m_completed = true;
+            return finish();
+        }
+
+        http::async_read(m_socket, m_buffer, *m_frame_parser, std::bind(
+            &stream_client::on_frame,
+            shared_from_this(),
+            std::placeholders::_1,
+            std::placeholders::_2));
+    }
+
+    void on_frame(boost::system::error_code ec, std::size_t bytes_transferred)
+    {
+        if (ec)
+        {
+            return finish(ec, "read frame");
+        }
+
+        auto now = clock_type::now();
+        m_result.m_bytes += bytes_transferred;
+        if (m_result.m_frames == 0)
+        {
+            m_result.m_time_to_first_frame_ms = to_ms(now - m_request_start);
+        }
+        else
+        {
+            m_result.m_inter_arrival_ms.push_back(to_ms(now - m_last_frame));
+        }
+        m_last_frame = now;
+        ++m_result.m_frames;
+
+        if (((m_spec.m_max_frames > 0) && (m_result.m_frames >= m_spec.m_max_frames))
+            || (now >= m_deadline))
+        {
+            m_result.m_completed = true;
+            return finish();
+        }
+
+        do_read_frame();
+    }
+
+    void finish(boost::system::error_code ec = {}, const char* what = "")
+    {
+        if (ec || *what)
+        {
+            m_result.m_error = std::string(what) + (ec ? ": " + ec.message() : "");
+        }
+
+        m_result.m_duration_s = std::chrono::duration<double>(clock_type::now() - m_request_start).count();
+
+        boost::system::error_code ignored;
+        m_socket.shutdown(stream_protocol::socket::shutdown_both, ignored);
+        m_socket.close(ignored);
+
+        // The last stream ends the run
+        if (--m_remaining == 0)
+        {
+            m_ioc.stop();
+        }
+    }
+
+    static double to_ms(clock_type::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    boost::asio::io_context& m_ioc;
+    stream_protocol::socket m_socket;
+    boost::asio::steady_timer m_timer;
+    stream_protocol::endpoint m_endpoint;
+    stream_spec m_spec;
+    clock_type::time_point m_run_start;
+    clock_type::time_point m_deadline;
+    clock_type::time_point m_request_start;
+    clock_type::time_point m_last_frame;
+    beast::flat_buffer m_buffer;
+    http::request<http::empty_body> m_req;
+    boost::optional<http::response_parser<http::empty_body>> m_header_parser;
+    boost::optional<http::response_parser<http::vector_body<unsigned char>>> m_frame_parser;
+    std::atomic<size_t>& m_remaining;
+    stream_result& m_result;
+};
+
+// Parses a flat JSON object with string and number values,
+// which is all a replay line has (property_tree needs RTTI)
+std::map<std::string, std::string> parse_json_object(const std::string& line)
+{
+    std::map<std::string, std::string> values;
+    size_t pos = 0;
+    auto skip_spaces = [&line, &pos]()
+    {
+        while ((pos < line.size()) && std::isspace(static_cast<unsigned char>(line[pos])))
+        {
+            ++pos;
+        }
+    };
+    auto expect = [&line, &pos, &skip_spaces](char c)
+    {
+        skip_spaces();
+        if ((pos >= line.size()) || (line[pos] != c))
+        {
+            throw std::runtime_error("Malformed replay line: " + line);
+        }
+        ++pos;
+    };
+    auto parse_string = [&line, &pos, &expect]()
+    {
+        expect('"');
+        std::string value;
+        for (; (pos < line.size()) && (line[pos] != '"'); ++pos)
+        {
+            if ((line[pos] == '\\') && (pos + 1 < line.size()))
+            {
+                ++pos;
+            }
+            value += line[pos];
+        }
+        expect('"');
+        return value;
+    };
+
+    expect('{');
+    skip_spaces();
+    if ((pos < line.size()) && (line[pos] == '}'))
+    {
+        return values;
+    }
+
+    do
+    {
+        auto name = parse_string();
+        expect(':');
+        skip_spaces();
+        if ((pos < line.size()) && (line[pos] == '"'))
+        {
+            values[name] = parse_string();
+        }
+        else
+        {
+            auto end = line.find_first_of(",}", pos);
+            if (end == std::string::npos)
+            {
+                throw std::runtime_error("Malformed replay line: " + line);
+            }
+            auto value = line.substr(pos, end - pos);
+            values[name] = value.substr(0, value.find_last_not_of(" \t\r") + 1);
+            pos = end;
+        }
+        skip_spaces();
+    } while ((pos < line.size()) && (line[pos++] == ','));
+
+    if (line[pos - 1] != '}')
+    {
+        throw std::runtime_error("Malformed replay line: " + line);
+    }
+
+    return values;
+}
+
+std::vector<stream_spec> read_replay(const std::string& path, long default_frames)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open the replay file: " + path);
+    }
+
+    std::vector<stream_spec> specs;
+    for (std::string line; std::getline(file, line); )
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        auto entry = parse_json_object(line);
+        auto get = [&entry](const std::string& name, const std::string& default_value)
+        {
+            auto value = entry.find(name);
+            return (value != entry.end()) ? value->second : default_value;
+        };
+
+        stream_spec spec;
+        spec.m_target = get("target", "");
+        if (spec.m_target.empty())
+        {
+            throw std::runtime_error("Replay line without a target: " + line);
+        }
+        spec.m_start = std::chrono::milliseconds(std::stol(get("start_ms", "0")));
+        spec.m_max_frames = std::stol(get("frames", std::to_string(default_frames)));
+        for (auto repeat = std::stoi(get("repeat", "1")); repeat > 0; --repeat)
+        {
+            specs.push_back(spec);
+        }
+    }
+
+    return specs;
+}
+
+struct distribution
+{
+    size_t m_count = 0;
+    double m_mean = 0.0;
+    double m_stddev = 0.0;
+    double m_p50 = 0.0;
+    double m_p99 = 0.0;
+    double m_p999 = 0.0;
+    double m_max = 0.0;
+};
+
+distribution get_distribution(std::vector<double> values)
+{
+    distribution result;
+    if (values.empty())
+    {
+        return result;
+    }
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double p)
+    {
+        auto rank = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[std::max<size_t>(rank, 1) - 1];
+    };
+
+    result.m_count = values.size();
+    result.m_mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    double square_sum = 0.0;
+    for (auto value : values)
+    {
+        square_sum += (value - result.m_mean) * (value - result.m_mean);
+    }
+    result.m_stddev = std::sqrt(square_sum / values.size());
+    result.m_p50 = percentile(0.5);
+    result.m_p99 = percentile(0.99);
+    result.m_p999 = percentile(0.999);
+    result.m_max = values.back();
+
+    return result;
+}
+
+std::string json_string(const std::string& value)
+{
+    std::string result = "\"";
+    for (auto c : value)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+void write_distribution(std::ostream& out, const char* name, const distribution& d)
+{
+    out << "  " << json_string(name) << ": {"
+        << "\"count\": " << d.m_count
+        << ", \"mean\": " << d.m_mean
+        << ", \"stddev\": " << d.m_stddev
+        << ", \"p50\": " << d.m_p50
+        << ", \"p99\": " << d.m_p99
+        << ", \"p999\": " << d.m_p999
+        << ", \"max\": " << d.m_max << "}";
+}
+
+void write_results(
+    std::ostream& out,
+    const std::vector<stream_result>& results,
+    double wall_time_s)
+{
+    std::vector<double> first_frame_ms;
+    std::vector<double> inter_arrival_ms;
+    std::vector<double> stream_fps;
+    long frames = 0;
+    uint64_t bytes = 0;
+    size_t connected = 0;
+    size_t completed = 0;
+    for (const auto& result : results)
+    {
+        frames += result.m_frames;
+        bytes += result.m_bytes;
+        connected += result.m_connected;
+        completed += result.m_completed;
+        if (result.m_time_to_first_frame_ms >= 0.0)
+        {
+            first_frame_ms.push_back(result.m_time_to_first_frame_ms);
+        }
+        inter_arrival_ms.insert(
+            inter_arrival_ms.end(), result.m_inter_arrival_ms.begin(), result.m_inter_arrival_ms.end());
+        if (result.m_duration_s > 0.0)
+        {
+            stream_fps.push_back(result.m_frames / result.m_duration_s);
+        }
+    }
+
+    out << "{\n"
+        << "  \"streams\": " << results.size() << ",\n"
+        << "  \"connected\": " << connected << ",\n"
+        << "  \"completed\": " << completed << ",\n"
+        << "  \"wall_time_s\": " << wall_time_s << ",\n"
+        << "  \"frames\": " << frames << ",\n"
+        << "  \"bytes\": " << bytes << ",\n"
+        << "  \"fps\": " << frames / wall_time_s << ",\n"
+        << "  \"bytes_per_s\": " << bytes / wall_time_s << ",\n";
+    write_distribution(out, "stream_fps", get_distribution(stream_fps));
+    out << ",\n";
+    write_distribution(out, "time_to_first_frame_ms", get_distribution(first_frame_ms));
+    out << ",\n";
+    // The stddev of the inter-arrival times is the frames jitter
+    write_distribution(out, "inter_arrival_ms", get_distribution(inter_arrival_ms));
+    out << ",\n  \"errors\": [";
+    bool first = true;
+    for (const auto& result : results)
+    {
+        if (!result.m_error.empty())
+        {
+            out << (first ? "\n" : ",\n") << "    {\"target\": " << json_string(result.m_target)
+                << ", \"error\": " << json_string(result.m_error) << "}";
+            first = false;
+        }
+    }
+    out << (first ? "]\n" : "\n  ]\n") << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string host;
+    unsigned short port;
+    std::string unix_socket;
+    std::string target;
+    std::string replay;
+    std::string output;
+    int connections;
+    int threads;
+    long frames;
+    double duration;
+
+    po::options_description desc;
+    desc.add_options()
+        ("host,a", po::value<std::string>(&host)->default_value("127.0.0.1"), "Server address.")
+        ("port,p", po::value<unsigned short>(&port)->default_value(8080), "Server port.")
+        ("unix_socket,u", po::value<std::string>(&unix_socket), "Connect to the server's unix socket instead.")
+        ("target,r", po::value<std::string>(&target)->default_value("/filesystem/images?ext=jpg"), "Request target.")
+        ("connections,c", po::value<int>(&connections)->default_value(1), "Number of concurrent streams of the target.")
+        ("replay,j", po::value<std::string>(&replay), "JSONL file with the streams to open, replaces target and connections.")
+        ("frames,f", po::value<long>(&frames)->default_value(0), "Frames to read per stream, 0 reads the whole stream.")
+        ("duration,d", po::value<double>(&duration)->default_value(30.0), "Maximal run duration in seconds.")
+        ("threads,t", po::value<int>(&threads)->default_value(1), "Number of client threads.")
+        ("output,o", po::value<std::string>(&output), "Write the JSON results into the file instead of stdout.");
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        std::vector<stream_spec> specs;
+        if (!replay.empty())
+        {
+            specs = read_replay(replay, frames);
+        }
+        else
+        {
+            specs.assign(connections, stream_spec{target, std::chrono::milliseconds(0), frames});
+        }
+
+        if (specs.empty())
+        {
+            throw std::runtime_error("No streams to open.");
+        }
+
+        boost::asio::io_context ioc{threads};
+
+        stream_protocol::endpoint endpoint;
+        if (!unix_socket.empty())
+        {
+            endpoint = local::endpoint(unix_socket);
+        }
+        else
+        {
+            tcp::resolver resolver(ioc);
+            endpoint = resolver.resolve(host, std::to_string(port))->endpoint();
+        }
+
+        // Results are only touched by their stream's handlers until the run is over
+        std::vector<stream_result> results(specs.size());
+        std::atomic<size_t> remaining{specs.size()};
+        auto run_start = clock_type::now();
+        auto deadline = run_start + std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(duration));
+        for (size_t i = 0; i < specs.size(); ++i)
+        {
+            std::make_shared<stream_client>(
+                ioc, endpoint, host, specs[i], run_start, deadline, remaining, results[i])->run();
+        }
+
+        // Streams stalled past the deadline are abandoned
+        boost::asio::steady_timer stop_timer(ioc);
+        stop_timer.expires_at(deadline + std::chrono::seconds(1));
+        stop_timer.async_wait([&ioc](boost::system::error_code) { ioc.stop(); });
+
+        std::vector<std::thread> v;
+        v.reserve(threads - 1);
+        for (auto i = threads - 1; i > 0; --i)
+        {
+            v.emplace_back([&ioc] { ioc.run(); });
+        }
+        ioc.run();
+        for (auto& thread : v)
+        {
+            thread.join();
+        }
+        auto wall_time_s = std::chrono::duration<double>(clock_type::now() - run_start).count();
+
+        if (!output.empty())
+        {
+            std::ofstream file(output);
+            write_results(file, results, wall_time_s);
+        }
+        else
+        {
+            write_results(std::cout, results, wall_time_s);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,453 @@
+#include "asyncLog.h"
+#include "logger.h"
+#include "frames/filesystem_frame_reader.h"
+#include "inference/hostProcessing.h"
+#include "inference/inferenceConfig.h"
+#include "inference/mockInferenceEngine.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+using clock_type = std::chrono::steady_clock;
+
+// Runs a fixed frame set through the same path as a session: filesystem_frame_reader,
+// resize to the input size, the configured InferenceContext and its NMS. Checks the
+// detections against golden ones and the speed against a baseline, so an optimization
+// can be shown to keep the output and to be faster. The backend comes from config.ini,
+// INFERENCE_BACKEND mock runs it without a GPU.
+//
+// The golden file has a line of "<score> <left> <top> <right> <bottom>" groups per
+// decoded frame, the format of MOCK_DETECTIONS replay, so it can also drive the mock
+// backend. The baseline is the JSON the harness writes.
+//
+// Exits with a failure when a frame mismatches or a metric regresses past the threshold.
+
+namespace
+{
+
+typedef std::vector<std::vector<Detection>> frames_detections;
+
+struct run_result
+{
+    frames_detections m_detections;
+    std::vector<double> m_latencies_ms;
+    double m_elapsed_s = 0.0;
+};
+
+struct latency_summary
+{
+    double m_mean = 0.0;
+    double m_p50 = 0.0;
+    double m_p90 = 0.0;
+    double m_p99 = 0.0;
+    double m_max = 0.0;
+};
+
+struct accuracy_summary
+{
+    size_t m_compared_frames = 0;
+    size_t m_mismatched_frames = 0;
+    size_t m_missing_detections = 0;
+    size_t m_extra_detections = 0;
+};
+
+struct metrics
+{
+    double m_frames_per_second = 0.0;
+    latency_summary m_latency;
+};
+
+latency_summary get_latency_summary(std::vector<double> values)
+{
+    latency_summary result;
+    if (values.empty())
+    {
+        return result;
+    }
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double p)
+    {
+        auto rank = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[std::max<size_t>(rank, 1) - 1];
+    };
+
+    result.m_mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    result.m_p50 = percentile(0.5);
+    result.m_p90 = percentile(0.9);
+    result.m_p99 = percentile(0.99);
+    result.m_max = values.back();
+    return result;
+}
+
+// Reads every frame of the directory through a new context, like a session does
+run_result run_frames(InferenceEngine& engine, const std::string& frames_dir, const std::string& extention, long max_frames)
+{
+    run_result result;
+    auto context = engine.get_inference_context();
+    cv::Size input_size(context->get_input_width(), context->get_input_height());
+    filesystem_frame_reader reader(frames_dir, extention);
+    std::vector<cv::Mat> batch;
+    cv::Mat input_frame;
+
+    auto run_start = clock_type::now();
+    while (!reader.is_finished() && ((max_frames <= 0) || (static_cast<long>(result.m_detections.size()) < max_frames)))
+    {
+        auto frame_start = clock_type::now();
+        auto frame = reader.read_frame();
+        if (frame.empty())
+        {
+            // Skipped by the sessions as well, so it has no golden line
+            continue;
+        }
+
+        if (frame.size() == input_size)
+        {
+            input_frame = frame;
+        }
+        else
+        {
+            cv::resize(frame, input_frame, input_size);
+        }
+        batch.clear();
+        batch.push_back(std::move(input_frame));
+
+        std::vector<Detection> detections;
+        if (!context->infer(batch, detections))
+        {
+            throw std::runtime_error("Inference failed on frame " + std::to_string(result.m_detections.size()));
+        }
+
+        result.m_latencies_ms.push_back(
+            std::chrono::duration<double, std::milli>(clock_type::now() - frame_start).count());
+        result.m_detections.push_back(std::move(detections));
+    }
+    result.m_elapsed_s = std::chrono::duration<double>(clock_type::now() - run_start).count();
+
+    return result;
+}
+
+void write_golden(const std::string& file_name, const std::string& frames_dir, const frames_detections& detections)
+{
+    std::ofstream file(file_name);
+    file << "# Golden detections of " << detections.size() << " frames of " << frames_dir << "\n";
+    char group[96];
+    for (const auto& frame : detections)
+    {
+        std::string line;
+        for (const auto& detection : frame)
+        {
+            snprintf(group, sizeof(group), "%s%.6f %.6f %.6f %.6f %.6f", line.empty() ? "" : " ",
+                detection.mScore, detection.mBox[0], detection.mBox[1], detection.mBox[2], detection.mBox[3]);
+            line += group;
+        }
+        file << line << "\n";
+    }
+}
+
+// Pairs every golden detection, highest score first, with the best overlapping unpaired one
+accuracy_summary compare_detections(
+    const frames_detections& golden,
+    const frames_detections& actual,
+    float min_iou,
+    float score_tolerance)
+{
+    accuracy_summary result;
+    result.m_compared_frames = std::min(golden.size(), actual.size());
+    // Missing or extra frames are mismatches
+    result.m_mismatched_frames = std::max(golden.size(), actual.size()) - result.m_compared_frames;
+
+    for (size_t frame = 0; frame < result.m_compared_frames; ++frame)
+    {
+        auto expected = golden[frame];
+        std::sort(expected.begin(), expected.end(), ScoreDescendingCompare());
+        const auto& found = actual[frame];
+        std::vector<bool> paired(found.size(), false);
+        size_t missing = 0;
+
+        for (const auto& detection : expected)
+        {
+            auto best = found.size();
+            auto best_iou = min_iou;
+            for (size_t i = 0; i < found.size(); ++i)
+            {
+                if (paired[i] || (std::fabs(found[i].mScore - detection.mScore) > score_tolerance))
+                {
+                    continue;
+                }
+
+                auto iou = getIou(detection, found[i]);
+                if (iou >= best_iou)
+                {
+                    best = i;
+                    best_iou = iou;
+                }
+            }
+
+            if (best == found.size())
+            {
+                ++missing;
+                continue;
+            }
+            paired[best] = true;
+        }
+
+        auto extra = static_cast<size_t>(std::count(paired.begin(), paired.end(), false));
+        if (missing || extra)
+        {
+            ++result.m_mismatched_frames;
+            result.m_missing_detections += missing;
+            result.m_extra_detections += extra;
+            std::cerr << "Frame " << frame << ": " << missing << " missing, " << extra << " extra detections" << std::endl;
+        }
+    }
+
+    return result;
+}
+
+std::string read_file(const std::string& file_name)
+{
+    std::ifstream file(file_name);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// Finds a number by its key, enough for the flat JSON the harness writes
+bool read_json_number(const std::string& json, const std::string& key, double& value)
+{
+    auto position = json.find("\"" + key + "\"");
+    if (position == std::string::npos)
+    {
+        return false;
+    }
+
+    position = json.find(':', position);
+    if (position == std::string::npos)
+    {
+        return false;
+    }
+
+    char* end = nullptr;
+    value = std::strtod(json.c_str() + position + 1, &end);
+    return end != json.c_str() + position + 1;
+}
+
+bool read_baseline(const std::string& file_name, metrics& baseline)
+{
+    auto json = read_file(file_name);
+    return read_json_number(json, "frames_per_second", baseline.m_frames_per_second)
+        && read_json_number(json, "p50", baseline.m_latency.m_p50)
+        && read_json_number(json, "p99", baseline.m_latency.m_p99);
+}
+
+void write_json(
+    std::ostream& out,
+    const std::string& backend,
+    size_t frames,
+    int passes,
+    const metrics& measured,
+    const accuracy_summary* accuracy,
+    bool regressed)
+{
+    out << "{\n"
+        << "  \"backend\": \"" << backend << "\",\n"
+        << "  \"frames\": " << frames << ",\n"
+        << "  \"passes\": " << passes << ",\n"
+        << "  \"frames_per_second\": " << measured.m_frames_per_second << ",\n"
+        << "  \"latency_ms\": {\"mean\": " << measured.m_latency.m_mean
+        << ", \"p50\": " << measured.m_latency.m_p50
+        << ", \"p90\": " << measured.m_latency.m_p90
+        << ", \"p99\": " << measured.m_latency.m_p99
+        << ", \"max\": " << measured.m_latency.m_max << "}";
+    if (accuracy)
+    {
+        out << ",\n  \"accuracy\": {\"compared_frames\": " << accuracy->m_compared_frames
+            << ", \"mismatched_frames\": " << accuracy->m_mismatched_frames
+            << ", \"missing_detections\": " << accuracy->m_missing_detections
+            << ", \"extra_detections\": " << accuracy->m_extra_detections << "}";
+    }
+    out << ",\n  \"regressed\": " << (regressed ? "true" : "false") << "\n}\n";
+}
+
+// Compares a metric with the baseline, higher_is_better tells the direction of a regression
+bool check_metric(const char* name, double value, double baseline, double threshold_percent, bool higher_is_better)
+{
+    auto change_percent = baseline > 0 ? (value - baseline) * 100.0 / baseline : 0.0;
+    auto regressed = higher_is_better ? (change_percent < -threshold_percent) : (change_percent > threshold_percent);
+    fprintf(stderr, "%-20s %12.3f %12.3f %+8.1f%%%s\n",
+        name, baseline, value, change_percent, regressed ? "  REGRESSION" : "");
+    return !regressed;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    std::string config_file;
+    std::string frames_dir;
+    std::string extention;
+    std::string golden_file;
+    std::string baseline_file;
+    std::string output;
+    bool update_golden = false;
+    bool update_baseline = false;
+    double threshold;
+    float min_iou;
+    float score_tolerance;
+    long warmup;
+    int passes;
+
+    po::options_description desc;
+    desc.add_options()
+        ("config,c", po::value<std::string>(&config_file)->default_value("config.ini"), "Config with the inference backend settings.")
+        ("frames,i", po::value<std::string>(&frames_dir)->required(), "Directory of the frame set.")
+        ("ext,e", po::value<std::string>(&extention)->default_value("jpg"), "Extension of the frame files.")
+        ("golden,g", po::value<std::string>(&golden_file), "Golden detections to check the output against.")
+        ("update_golden", po::bool_switch(&update_golden), "Write the detections as the new golden ones.")
+        ("baseline,b", po::value<std::string>(&baseline_file), "Baseline JSON to check the throughput and latency against.")
+        ("update_baseline", po::bool_switch(&update_baseline), "Write the measured metrics as the new baseline.")
+        ("threshold,t", po::value<double>(&threshold)->default_value(10.0), "Allowed regression from the baseline, in percents.")
+        ("iou", po::value<float>(&min_iou)->default_value(0.9f), "Minimal IoU of a detection with its golden one.")
+        ("score_tolerance", po::value<float>(&score_tolerance)->default_value(0.01f), "Maximal score difference from the golden one.")
+        ("warmup,w", po::value<long>(&warmup)->default_value(10), "Frames run before the measured passes.")
+        ("passes,n", po::value<int>(&passes)->default_value(3), "Measured passes over the frame set.")
+        ("output,o", po::value<std::string>(&output), "Write the JSON results into the file instead of stdout.");
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        InferenceConfig config;
+        if (!readInferenceConfigFile(config_file, config))
+        {
+            return EXIT_FAILURE;
+        }
+
+        auto engine = createInferenceEngine(config);
+        if (!engine->build())
+        {
+            inference::asyncLog::flush();
+            std::cerr << "Failed to build the inference engine" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        extention = "." + extention;
+        if (warmup > 0)
+        {
+            run_frames(*engine, frames_dir, extention, warmup);
+        }
+
+        // Detections are checked on the first pass, every pass is timed
+        auto first = run_frames(*engine, frames_dir, extention, 0);
+        auto latencies = first.m_latencies_ms;
+        auto elapsed_s = first.m_elapsed_s;
+        for (int pass = 1; pass < passes; ++pass)
+        {
+            auto next = run_frames(*engine, frames_dir, extention, 0);
+            latencies.insert(latencies.end(), next.m_latencies_ms.begin(), next.m_latencies_ms.end());
+            elapsed_s += next.m_elapsed_s;
+        }
+        inference::asyncLog::flush();
+
+        metrics measured;
+        measured.m_frames_per_second = elapsed_s > 0 ? latencies.size() / elapsed_s : 0.0;
+        measured.m_latency = get_latency_summary(latencies);
+
+        bool passed = true;
+        accuracy_summary accuracy;
+        bool checked_accuracy = false;
+        if (!golden_file.empty() && update_golden)
+        {
+            write_golden(golden_file, frames_dir, first.m_detections);
+            std::cerr << "Golden detections written: " << golden_file << std::endl;
+        }
+        else if (!golden_file.empty())
+        {
+            frames_detections golden;
+            if (!MockInferenceEngine::readDetections(golden_file, golden))
+            {
+                std::cerr << "Cannot read the golden detections: " << golden_file << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            accuracy = compare_detections(golden, first.m_detections, min_iou, score_tolerance);
+            checked_accuracy = true;
+            std::cerr << "Mismatched frames: " << accuracy.m_mismatched_frames
+                << " of " << std::max(golden.size(), first.m_detections.size()) << std::endl;
+            passed = accuracy.m_mismatched_frames == 0;
+        }
+
+        bool regressed = false;
+        if (!baseline_file.empty() && !update_baseline)
+        {
+            metrics baseline;
+            if (!read_baseline(baseline_file, baseline))
+            {
+                std::cerr << "Cannot read the baseline: " << baseline_file << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            fprintf(stderr, "%-20s %12s %12s %9s\n", "metric", "baseline", "current", "change");
+            regressed = !check_metric("frames_per_second", measured.m_frames_per_second,
+                    baseline.m_frames_per_second, threshold, true)
+                | !check_metric("latency_p50_ms", measured.m_latency.m_p50, baseline.m_latency.m_p50, threshold, false)
+                | !check_metric("latency_p99_ms", measured.m_latency.m_p99, baseline.m_latency.m_p99, threshold, false);
+            passed = passed && !regressed;
+        }
+
+        auto write_results = [&](std::ostream& out)
+        {
+            write_json(out, config.mBackend, first.m_detections.size(), passes, measured,
+                checked_accuracy ? &accuracy : nullptr, regressed);
+        };
+
+        if (!baseline_file.empty() && update_baseline)
+        {
+            std::ofstream file(baseline_file);
+            write_results(file);
+            std::cerr << "Baseline written: " << baseline_file << std::endl;
+        }
+
+        if (!output.empty())
+        {
+            std::ofstream file(output);
+            write_results(file);
+        }
+        else
+        {
+            write_results(std::cout);
+        }
+
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        inference::asyncLog::flush();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
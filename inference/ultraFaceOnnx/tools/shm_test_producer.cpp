@@ -0,0 +1,90 @@
+#include "frames/files_iterator.h"
+#include "frames/shm_frame_producer.h"
+
+#include <boost/program_options.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace po = boost::program_options;
+
+// Publishes the images of a directory into a shared memory frames ring
+// at a fixed rate, to be streamed from the server's /shm/<name> route.
+int main(int argc, char** argv)
+{
+    std::string name;
+    std::string dir;
+    std::string extention;
+    double fps;
+    uint32_t slots;
+    uint32_t slot_size;
+    bool jpeg = false;
+    bool loop = false;
+
+    po::options_description desc;
+    desc.add_options()
+        ("name,n", po::value<std::string>(&name)->default_value("ultraface"), "Shared memory segment name.")
+        ("dir,d", po::value<std::string>(&dir)->required(), "Directory with the images to publish.")
+        ("ext,e", po::value<std::string>(&extention)->default_value(".jpg"), "Images extention.")
+        ("fps,f", po::value<double>(&fps)->default_value(25.0), "Frames per second.")
+        ("slots,s", po::value<uint32_t>(&slots)->default_value(8), "Number of ring slots.")
+        ("slot_size", po::value<uint32_t>(&slot_size)->default_value(3840 * 2160 * 3), "Slot capacity in bytes.")
+        ("jpeg,j", po::bool_switch(&jpeg), "Publish encoded JPEGs instead of raw BGR frames.")
+        ("loop,l", po::bool_switch(&loop), "Publish the directory over and over.");
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        shm_frame_producer producer(name, slots, slot_size);
+        auto pause = std::chrono::microseconds(static_cast<long>(1000000 / fps));
+        long published = 0;
+        long dropped = 0;
+
+        do
+        {
+            for (files_iterator files(dir, extention); !files.is_finished(); files.move_next())
+            {
+                auto next = std::chrono::steady_clock::now() + pause;
+                bool written = false;
+                if (jpeg)
+                {
+                    std::ifstream file(files.get_file_path(), std::ios::binary);
+                    std::vector<unsigned char> buffer(
+                        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    written = producer.write_jpeg(buffer.data(), buffer.size());
+                }
+                else
+                {
+                    written = producer.write_frame(cv::imread(files.get_file_path()));
+                }
+
+                written ? ++published : ++dropped;
+                std::this_thread::sleep_until(next);
+            }
+        } while (loop);
+
+        std::cout << "Published: " << published << ", dropped: " << dropped << std::endl;
+        producer.close();
+
+        // Let the consumer drain the ring before the segment is unlinked
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}